@@ -0,0 +1,66 @@
+#ifndef AVATARS_H
+#define AVATARS_H
+
+#include <Arduino.h>
+#include <lvgl.h>
+#include "config.h"
+
+// Thumbnail size on the post screens, in pixels (square, RGB565)
+#ifndef AVATAR_SIZE
+#define AVATAR_SIZE 20
+#endif
+
+// Where Bluesky serves avatars. Named here so tools/ca_bundle.py pins its root;
+// Mastodon avatars come from each instance's own media host (see XRPC_CA_HOSTS).
+#define AVATAR_CDN_URL "https://cdn.bsky.app"
+
+#define AVATAR_CACHE_SLOTS 16    // Decoded thumbnails kept in PSRAM (LRU)
+#define AVATAR_DISK_FILES 100    // Thumbnails kept in LittleFS under /avatars
+#define AVATAR_URL_MAX 256
+#define AVATAR_MAX_BYTES 65536   // Largest JPEG download accepted
+#define AVATAR_DECODE_MAX 160    // Largest decoded size after TJpgDec's 1/2/4/8 scaling
+#define AVATAR_QUEUE_DEPTH 8
+
+// Avatar task settings (core 0 with the feed worker, below it in priority)
+#define AVATAR_TASK_STACK 12288  // TLS handshakes run on it
+#define AVATAR_TASK_PRIORITY 0
+#define AVATAR_TASK_CORE 0
+
+struct AvatarStats {
+    uint32_t requests;
+    uint32_t memoryHits;  // Already decoded in PSRAM
+    uint32_t diskHits;    // Read back from LittleFS, no network or decode
+    uint32_t downloads;
+    uint32_t failures;
+    uint32_t decodes;
+    uint64_t totalDecodeUs;
+    uint32_t maxDecodeUs;
+    uint64_t totalDownloadUs;
+};
+
+// Cache key for an avatar URL, 0 for none
+inline uint32_t avatarKey(const char *url) {
+    if (url == NULL || url[0] == '\0') return 0;
+    uint32_t hash = 2166136261u;  // FNV-1a
+    while (*url) {
+        hash ^= (uint8_t)*url++;
+        hash *= 16777619u;
+    }
+    return hash != 0 ? hash : 1;
+}
+
+// Avatars are downloaded, decoded, downscaled and written to the disk cache on
+// their own task; nothing here blocks the caller.
+void startAvatarWorker();
+void requestAvatar(const char *url);  // Any task; dropped if the queue is full
+void requestCachedAvatar(uint32_t key);  // Memory or disk cache only, e.g. for restored posts
+
+// UI side. Returns the thumbnail for key if it's decoded, NULL otherwise, and keeps
+// it from being evicted until the same holder (a post screen index) asks again.
+const lv_img_dsc_t *avatarFor(uint32_t key, int holder);
+uint32_t avatarGeneration();  // Changes whenever a new thumbnail becomes ready
+
+const AvatarStats &avatarStats();
+void printAvatarStats();
+
+#endif // AVATARS_H
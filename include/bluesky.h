@@ -0,0 +1,43 @@
+#ifndef BLUESKY_H
+#define BLUESKY_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include "config.h"
+
+struct FeedItem;
+
+// What the last fetchFeeds() call cost, all sources together
+struct FetchStats {
+    int httpCode;
+    uint32_t durationUs;         // Including any session refresh or login
+    uint32_t bytesRead;          // Response body bytes consumed
+    size_t poolPeak;             // Largest JSON pool use for a single post, any source
+    uint32_t minFreeHeap;        // Lowest free heap seen during the fetch
+    uint32_t largestBlockAtMin;  // Largest free block at that point
+    int newPosts;
+    int skippedPosts;            // Already seen, or the same post from another source
+    bool parseError;
+    int sources;                 // Sources that sent a request
+    uint32_t slowestSourceUs;    // durationUs is close to this when the sources overlap
+    uint32_t totalSourceUs;      // ...and close to this if they had run one after another
+};
+
+// Feed client. The sources in feed_sources.h are fetched concurrently and merged
+// into the post store (post_store.h); the Bluesky session is handled by
+// bluesky_session.h.
+bool fetchFeeds();  // Blocking; true if a new post set was published
+const FetchStats &lastFetchStats();
+void resetFeedSyncState();  // Forget seen posts so the next fetch is a full sync
+bool offerStreamedPost(const FeedItem &item);  // Any task; publishes at once if it made the top
+
+// Points every XRPC and Mastodon API call at another server (e.g. tools/mock_xrpc.py), "" to undo
+void setBlueskyServer(const char *baseUrl);
+String blueskyEndpoint(const char *configuredUrl);
+
+// Background worker that runs fetchFeeds() when the poll scheduler (poll_scheduler.h) says
+void startFeedWorker();
+void requestFeedRefresh();  // Wake the worker for an immediate refresh
+bool feedWorkerBusy();      // True while a fetch is in flight
+
+#endif // BLUESKY_H
@@ -0,0 +1,20 @@
+#ifndef BLUESKY_SESSION_H
+#define BLUESKY_SESSION_H
+
+#include <Arduino.h>
+#include "config.h"
+
+#ifndef BLUESKY_REFRESH_URL
+#define BLUESKY_REFRESH_URL "https://bsky.social/xrpc/com.atproto.server.refreshSession"
+#endif
+
+// Bluesky session lifecycle. Both tokens are kept in NVS so warm boots reuse the
+// last session. The access token is refreshed with refreshSession shortly before
+// its JWT `exp`, and createSession (password login) is only used when that fails.
+bool ensureBlueskySession();          // Make sure there's a usable access token
+const String &blueskyAccessToken();   // Current access token ("" if none)
+void invalidateBlueskyAccessToken();  // Call on 401; next ensure refreshes the session
+bool authenticateBluesky();           // Full createSession login
+bool refreshBlueskySession();         // refreshSession with the stored refresh token
+
+#endif // BLUESKY_SESSION_H
@@ -0,0 +1,60 @@
+#ifndef BUTTONS_H
+#define BUTTONS_H
+
+#include <Arduino.h>
+#include "config.h"
+
+#define BUTTON_MAX 2
+#define BUTTON_QUEUE_DEPTH 16  // Raw edges from the interrupt, bounces included
+
+// Gesture timing
+#ifndef BUTTON_DEBOUNCE_MS
+#define BUTTON_DEBOUNCE_MS 25      // Edges this soon after an accepted one are bounce
+#endif
+#ifndef BUTTON_LONG_PRESS_MS
+#define BUTTON_LONG_PRESS_MS 600   // Held this long: long press, fired while still held
+#endif
+#ifndef BUTTON_DOUBLE_PRESS_MS
+#define BUTTON_DOUBLE_PRESS_MS 300 // Second press within this of the first release
+#endif
+
+enum ButtonGesture {
+    BUTTON_SHORT_PRESS,
+    BUTTON_LONG_PRESS,
+    BUTTON_DOUBLE_PRESS,
+    BUTTON_GESTURE_COUNT
+};
+
+struct ButtonEvent {
+    uint8_t button;  // Index returned by addButton()
+    ButtonGesture gesture;
+    uint32_t timeUs;  // micros() when the gesture became certain: the deciding edge or timeout
+};
+
+struct ButtonStats {
+    uint32_t edges;      // Raw interrupt edges
+    uint32_t bounces;    // Edges dropped by the debounce
+    uint32_t dropped;    // Edges lost to a full queue (recovered by re-reading the pin)
+    uint32_t actions;    // Gestures handled
+    uint32_t lastLatencyUs;
+    uint32_t maxLatencyUs;
+    uint32_t maxLatencyFetchUs;  // Worst while the feed worker was fetching
+    uint64_t totalLatencyUs;
+};
+
+// Active-low buttons with pullups. Each pin gets a level interrupt that flips
+// between low and high, so both edges are caught, the button can wake the chip
+// from light sleep, and a held button doesn't keep firing. The interrupt only
+// timestamps edges into a queue; debounce and gesture recognition run on the
+// render loop in nextButtonEvent().
+int addButton(uint8_t pin, bool doublePress);  // Without double press, short presses fire on release
+bool nextButtonEvent(ButtonEvent &event);
+uint32_t buttonsNextDeadlineMs();  // Until a pending gesture times out, UINT32_MAX if none
+
+// Input-to-action latency: call once the action for event has been applied
+void recordButtonLatency(const ButtonEvent &event, bool duringFetch);
+const char *buttonGestureName(ButtonGesture gesture);
+const ButtonStats &buttonStats();
+void printButtonStats();
+
+#endif // BUTTONS_H
@@ -0,0 +1,73 @@
+#ifndef DISPLAY_H
+#define DISPLAY_H
+
+#include <Arduino.h>
+#include <lvgl.h>
+#include "config.h"
+
+// Display pipeline modes
+#define DISPLAY_PIPELINE_PARTIAL 0  // Two small internal DMA buffers, dirty areas flushed in strips
+#define DISPLAY_PIPELINE_DIRECT 1   // Two full-frame PSRAM buffers, LVGL direct mode, dirty rows pushed once per frame
+#define DISPLAY_PIPELINE_HYBRID 2   // Two full-frame-sized PSRAM buffers, each dirty area rendered and flushed in one transfer
+
+#ifndef DISPLAY_PIPELINE
+#define DISPLAY_PIPELINE DISPLAY_PIPELINE_PARTIAL
+#endif
+
+// I80 write clock for the ST7789
+#ifndef DISPLAY_PCLK_HZ
+#define DISPLAY_PCLK_HZ (10 * 1000 * 1000)
+#endif
+
+// Lines per buffer in partial mode
+#ifndef DISPLAY_BUF_LINES
+#define DISPLAY_BUF_LINES 40
+#endif
+
+#ifndef DISPLAY_TRANS_QUEUE_DEPTH
+#define DISPLAY_TRANS_QUEUE_DEPTH 20
+#endif
+
+// Hardware scroll. The ST7789 scrolls along its 320 gate lines, which run across
+// the screen in landscape. If slides come in from the left on your panel, set this.
+#ifndef DISPLAY_SCROLL_INVERT
+#define DISPLAY_SCROLL_INVERT 0
+#endif
+#define DISPLAY_SCROLL_STRIP 32  // Widest column strip sent in one transfer
+
+// Flush timing, accumulated since the last resetDisplayStats()
+struct DisplayStats {
+    uint32_t frames;
+    uint32_t totalFlushUs;   // Time the bus spent pushing pixels
+    uint32_t maxFlushUs;     // Worst single frame
+    uint32_t totalRenderMs;  // LVGL's own refresh time (render + flush wait)
+    uint32_t totalPixels;
+    uint32_t blits;          // Full frames sent with blitFrame()
+    uint32_t totalBlitUs;    // Bus time for those, queue to last byte
+    uint32_t totalBlitCpuUs; // CPU time spent queuing them
+    uint32_t scrollSteps;    // scrollFrameIn() calls
+    uint32_t scrollBytes;    // Bus bytes they sent, commands included
+    uint32_t totalScrollUs;  // Their bus time, first strip to scroll command
+};
+
+void initDisplay();
+const char *displayPipelineName();
+DisplayStats displayStats();
+void resetDisplayStats();
+void printDisplayStats();
+
+// Full frames that bypass LVGL, e.g. pre-rendered static screens. The frame is
+// SCREEN_WIDTH x SCREEN_HEIGHT in LVGL's color format and must stay valid while
+// it's being sent; blitFrame() returns as soon as the transfer is queued.
+lv_color_t *allocFrame();  // DMA-capable PSRAM, NULL if there isn't any
+void blitFrame(const lv_color_t *frame);
+
+// Slides frame in from the right over what the panel shows, using the panel's
+// scroll start address, so only the newly uncovered columns go over the bus.
+// After a call the old picture is moved left by toX and frame's first toX
+// columns fill the right. Step toX up from 0; at SCREEN_WIDTH the panel is
+// unscrolled again and shows frame. LVGL must not draw until then, so keep
+// invalidation disabled for the whole slide.
+void scrollFrameIn(const lv_color_t *frame, int fromX, int toX);
+
+#endif // DISPLAY_H
@@ -0,0 +1,103 @@
+#ifndef FEED_PARSE_H
+#define FEED_PARSE_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "config.h"
+#include "post_store.h"
+#include "json_stream_reader.h"
+
+// Parsing of one feed response, shared by the source tasks (feed_sources.cpp)
+// and the native build's replay of bench/payloads. No FreeRTOS or network code.
+
+enum FeedSourceType {
+    FEED_BLUESKY_TAG,     // searchPosts for #query
+    FEED_BLUESKY_AUTHOR,  // getAuthorFeed for the handle in query, reposts and replies left out
+    FEED_MASTODON_TAG,    // Public tag timeline for #query on the instance in server
+};
+
+struct FeedSource {
+    FeedSourceType type;
+    const char *query;   // Tag without the #, or a Bluesky handle
+    const char *server;  // Mastodon instance base URL, e.g. "https://fosstodon.org"; unused for Bluesky
+};
+
+// JSON pool for one filtered post. Posts are parsed one at a time, so this bounds
+// each source's parse memory for the whole fetch: the pool is the only heap a
+// parse uses, whatever the size of the page.
+#ifndef BLUESKY_JSON_CAPACITY
+#define BLUESKY_JSON_CAPACITY 4096
+#endif
+
+// Rules applied while parsing, before a post reaches the merge. Comma-separated,
+// case-insensitive. Author exclusions only apply to tag sources, so an author
+// feed can still follow an account that's excluded from the tags.
+#ifndef FEED_EXCLUDE_AUTHORS
+#define FEED_EXCLUDE_AUTHORS "seagl.org"  // Official account
+#endif
+#ifndef FEED_INCLUDE_AUTHORS
+#define FEED_INCLUDE_AUTHORS ""  // Non-empty: tag sources only show these authors
+#endif
+#ifndef FEED_EXCLUDE_WORDS
+#define FEED_EXCLUDE_WORDS ""    // Posts containing any of these are dropped
+#endif
+
+enum FeedNetwork {
+    FEED_NETWORK_BLUESKY,
+    FEED_NETWORK_MASTODON,
+};
+
+// One parsed post on its way from a source to the merge
+struct FeedItem {
+    int64_t createdAtMs;
+    uint32_t uriHash;   // feedHash() of the post's URI
+    uint32_t textHash;  // feedTextHash() of its text, to catch the same post bridged from the other network
+    FeedNetwork network;
+    char handle[POST_AUTHOR_MAX];
+    char avatar[256];
+    char text[POST_TEXT_MAX];
+};
+
+enum FeedItemResult {
+    FEED_ITEM_POST,      // Goes to the merge
+    FEED_ITEM_FILTERED,  // Dropped by a rule
+    FEED_ITEM_SKIPPED,   // Not a post to show at all: a repost, or missing fields
+};
+
+// Reads a response's posts straight from the stream, one array element at a
+// time, through a filter that keeps only the fields the post screens use:
+//   FeedParser parser(source, reader, doc);
+//   while (parser.next(item)) { ... parser.result() ... }
+class FeedParser {
+public:
+    FeedParser(const FeedSource &source, JsonStreamReader &reader, JsonDocument &doc);
+
+    bool next(FeedItem &item);  // false at the end of the array, or on an error
+    FeedItemResult result() const { return itemResult; }
+    // What the last post would advance the source's cursor to; valid until the next call
+    const char *cursorValue() const { return cursor; }
+
+    bool error() const { return parseError; }  // No posts array, a bad or cut-off body, or a post that didn't fit the pool
+    int parsed() const { return count; }
+    size_t poolPeak() const { return peak; }
+
+private:
+    const FeedSource &source;
+    JsonStreamReader &reader;
+    JsonDocument &doc;
+    StaticJsonDocument<384> filter;
+    FeedItemResult itemResult = FEED_ITEM_SKIPPED;
+    const char *cursor = "";
+    bool started = false;
+    bool done = false;
+    bool parseError = false;
+    int count = 0;
+    size_t peak = 0;
+};
+
+bool passesFeedRules(FeedSourceType type, const char *handle, const char *text);  // The rules above
+
+uint32_t feedHash(const char *text);
+uint32_t feedTextHash(const char *text);  // Ignores case, spacing and punctuation
+
+#endif // FEED_PARSE_H
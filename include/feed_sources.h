@@ -0,0 +1,59 @@
+#ifndef FEED_SOURCES_H
+#define FEED_SOURCES_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "feed_parse.h"
+#include "xrpc_client.h"
+
+// Sources to follow, fetched concurrently on each refresh and merged newest first.
+// In config.h, for example (on one line):
+//   #define FEED_SOURCES {FEED_BLUESKY_TAG, "seagl2025"}, {FEED_BLUESKY_AUTHOR, "seagl.org"},
+//                        {FEED_MASTODON_TAG, "seagl", "https://fosstodon.org"}
+#if defined(FETCH_BENCH) && !defined(FEED_SOURCES)
+// One of each kind, all served by tools/mock_xrpc.py; the two tags overlap
+#define FEED_SOURCES {FEED_BLUESKY_TAG, "seagl2025"}, {FEED_BLUESKY_TAG, "a11y"}, \
+                     {FEED_BLUESKY_AUTHOR, "seagl.org"}, {FEED_MASTODON_TAG, "seagl2025", "https://mastodon.example"}
+#endif
+#ifndef FEED_SOURCES
+#define FEED_SOURCES {FEED_BLUESKY_TAG, BLUESKY_SEARCH_TAG}
+#endif
+#define FEED_MAX_SOURCES 4  // Each one has its own task and XRPC connection while fetching
+
+#ifndef BLUESKY_AUTHOR_FEED_URL
+#define BLUESKY_AUTHOR_FEED_URL "https://bsky.social/xrpc/app.bsky.feed.getAuthorFeed"
+#endif
+
+#define FEED_PAGE_LIMIT 15   // Posts asked for per source
+#define FEED_SOURCE_QUEUE 2  // Parsed posts a source can get ahead of the merge
+
+// What one source's part of the last refresh cost
+struct SourceStats {
+    int httpCode;
+    uint32_t durationUs;  // Request to last post handed over
+    uint32_t bytesRead;
+    size_t poolPeak;
+    int posts;       // Handed to the merge
+    int filtered;    // Dropped by the feed rules (feed_parse.h)
+    bool parseError;
+    bool cancelled;  // Stopped early because the merge had what it needed
+    uint32_t serverWaitMs;  // Least wait the server asked for (Retry-After, ratelimit-*), 0 if none
+    XrpcTiming timing;      // Where the request's time went
+};
+
+// Each source runs on its own task. beginSourceFetches() starts all of them; the
+// caller then takes every source's posts in order with nextSourceItem() until it
+// returns false, handing each one back with releaseSourceItem().
+bool startFeedSources();  // Creates the tasks and item pools; false if memory ran out
+int feedSourceCount();
+const FeedSource &feedSource(int index);
+const char *feedSourceName(int index);  // e.g. "#seagl2025", "@seagl.org", "#seagl@fosstodon.org"
+bool feedSourcesNeedSession();          // Any Bluesky source
+void beginSourceFetches(bool blueskySession);  // Bluesky sources are skipped without a session
+bool nextSourceItem(int source, FeedItem *&item);  // Blocks until the source has a post or is done
+void releaseSourceItem(int source, FeedItem *item);
+void cancelSourceFetches();  // Sources stop reading after the post they're on
+const SourceStats &sourceStats(int source);
+void resetSourceCursors();   // Next refresh asks every source for its full page
+
+#endif // FEED_SOURCES_H
@@ -0,0 +1,27 @@
+#ifndef FETCH_BENCH_H
+#define FETCH_BENCH_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// Fetch-path benchmark against tools/mock_xrpc.py. Built only with -DFETCH_BENCH
+// (see [env:fetch-bench] in platformio.ini); MOCK_XRPC_URL is the mock's base URL,
+// http:// or, with --tls-cert, https://.
+#ifndef MOCK_XRPC_URL
+#define MOCK_XRPC_URL "http://192.168.1.100:8080"
+#endif
+
+#ifndef FETCH_BENCH_ITERATIONS
+#define FETCH_BENCH_ITERATIONS 20
+#endif
+
+// Then the poll scheduler runs against the mock's scripted traffic for this long,
+// paused (as on a dimmed screen) for the middle quarter; 0 skips it
+#ifndef FETCH_BENCH_POLL_MINUTES
+#define FETCH_BENCH_POLL_MINUTES 20
+#endif
+
+// Runs every scenario on a background task and prints a report per scenario
+void startFetchBenchmark();
+
+#endif // FETCH_BENCH_H
@@ -0,0 +1,58 @@
+#ifndef FONTS_H
+#define FONTS_H
+
+#include <Arduino.h>
+#include <lvgl.h>
+#include "config.h"
+
+// The screens' fonts by pixel size: the subsets tools/subset_fonts.py generates
+// (16-28 and 32, 48), or LVGL's built-in Montserrat when it couldn't
+#ifdef BADGE_FONTS_SUBSET
+#define BADGE_FONT(size) badge_font_##size
+LV_FONT_DECLARE(badge_font_16)
+LV_FONT_DECLARE(badge_font_18)
+LV_FONT_DECLARE(badge_font_20)
+LV_FONT_DECLARE(badge_font_22)
+LV_FONT_DECLARE(badge_font_24)
+LV_FONT_DECLARE(badge_font_26)
+LV_FONT_DECLARE(badge_font_28)
+LV_FONT_DECLARE(badge_font_32)
+LV_FONT_DECLARE(badge_font_48)
+#else
+#define BADGE_FONT(size) lv_font_montserrat_##size
+#endif
+
+// Fallback font for characters the post fonts don't have: /fonts/fallback_<size>.bin
+// in LittleFS, built by tools/subset_fonts.py and uploaded with `pio run -t uploadfs`.
+// Each post size falls back to the file closest to it. The glyph index is loaded
+// into PSRAM at boot; bitmaps are read and unpacked on first use and kept in a
+// PSRAM cache of FONT_CACHE_SLOTS glyphs.
+#define FONT_FALLBACK_DIR "/fonts"
+#define FONT_FALLBACK_MAX 4      // Sizes loaded
+#ifndef FONT_CACHE_SLOTS
+#define FONT_CACHE_SLOTS 64
+#endif
+#define FONT_GLYPH_MAX_BYTES 2048  // Largest unpacked glyph (4 bpp): 64x64 px
+
+struct FontStats {
+    uint8_t fallbacks;        // Sizes loaded
+    uint32_t glyphs;          // In all loaded files
+    uint32_t indexBytes;      // PSRAM used by the indexes
+    uint32_t lookups;         // Characters the post fonts didn't have
+    uint32_t missing;         // Not in the fallback either (drawn as a box)
+    uint32_t hits;            // Bitmaps found in the cache
+    uint32_t misses;          // Bitmaps read from LittleFS
+    uint32_t bytesRead;
+    uint32_t maxLoadUs;       // Slowest bitmap read and unpack
+    uint64_t totalLoadUs;
+};
+
+// Loads the fallback fonts' indexes and attaches them to the post fonts. Call
+// before buildScreens(); without a fallback file the post fonts draw a box for
+// characters they don't have, as before.
+void fontFallbackBegin();
+
+const FontStats &fontStats();
+void printFontStats();
+
+#endif // FONTS_H
@@ -0,0 +1,77 @@
+#ifndef JETSTREAM_H
+#define JETSTREAM_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// Streaming mode: keep a WebSocket open to a Jetstream endpoint, filtered to
+// app.bsky.feed.post, and push posts tagged BLUESKY_SEARCH_TAG straight into the
+// post store as they're created. Polling continues at JETSTREAM_POLL_INTERVAL as
+// a safety net, and on the poll scheduler's interval whenever the stream is down.
+// Off by default: the unfiltered post stream is a steady 20-50 KB/s, which keeps
+// the radio awake.
+#ifndef JETSTREAM_ENABLED
+#define JETSTREAM_ENABLED 0
+#endif
+
+#ifndef JETSTREAM_URL
+#define JETSTREAM_URL "wss://jetstream2.us-east.bsky.network/subscribe"
+#endif
+
+// Root CA of the Jetstream host, PEM. Needed for wss:// URLs; the public
+// instances use Let's Encrypt (ISRG Root X1), which tools/ca_bundle.py puts in
+// the XRPC bundle along with the API hosts' roots.
+#ifndef JETSTREAM_CA_PEM
+#define JETSTREAM_CA_PEM XRPC_CA_PEM
+#endif
+
+// Handles and avatars for the DIDs the stream reports. Public AppView, no session needed.
+#ifndef JETSTREAM_PROFILE_URL
+#define JETSTREAM_PROFILE_URL "https://public.api.bsky.app/xrpc/app.bsky.actor.getProfile"
+#endif
+
+#ifndef JETSTREAM_POLL_INTERVAL
+#define JETSTREAM_POLL_INTERVAL 900000  // 15 minutes while the stream is live
+#endif
+
+// Reconnects resume from the last event seen, rewound a little so nothing at the
+// edge is lost (duplicates are dropped by the merge's seen set). After a longer
+// outage the stream starts live instead and a poll fills the gap, rather than
+// replaying minutes of the whole network's posts.
+#define JETSTREAM_REWIND_US 5000000ULL        // 5 seconds
+#define JETSTREAM_MAX_REPLAY_US 300000000ULL  // 5 minutes
+
+#define JETSTREAM_BACKOFF_BASE 1000
+#define JETSTREAM_BACKOFF_MAX 60000
+
+#define JETSTREAM_MESSAGE_MAX 16384  // Longer events (huge facets, embeds) are skipped
+#define JETSTREAM_MATCH_QUEUE 4      // Matches waiting for their author's profile
+#define JETSTREAM_PROFILE_CACHE 8
+
+#define JETSTREAM_TASK_STACK 8192
+#define JETSTREAM_TASK_PRIORITY 1
+#define JETSTREAM_TASK_CORE 0
+
+struct JetstreamStats {
+    uint32_t connects;
+    uint32_t disconnects;
+    uint32_t messages;
+    uint64_t bytes;
+    uint32_t oversized;      // Skipped, longer than JETSTREAM_MESSAGE_MAX
+    uint32_t replayed;       // Events older than the connection they arrived on
+    uint32_t prefilterHits;  // Contained the tag somewhere, so they were parsed
+    uint32_t matches;        // Tagged post creations
+    uint32_t dropped;        // Matches lost because the queue was full
+    uint32_t shown;          // Matches that made the top posts
+    uint32_t maxMatchUs;     // Longest tag check of one event, prefilter included
+    int64_t lagUs;           // Wall clock minus the last event's time_us
+};
+
+// Starts the connection task; does nothing unless JETSTREAM_ENABLED
+void startJetstream();
+bool jetstreamLive();  // Connected and receiving
+
+const JetstreamStats &jetstreamStats();
+void printJetstreamStats();
+
+#endif // JETSTREAM_H
@@ -0,0 +1,167 @@
+#ifndef JSON_STREAM_READER_H
+#define JSON_STREAM_READER_H
+
+#include <Arduino.h>
+
+// Buffered reader for ArduinoJson so the parser doesn't pull one byte per TLS read.
+// Only asks for what's already available so it never waits on a closed-out body.
+// Decodes chunked transfer encoding when the server sends it anyway. Given the
+// Content-Length (or chunked), it knows where the body ends, so the rest can be
+// drained and a kept-alive connection used for the next request.
+class JsonStreamReader {
+public:
+    explicit JsonStreamReader(Stream &stream, bool chunked = false, int length = -1)
+        : stream(stream), chunked(chunked), length(length) {}
+
+    int read() {
+        if (pos >= len && !fill()) return -1;
+        return (uint8_t)buf[pos++];
+    }
+
+    // Next byte without taking it, -1 at end of stream
+    int peek() {
+        if (pos >= len && !fill()) return -1;
+        return (uint8_t)buf[pos];
+    }
+
+    size_t readBytes(char *buffer, size_t length) {
+        size_t copied = 0;
+        while (copied < length) {
+            if (pos >= len && !fill()) break;
+            size_t n = min(length - copied, len - pos);
+            memcpy(buffer + copied, buf + pos, n);
+            pos += n;
+            copied += n;
+        }
+        return copied;
+    }
+
+    // Skips ahead until just past `target`, false if the stream ends first
+    bool find(const char *target) {
+        size_t matched = 0;
+        while (target[matched] != '\0') {
+            int c = read();
+            if (c < 0) return false;
+            if (c == target[matched]) {
+                matched++;
+            } else {
+                matched = (c == target[0]) ? 1 : 0;
+            }
+        }
+        return true;
+    }
+
+    // Skips ahead until just inside the array that is the value of `key`, allowing
+    // whitespace around the colon as pretty-printed JSON has it. NULL expects the
+    // body itself to be an array. False if there's no such array before the end.
+    bool findArray(const char *key) {
+        char quoted[32];
+        if (key != NULL) snprintf(quoted, sizeof(quoted), "\"%s\"", key);
+        for (;;) {
+            if (key != NULL) {
+                if (!find(quoted)) return false;
+                skipWhitespace();
+                if (peek() != ':') continue;  // A string value, not the key
+                read();
+            }
+            skipWhitespace();
+            if (peek() == '[') {
+                read();
+                return true;
+            }
+            if (key == NULL) return false;  // An error object, say
+        }
+    }
+
+    void skipWhitespace() {
+        for (int c = peek(); c == ' ' || c == '\t' || c == '\n' || c == '\r'; c = peek()) read();
+    }
+
+    // Skips ahead until one of `terminators`, returns it (or -1 at end of stream)
+    int skipUntil(const char *terminators) {
+        for (;;) {
+            int c = read();
+            if (c < 0 || strchr(terminators, c) != NULL) return c;
+        }
+    }
+
+    size_t bytesRead() const { return total; }
+
+    // True once the whole body is off the stream: the last chunk, or length bytes.
+    // Never for a body that ends when the server closes the connection.
+    bool finished() const { return ended; }
+
+    // Reads and drops the rest of the body, giving up after maxBytes; true if it got to the end
+    bool drain(size_t maxBytes) {
+        size_t dropped = 0;
+        pos = len;
+        while (!ended && dropped <= maxBytes && fill()) {
+            dropped += len;
+            pos = len;
+        }
+        return ended;
+    }
+
+private:
+    bool fill() {
+        pos = 0;
+        len = 0;
+        if (ended) return false;
+        if (chunked && chunkLeft == 0 && !readChunkHeader()) return false;
+
+        size_t want = stream.available();
+        if (want == 0) want = 1;  // Block (up to the stream timeout) for the next byte
+        if (want > sizeof(buf)) want = sizeof(buf);
+        if (chunked && want > chunkLeft) want = chunkLeft;
+        if (!chunked && length >= 0) {
+            if (total >= (size_t)length) {
+                ended = true;
+                return false;
+            }
+            if (want > length - total) want = length - total;
+        }
+        len = stream.readBytes(buf, want);
+        if (chunked) chunkLeft -= len;
+        total += len;
+        if (!chunked && length >= 0 && total >= (size_t)length) ended = true;
+        return len > 0;
+    }
+
+    // Reads "<hex size>[;ext]\r\n" (after the previous chunk's CRLF), false on the last chunk
+    bool readChunkHeader() {
+        size_t size = 0;
+        bool digits = false;
+        bool extension = false;
+        char c;
+        while (stream.readBytes(&c, 1) == 1) {
+            if (isxdigit((unsigned char)c) && !extension) {
+                size = size * 16 + (isdigit((unsigned char)c) ? c - '0' : (tolower(c) - 'a' + 10));
+                digits = true;
+            } else if (c == '\n' && digits) {
+                chunkLeft = size;
+                if (size == 0) {
+                    ended = true;
+                    stream.readBytes(&c, 1);  // The empty line after the last chunk
+                    stream.readBytes(&c, 1);
+                }
+                return size > 0;
+            } else if (c != '\r' && c != '\n') {
+                if (!digits) return false;  // Garbage where a chunk header should be
+                extension = true;           // ";name=value" is skipped until the newline
+            }
+        }
+        return false;
+    }
+
+    Stream &stream;
+    bool chunked;
+    int length;  // Content-Length, -1 if unknown
+    bool ended = false;
+    size_t chunkLeft = 0;
+    char buf[512];
+    size_t pos = 0;
+    size_t len = 0;
+    size_t total = 0;
+};
+
+#endif // JSON_STREAM_READER_H
@@ -7,10 +7,12 @@
 #define LV_COLOR_DEPTH 16
 #define LV_COLOR_16_SWAP 0
 
-/* Memory settings */
-#define LV_MEM_CUSTOM 0
-#define LV_MEM_SIZE (64 * 1024U)
-#define LV_MEM_ADR 0
+/* Memory settings: size-class slabs in internal RAM, large blocks in PSRAM (lvgl_pool.h) */
+#define LV_MEM_CUSTOM 1
+#define LV_MEM_CUSTOM_INCLUDE "lvgl_pool.h"
+#define LV_MEM_CUSTOM_ALLOC lvglPoolAlloc
+#define LV_MEM_CUSTOM_FREE lvglPoolFree
+#define LV_MEM_CUSTOM_REALLOC lvglPoolRealloc
 
 /* Display settings */
 #define LV_DISP_DEF_REFR_PERIOD 30
@@ -23,8 +25,26 @@
 #define LV_USE_OPA_SCALE 1
 #define LV_USE_IMG_TRANSFORM 1
 
-/* Font settings */
-#define LV_FONT_MONTSERRAT_14 1
+/* Font settings: only the sizes the screens use (fonts.h). tools/subset_fonts.py
+ * defines BADGE_FONTS_SUBSET when it has generated them as badge_font_<size>,
+ * in which case none of the built-in Montserrat fonts are compiled. */
+#ifdef BADGE_FONTS_SUBSET
+#define LV_FONT_MONTSERRAT_14 0
+#define LV_FONT_MONTSERRAT_16 0
+#define LV_FONT_MONTSERRAT_18 0
+#define LV_FONT_MONTSERRAT_20 0
+#define LV_FONT_MONTSERRAT_22 0
+#define LV_FONT_MONTSERRAT_24 0
+#define LV_FONT_MONTSERRAT_26 0
+#define LV_FONT_MONTSERRAT_28 0
+#define LV_FONT_MONTSERRAT_32 0
+#define LV_FONT_MONTSERRAT_36 0
+#define LV_FONT_MONTSERRAT_40 0
+#define LV_FONT_MONTSERRAT_48 0
+#define LV_FONT_CUSTOM_DECLARE LV_FONT_DECLARE(badge_font_16)
+#define LV_FONT_DEFAULT &badge_font_16
+#else
+#define LV_FONT_MONTSERRAT_14 0
 #define LV_FONT_MONTSERRAT_16 1
 #define LV_FONT_MONTSERRAT_18 1
 #define LV_FONT_MONTSERRAT_20 1
@@ -33,9 +53,11 @@
 #define LV_FONT_MONTSERRAT_26 1
 #define LV_FONT_MONTSERRAT_28 1
 #define LV_FONT_MONTSERRAT_32 1
-#define LV_FONT_MONTSERRAT_36 1
-#define LV_FONT_MONTSERRAT_40 1
+#define LV_FONT_MONTSERRAT_36 0
+#define LV_FONT_MONTSERRAT_40 0
 #define LV_FONT_MONTSERRAT_48 1
+#define LV_FONT_DEFAULT &lv_font_montserrat_16
+#endif
 
 /* Widget usage */
 #define LV_USE_ARC 1
@@ -58,6 +80,9 @@
 #define LV_USE_THEME_DEFAULT 1
 #define LV_USE_THEME_BASIC 1
 
+/* Others */
+#define LV_USE_SNAPSHOT 1  // Pre-renders the static screens
+
 /* Layout */
 #define LV_USE_FLEX 1
 #define LV_USE_GRID 1
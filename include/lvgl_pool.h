@@ -0,0 +1,72 @@
+#ifndef LVGL_POOL_H
+#define LVGL_POOL_H
+
+// LVGL's allocator (LV_MEM_CUSTOM in lv_conf.h). lv_mem.c includes this header,
+// so the part it needs is plain C.
+//
+// Small allocations, which are nearly all of a widget tree (objects, styles,
+// short label texts, timers, animations), come from size-class slabs in a static
+// internal RAM arena. Each slab holds blocks of one size, so freeing and
+// reallocating in any order can't split the arena into unusable holes: a freed
+// block is reused by the next allocation of its class, and an empty slab goes
+// back to the arena for any class. Anything larger than the biggest class (long
+// texts, image and draw buffers, snapshot contexts) goes to PSRAM.
+// Not thread-safe, like LVGL itself: only the UI task allocates.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef LVGL_POOL_ARENA_SIZE
+#define LVGL_POOL_ARENA_SIZE (48 * 1024U)  // Internal RAM for small blocks
+#endif
+#define LVGL_POOL_SLAB_SIZE 2048U
+#define LVGL_POOL_SLAB_COUNT (LVGL_POOL_ARENA_SIZE / LVGL_POOL_SLAB_SIZE)
+#define LVGL_POOL_CLASS_COUNT 9       // 16, 24, 32, 48, 64, 96, 128, 192, 256 bytes
+#define LVGL_POOL_SMALL_MAX 256       // Larger allocations go to PSRAM
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void *lvglPoolAlloc(size_t size);
+void lvglPoolFree(void *p);
+void *lvglPoolRealloc(void *p, size_t size);
+
+#ifdef __cplusplus
+}
+
+#include <lvgl.h>
+
+struct LvglPoolStats {
+    uint32_t allocs;
+    uint32_t frees;
+    uint32_t reallocs;
+    uint32_t failures;
+    uint32_t spills;          // Small allocations that found no free slab and went to PSRAM
+    uint32_t liveBlocks;      // Allocations not yet freed, both tiers
+    uint32_t smallBytes;      // Block bytes handed out from the arena
+    uint32_t smallPeak;
+    uint16_t slabsUsed;
+    uint16_t slabsPeak;
+    uint32_t largeBytes;      // Requested bytes of the PSRAM tier
+    uint32_t largePeak;
+    uint32_t largeInternal;   // Large allocations that found no PSRAM and went to internal heap
+    uint32_t largestFree;     // Longest run of free slabs in the arena, bytes
+    uint32_t classUsed[LVGL_POOL_CLASS_COUNT];  // Blocks in use per class
+    uint32_t classPeak[LVGL_POOL_CLASS_COUNT];
+};
+
+const LvglPoolStats &lvglPoolStats();
+uint16_t lvglPoolClassSize(int sizeClass);
+uint8_t lvglPoolFragPct(const LvglPoolStats &stats);  // Free slabs outside the longest free run
+
+// The pool in lv_mem_monitor()'s terms, which reports nothing with a custom
+// allocator. Total is the arena plus the PSRAM tier in use; only the arena has
+// free space. frag_pct is lvglPoolFragPct().
+void lvglPoolMonitor(lv_mem_monitor_t *mon);
+
+void printLvglPoolStats();
+
+#endif // __cplusplus
+
+#endif // LVGL_POOL_H
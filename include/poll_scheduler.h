@@ -0,0 +1,69 @@
+#ifndef POLL_SCHEDULER_H
+#define POLL_SCHEDULER_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// When the feed worker polls. The interval follows how fast new posts arrive:
+// it aims for POLL_TARGET_POSTS new posts per poll, between POLL_MIN_INTERVAL
+// and POLL_MAX_INTERVAL, starting at API_REFRESH_INTERVAL. A poll that brings
+// nothing halves the arrival rate estimate, so quiet periods stretch the
+// interval quickly. Failed polls back off exponentially with jitter instead,
+// and no poll goes out before the time a server asked for with Retry-After or
+// its ratelimit-* headers. While paused (screen dimmed) nothing is polled.
+#ifndef POLL_MIN_INTERVAL
+#define POLL_MIN_INTERVAL 30000    // 30 seconds, during a burst
+#endif
+#ifndef POLL_MAX_INTERVAL
+#define POLL_MAX_INTERVAL 600000   // 10 minutes, when nothing is happening
+#endif
+#ifndef POLL_TARGET_POSTS
+#define POLL_TARGET_POSTS 1.0f     // New posts a poll should find
+#endif
+#define POLL_RATE_SMOOTHING 0.5f   // Weight of the latest poll in the arrival rate
+#ifndef POLL_BACKOFF_MAX
+#define POLL_BACKOFF_MAX 1800000   // 30 minutes; backoff starts at POLL_MIN_INTERVAL
+#endif
+#ifndef POLL_RATE_RESERVE
+#define POLL_RATE_RESERVE 10       // Below this many requests left, spread them over the rate window
+#endif
+#ifndef POLL_PAUSE_WHEN_DIMMED
+#define POLL_PAUSE_WHEN_DIMMED 1   // No polling at the lowest brightness
+#endif
+
+struct PollStats {
+    uint32_t polls;         // Refreshes run
+    uint32_t requests;      // Feed requests sent, all sources
+    uint32_t newPosts;
+    uint32_t wastedPolls;   // Succeeded but brought nothing new
+    uint32_t failedPolls;   // A source failed: network error, 5xx, 429, bad body or no session
+    uint32_t rateLimited;   // 429 answers
+    uint32_t serverHolds;   // Polls delayed by Retry-After or ratelimit-*
+    uint32_t freshPosts;    // Posts created since the previous poll, the ones lag is measured on
+    uint32_t lastLagMs;     // Freshness lag: post created to merged
+    uint32_t maxLagMs;
+    uint64_t totalLagMs;
+    uint64_t pausedMs;      // Time spent paused
+    float postsPerMin;      // Arrival rate estimate
+    uint32_t intervalMs;    // Wait after the last poll
+    uint8_t failures;       // Consecutive failed polls
+};
+
+// fetchFeeds() brackets every refresh with these
+void pollFetchBegin();
+void pollFetchPost(int64_t createdAtMs);  // Every new post merged
+void pollFetchEnd(int requests, bool failed, int rateLimited, uint32_t serverWaitMs);
+
+uint32_t pollIntervalMs();  // Wait after the last poll, from the arrival rate or the backoff
+// Time left until the next poll is due, intervalMs after the last one and never
+// before the server's hold. force (an explicit refresh) skips the interval only.
+uint32_t pollDueInMs(uint32_t intervalMs, bool force);
+
+void setPollingPaused(bool paused);  // Any task
+bool pollingPaused();
+
+const PollStats &pollStats();
+void resetPollStats();  // Also forgets the arrival rate and backoff
+void printPollStats();
+
+#endif // POLL_SCHEDULER_H
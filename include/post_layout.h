@@ -0,0 +1,49 @@
+#ifndef POST_LAYOUT_H
+#define POST_LAYOUT_H
+
+#include <Arduino.h>
+#include <lvgl.h>
+#include "config.h"
+
+// Text box of the post screens: the panel's content area below the author line.
+// buildPostScreen() sizes the text label to exactly this.
+#define POST_TEXT_WIDTH (SCREEN_WIDTH - 20)
+#define POST_TEXT_HEIGHT (SCREEN_HEIGHT - 42)
+#define POST_TEXT_LINE_SPACE 3
+
+// Posts that don't fit the box even at 16 px are split into pages of whole lines
+// instead of being cut, and the post screen slides from page to page (screens.h).
+// Set to 1 to cut them with an ellipsis on the first page.
+#ifndef POST_MAX_PAGES
+#define POST_MAX_PAGES 3
+#endif
+
+// Result of laying out one post. The laid-out text has a hard line break at every
+// wrap point, so it fits the box at this font size without further wrapping.
+struct PostLayout {
+    uint8_t fontSize;    // Font size in px, 0 until a post has been laid out
+    uint8_t lines;       // All pages together
+    uint8_t pages;       // 1 unless it overflowed the box at 16 px
+    bool truncated;      // Didn't fit POST_MAX_PAGES pages at the smallest size; ends in an ellipsis
+    uint16_t sourceBytes;  // Bytes of the original text that were kept
+    uint32_t layoutUs;
+};
+
+// Picks the largest font size (28 down to 16 px) at which text fits the box,
+// wraps it there, pages it at 16 if it still doesn't fit, and cuts it with an
+// ellipsis if it doesn't fit POST_MAX_PAGES pages.
+// Safe to call from the network worker: it measures with private copies of the
+// fonts, so it never touches glyph caches the UI task is using.
+void layoutPostText(char *dest, size_t size, const char *text, PostLayout &layout);
+
+const lv_font_t *postLayoutFont(uint8_t fontSize);  // The UI's font for a layout's size
+int postLayoutLinesPerPage(uint8_t fontSize);
+
+// Attaches fallback(size) as the fallback font of the post font of each size, for
+// both the UI and layout. Call before the first layout (fontFallbackBegin() does).
+void postLayoutSetFallback(const lv_font_t *(*fallback)(uint8_t fontSize));
+
+// Copies the lines of one page of laid-out text into dest
+void postLayoutPage(char *dest, size_t size, const char *text, const PostLayout &layout, int page);
+
+#endif // POST_LAYOUT_H
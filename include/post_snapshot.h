@@ -0,0 +1,31 @@
+#ifndef POST_SNAPSHOT_H
+#define POST_SNAPSHOT_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// Shortest time between two snapshot writes, to limit flash wear. A newer post
+// set that arrives sooner is written once the interval has passed.
+#ifndef SNAPSHOT_MIN_INTERVAL
+#define SNAPSHOT_MIN_INTERVAL 600000  // 10 minutes
+#endif
+
+// The last published post set, laid out, kept in LittleFS as /posts.bin so the
+// post screens have content the moment the badge boots.
+//
+// Format (little endian), version 2:
+//   header  magic "BPS1", u16 version, u16 count, u16 text box width, u16 text box
+//           height, u32 saved at (Unix seconds, 0 without a clock), u32 payload
+//           length, u32 CRC-32 of the payload
+//   post    u8 font size, u8 lines, u8 truncated, u8 pages (0 = 1), u16 source bytes,
+//           u32 avatar key, u16 reserved, s64 created at (Unix ms), u16 author
+//           length, author, u16 text length, text
+// Version 1 has no created at; its posts rank below anything newer after a restore.
+// Snapshots laid out for a different text box are ignored.
+bool restorePostSnapshot();  // setup(): publishes the saved set and seeds the writer's top with it
+
+// Network worker: after publishing a new set, then after every fetch
+void schedulePostSnapshot();
+void writePostSnapshotIfDue();
+
+#endif // POST_SNAPSHOT_H
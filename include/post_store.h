@@ -0,0 +1,66 @@
+#ifndef POST_STORE_H
+#define POST_STORE_H
+
+#include <Arduino.h>
+#include "post_layout.h"
+
+// Number of post screens (screens 3-5)
+#define DISPLAY_POST_COUNT 3
+
+// Fixed slot sizes. Longer values are cut at a UTF-8 character boundary.
+#define POST_AUTHOR_MAX 72   // "@" + handle + NUL; real handles are rarely over 40
+#define POST_TEXT_MAX 1280   // Bluesky caps posts at 300 graphemes
+#define POST_HANDLE_SLOTS 32 // Interned author handles kept by the writer
+
+// One complete set of posts as shown on the post screens. Texts are already laid
+// out (post_layout.h), so the UI only sets the font and the text.
+struct PostSet {
+    char authors[DISPLAY_POST_COUNT][POST_AUTHOR_MAX];
+    char texts[DISPLAY_POST_COUNT][POST_TEXT_MAX];
+    PostLayout layouts[DISPLAY_POST_COUNT];
+    uint32_t avatarKeys[DISPLAY_POST_COUNT];  // avatars.h cache keys, 0 for none
+    int count;
+    uint32_t generation;
+};
+
+// Allocates every buffer the store uses, once, in PSRAM when there is some.
+// Call from setup() before anything else touches the store.
+bool postStoreInit();
+
+// Double-buffered handoff between the network worker (writer) and the UI loop (reader).
+// The writer fills the back buffer and publishes it; the UI swaps it in when it's ready.
+// Neither side takes a lock and the UI never sees a half-written set.
+PostSet &postStoreBeginWrite();   // Writer: back buffer to fill (reclaims an unread publish)
+void postStorePublish();          // Writer: hand the back buffer to the UI
+bool postStoreAcquire();          // UI: swap in a newly published set, true if there was one
+const PostSet &postStoreFront();  // UI: the set currently being displayed
+
+// Writer-side newest-first top DISPLAY_POST_COUNT. Posts live in fixed slots and
+// only slot indices move, so offering a post never allocates or copies other posts.
+// A post is laid out once when it enters the top; publishing reuses that layout.
+bool postStoreOffer(const char *handle, const char *text, int64_t createdAtMs, uint32_t avatarKey);  // True if it made the top
+int postStorePublishTop();  // Copies the top posts into the back buffer and publishes; returns the count
+void postStoreClearTop();
+// Seeds the top from a restored set (newest first, texts already laid out), so
+// posts offered after boot are ranked against it instead of replacing it
+void postStoreRestoreTop(const PostSet &posts, const int64_t *createdAtMs);
+
+// Writer-side read access to the current top, e.g. for persisting it
+struct PostView {
+    const char *author;
+    const char *text;  // Laid out
+    PostLayout layout;
+    uint32_t avatarKey;
+    int64_t createdAtMs;
+};
+int postStoreTopCount();
+PostView postStoreTopPost(int index);
+
+// Milliseconds since the Unix epoch for an ISO 8601 timestamp such as
+// "2025-11-08T18:30:00.123Z" or "...+02:00"; 0 if it can't be parsed
+int64_t parseIsoTimestamp(const char *text);
+
+// strlcpy that never splits a multi-byte UTF-8 character; returns the bytes copied
+size_t copyUtf8(char *dest, size_t size, const char *src);
+
+#endif // POST_STORE_H
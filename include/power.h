@@ -0,0 +1,84 @@
+#ifndef POWER_H
+#define POWER_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// CPU clock range for dynamic frequency scaling
+#ifndef POWER_MAX_CPU_MHZ
+#define POWER_MAX_CPU_MHZ 240
+#endif
+#ifndef POWER_MIN_CPU_MHZ
+#define POWER_MIN_CPU_MHZ 80  // Lowest clock that keeps the PLL (WiFi, I80 bus) running
+#endif
+
+// Automatic light sleep while every task is idle. It needs tickless idle in the
+// SDK config. Without it the badge logs that and uses frequency scaling only.
+#ifndef POWER_LIGHT_SLEEP
+#define POWER_LIGHT_SLEEP 1
+#endif
+
+#define POWER_MAX_SLEEP_MS 1000  // Longest render loop sleep, so serial commands are still read
+
+#ifndef POWER_REPORT_INTERVAL
+#define POWER_REPORT_INTERVAL 60000  // 1 minute
+#endif
+
+// Current model for the estimate, in mA at the battery. These are rough figures for
+// the T-Display S3; measure yours with a USB power meter and override them in config.h.
+#ifndef POWER_MA_RENDER
+#define POWER_MA_RENDER 55      // CPU at full clock rendering and flushing a frame
+#endif
+#ifndef POWER_MA_AWAKE
+#define POWER_MA_AWAKE 40       // Render loop running with nothing to draw
+#endif
+#ifndef POWER_MA_NETWORK
+#define POWER_MA_NETWORK 110    // Radio busy: a fetch or a WiFi connect
+#endif
+#ifndef POWER_MA_LIGHT_SLEEP
+#define POWER_MA_LIGHT_SLEEP 8  // Light sleep, averaged with WiFi modem sleep's DTIM wakeups
+#endif
+#ifndef POWER_MA_IDLE
+#define POWER_MA_IDLE 28        // Idle at POWER_MIN_CPU_MHZ when light sleep isn't available
+#endif
+#ifndef POWER_MA_BACKLIGHT
+#define POWER_MA_BACKLIGHT 75   // Backlight at 100%, scaled by the PWM duty
+#endif
+#ifndef POWER_BATTERY_MAH
+#define POWER_BATTERY_MAH 1000
+#endif
+
+#define POWER_BACKLIGHT_CHANNEL 0  // LEDC channel main.cpp drives the backlight on
+
+enum PowerState {
+    POWER_STATE_RENDER,   // Render loop awake and LVGL drew a frame
+    POWER_STATE_AWAKE,    // Render loop awake, nothing drawn
+    POWER_STATE_NETWORK,  // Render loop asleep while a fetch or WiFi connect runs
+    POWER_STATE_SLEEP,    // Everything idle: light sleep, or the lowest DFS clock
+    POWER_STATE_COUNT
+};
+
+// Accumulated since the last report (interval) or since boot (total)
+struct PowerStats {
+    uint64_t stateUs[POWER_STATE_COUNT];
+    uint64_t chargeMaUs;    // Estimated charge, mA * us, backlight included
+    uint32_t eventWakeups;  // Sleeps ended by powerWake() or a button
+    uint32_t timerWakeups;  // Sleeps that ran to the deadline
+};
+
+// Render loop governor. loop() does its work and then calls powerIdle() instead
+// of delay(): the loop sleeps until the next LVGL timer or button gesture timeout
+// is due, a button edge arrives or another task calls powerWake(). The display
+// refresh timer is paused while nothing is dirty, so a static screen only wakes
+// the loop once per POWER_MAX_SLEEP_MS.
+void powerBegin();  // Call from setup(), on the render loop's task
+void powerWake();   // Any task: something the UI shows has changed
+void powerWakeFromISR(BaseType_t *woken);
+void powerIdle();   // Also prints the periodic report
+
+bool powerLightSleepEnabled();
+const PowerStats &powerStats();  // Since boot
+uint32_t powerEstimatedMa(const PowerStats &stats);
+void printPowerReport();
+
+#endif // POWER_H
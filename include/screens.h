@@ -0,0 +1,53 @@
+#ifndef SCREENS_H
+#define SCREENS_H
+
+#include <lvgl.h>
+#include "config.h"
+#include "post_store.h"
+
+#define SCREEN_COUNT 7
+
+#ifndef TRANSITION_DURATION
+#define TRANSITION_DURATION 500  // milliseconds
+#endif
+
+// Animation used between screens (any lv_scr_load_anim_t), lasts TRANSITION_DURATION
+#ifndef SCREEN_TRANSITION_ANIM
+#define SCREEN_TRANSITION_ANIM LV_SCR_LOAD_ANIM_MOVE_LEFT
+#endif
+
+// Screens that never change (welcome, name, QR, CTA) are rendered once at boot into
+// a PSRAM frame and shown by blitting it to the panel, skipping LVGL's draw pipeline.
+// They appear with a cut instead of SCREEN_TRANSITION_ANIM. Set to 0 to draw them
+// with LVGL like the post screens.
+#ifndef STATIC_SCREEN_BLIT
+#define STATIC_SCREEN_BLIT 1
+#endif
+
+// Posts laid out over several pages (post_layout.h) stay on each page for
+// POST_PAGE_DWELL_MS, then the next page slides in with the panel's hardware
+// scroll, POST_PAGE_STEP_COLUMNS new columns every POST_PAGE_STEP_MS. The last
+// page stays up until the screen changes.
+#ifndef POST_PAGE_DWELL_MS
+#define POST_PAGE_DWELL_MS 5000
+#endif
+#ifndef POST_PAGE_STEP_MS
+#define POST_PAGE_STEP_MS 16
+#endif
+#ifndef POST_PAGE_STEP_COLUMNS
+#define POST_PAGE_STEP_COLUMNS 16  // 20 steps, about a third of a second per slide
+#endif
+
+// All screens are built once at boot and kept alive. Switching only loads the
+// prebuilt screen; post screens are updated in place when new posts arrive.
+void buildScreens();
+void buildScreen(int screen);  // (Re)builds one screen; it must not be the active one
+void showScreen(int screen);
+void updatePostScreens(const PostSet &posts);
+void updatePostAvatars(const PostSet &posts);  // After avatarGeneration() changes
+lv_obj_t *screenObject(int screen);
+int screenPages(int screen);  // Pages the screen slides through, 1 unless it shows a long post
+const lv_color_t *staticScreenFrame(int screen);  // NULL if LVGL draws this screen
+uint32_t staticScreenRenderUs(int screen);        // LVGL render time the blit saves on every show
+
+#endif // SCREENS_H
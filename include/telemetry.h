@@ -0,0 +1,46 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <Arduino.h>
+
+// How often the compact memory line is printed
+#ifndef TELEMETRY_REPORT_INTERVAL
+#define TELEMETRY_REPORT_INTERVAL 60000  // 1 minute
+#endif
+
+// Subsystems whose heap use is tracked
+enum TelemetryScope {
+    TELEMETRY_FETCH,         // Whole fetch: session, TLS, HTTP, parse
+    TELEMETRY_PARSE,         // Streaming JSON parse of a searchPosts response
+    TELEMETRY_SCREEN_BUILD,  // Building one screen's widget tree
+    TELEMETRY_QR,            // QR encode and image generation
+    TELEMETRY_SCOPE_COUNT
+};
+
+// One snapshot of every heap the badge cares about
+struct MemorySample {
+    uint32_t uptimeSec;
+    uint32_t internalFree;
+    uint32_t internalLargest;
+    uint32_t dmaFree;
+    uint32_t dmaLargest;
+    uint32_t psramFree;
+    uint32_t psramLargest;
+    uint32_t lvglUsed;
+    uint32_t lvglLargest;
+    uint8_t lvglFragPct;
+};
+
+// Per-subsystem heap high-water marks. A scope's use is the drop in free internal
+// heap between telemetryBegin() and the lowest point sampled before telemetryEnd().
+// Scopes run on different tasks, so concurrent allocations can inflate the numbers.
+void telemetryBegin(TelemetryScope scope);
+void telemetrySample(TelemetryScope scope);  // Call at likely peaks inside a scope
+void telemetryEnd(TelemetryScope scope);
+
+MemorySample sampleMemory();
+void telemetryUpdate();                 // Call from loop(); keeps history and prints the periodic line
+void printTelemetryReport(bool full);   // Compact one-liner, or everything including history
+void resetTelemetryHighWater();
+
+#endif // TELEMETRY_H
@@ -0,0 +1,63 @@
+#ifndef WIFI_MANAGER_H
+#define WIFI_MANAGER_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// Extra networks, tried in order after WIFI_SSID. Define WIFI_SSID_2 /
+// WIFI_PASSWORD_2 and WIFI_SSID_3 / WIFI_PASSWORD_3 in config.h to use them.
+
+// How long one connection attempt may take
+#ifndef WIFI_CONNECT_TIMEOUT
+#define WIFI_CONNECT_TIMEOUT 15000       // Scan, associate and DHCP
+#endif
+#define WIFI_FAST_CONNECT_TIMEOUT 3000   // Cached BSSID/channel (and lease); falls back to a full attempt
+
+// Backoff after every configured network has failed: doubles from the base up to
+// the max, plus up to 25% random jitter so a room full of badges doesn't retry in step
+#define WIFI_BACKOFF_BASE 1000
+#define WIFI_BACKOFF_MAX 60000
+
+// A cached DHCP lease is reused until half of the time the server granted has
+// passed, then DHCP confirms it in the background. This needs a valid clock, so it
+// only applies after a soft reset. After a power cycle the badge always asks DHCP,
+// but still skips the scan.
+
+#define WIFI_TASK_STACK 4096
+#define WIFI_TASK_PRIORITY 2
+#define WIFI_TASK_CORE 0
+
+enum WifiState {
+    WIFI_STATE_CONNECTING,
+    WIFI_STATE_CONNECTED,  // Associated and has an IP
+    WIFI_STATE_BACKOFF,
+};
+
+struct WifiStats {
+    uint32_t attempts;
+    uint32_t fastAttempts;       // Used the cached BSSID/channel
+    uint32_t connects;
+    uint32_t fastConnects;
+    uint32_t disconnects;        // Drops after being connected
+    uint32_t timeToNetworkMs;    // Boot to first IP, 0 until then
+    uint32_t lastConnectMs;      // Start of the successful attempt to IP
+    uint32_t bestConnectMs;
+    uint64_t totalConnectMs;
+    uint32_t lastOutageMs;       // Drop to IP again
+    uint32_t maxOutageMs;
+    uint8_t lastDisconnectReason;  // wifi_err_reason_t
+};
+
+// Event-driven connection manager. Connects in the background on its own task,
+// retries with backoff across the configured networks and reconnects after a
+// drop. BSSID, channel and DHCP lease are cached in NVS for fast reconnects.
+void startWifiManager();
+bool wifiConnected();
+bool waitForWifi(uint32_t timeoutMs);  // Blocks the calling task until connected
+WifiState wifiState();
+const char *wifiNetworkName();  // SSID being used or tried
+
+const WifiStats &wifiStats();
+void printWifiStats();
+
+#endif // WIFI_MANAGER_H
@@ -0,0 +1,194 @@
+#ifndef XRPC_CLIENT_H
+#define XRPC_CLIENT_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <HTTPClient.h>
+#include <mbedtls/ssl.h>
+#include <mbedtls/net_sockets.h>
+#include "config.h"
+#include "json_stream_reader.h"
+
+// Shared HTTP client for the XRPC and Mastodon APIs. Connections are pooled per
+// host and kept alive between requests, so a refresh that follows soon after the
+// last one skips DNS, TCP and TLS altogether. When a new connection is needed,
+// the TLS session (session ID or ticket) from the last full handshake with that
+// host is offered for an abbreviated handshake; sessions are kept in NVS, so the
+// first request after a reboot can resume too.
+//
+// Servers are verified against XRPC_CA_PEM. tools/ca_bundle.py builds it at
+// compile time from the roots of the hosts in the config and fails the build if
+// it can't. Without a bundle, TLS connections are refused, unless the build opted
+// out with XRPC_ALLOW_UNVERIFIED=1 in the environment: then they are encrypted
+// but unverified and a warning says so.
+#ifndef XRPC_CA_PEM
+#ifdef XRPC_CA_BUNDLE
+extern "C" const char xrpc_ca_bundle[];
+#define XRPC_CA_PEM xrpc_ca_bundle
+#else
+#define XRPC_CA_PEM NULL
+#endif
+#endif
+
+#ifndef XRPC_ALLOW_UNVERIFIED
+#define XRPC_ALLOW_UNVERIFIED 0  // Defined to 1 by tools/ca_bundle.py on an explicit opt-out
+#endif
+
+#define XRPC_POOL_SIZE 7  // Every feed source at once, plus the session, profile lookups and avatars
+#ifndef XRPC_KEEP_ALIVE_MS
+#define XRPC_KEEP_ALIVE_MS 60000   // Idle connections older than this are closed, not reused
+#endif
+#ifndef XRPC_TLS_PERSIST
+#define XRPC_TLS_PERSIST 1         // Keep TLS sessions in NVS across reboots
+#endif
+#define XRPC_TLS_CACHE_HOSTS 4
+#define XRPC_TLS_SESSION_MAX 4096  // Bytes of NVS per host: the session and the server's certificate
+#define XRPC_TLS_SAVE_INTERVAL 600000  // At most one NVS write per host every 10 minutes
+#define XRPC_DRAIN_MAX 16384       // An unread rest of a body up to this is read off to keep the connection
+#define XRPC_RX_BUFFER 512
+#define XRPC_MAX_HEADERS 4         // Request headers, replayed if the request has to be retried
+
+// Where one request's time went. The connect phases are 0 on a kept-alive connection.
+struct XrpcTiming {
+    uint32_t dnsUs;
+    uint32_t tcpUs;
+    uint32_t tlsUs;
+    uint32_t firstByteUs;  // Request sent to response headers read
+    uint32_t bodyUs;       // Headers read to end()
+    bool reused;           // Kept-alive connection
+    bool resumed;          // New connection with an abbreviated TLS handshake
+};
+
+struct XrpcStats {
+    uint32_t requests;
+    uint32_t reused;
+    uint32_t connects;
+    uint32_t fullHandshakes;
+    uint32_t resumedHandshakes;
+    uint32_t failedConnects;  // DNS, TCP or TLS
+    uint32_t verifyFailures;  // Server certificate not signed by the CA bundle
+    uint32_t retries;         // Kept-alive connection the server had closed
+    uint32_t drained;         // Connections kept by reading off an unread body
+    uint32_t sessionsRestored;  // TLS sessions loaded from NVS
+    uint32_t sessionsSaved;
+    uint64_t dnsUs;           // Totals, for averages
+    uint64_t tcpUs;
+    uint64_t fullTlsUs;
+    uint64_t resumedTlsUs;
+    uint64_t firstByteUs;
+    uint64_t bodyUs;
+    uint8_t caCerts;          // Roots in the pinned bundle, 0 if unverified
+};
+
+// A WiFiClient over lwIP sockets and mbed TLS, so the TLS session can be cached.
+// HTTPClient drives it through the WiFiClient interface.
+class XrpcTransport : public WiFiClient {
+public:
+    XrpcTransport();
+    ~XrpcTransport();
+
+    int connect(IPAddress ip, uint16_t port) override;
+    int connect(IPAddress ip, uint16_t port, int32_t timeoutMs) override;
+    int connect(const char *host, uint16_t port) override;
+    int connect(const char *host, uint16_t port, int32_t timeoutMs) override;
+    size_t write(uint8_t data) override;
+    size_t write(const uint8_t *buf, size_t size) override;
+    int available() override;
+    int read() override;
+    int read(uint8_t *buf, size_t size) override;
+    int peek() override;
+    void flush() override;
+    void stop() override;
+    uint8_t connected() override;
+    int setTimeout(uint32_t seconds) override;
+
+    void setSecure(bool secure) { this->secure = secure; }
+    // Phases of the last connect, if one was tried since the last call
+    bool takeConnectTiming(XrpcTiming &out);
+    uint32_t received() const { return bytesIn; }  // Bytes read off the connection, ever
+
+private:
+    bool open(IPAddress ip, int32_t timeoutMs);
+    bool handshake(int32_t timeoutMs);
+    bool waitFor(bool writable, uint32_t timeoutMs);
+    int receive(uint8_t *buf, size_t size);
+    bool fill(uint32_t waitMs);
+
+    mbedtls_net_context net;
+    mbedtls_ssl_context ssl;
+    bool sslReady = false;
+    bool secure = true;
+    bool peerClosed = false;
+    bool connectTried = false;
+    bool untrusted = false;  // The last handshake failed on the server's certificate
+    uint32_t ioTimeoutMs = 5000;
+    char host[64];
+    uint16_t port = 0;
+    uint8_t rx[XRPC_RX_BUFFER];
+    size_t rxPos = 0;
+    size_t rxLen = 0;
+    uint32_t bytesIn = 0;
+    XrpcTiming timing;
+};
+
+struct XrpcConnection;
+
+// One request on a pooled connection, used like HTTPClient:
+//   XrpcClient xrpc;
+//   xrpc.begin(url);
+//   xrpc.addHeader("Authorization", "Bearer " + token);
+//   if (xrpc.GET() == HTTP_CODE_OK) {
+//       JsonStreamReader body = xrpc.body();
+//       deserializeJson(doc, body);
+//       xrpc.end(&body);  // Reads off what's left, so the connection can stay open
+//   }
+// end() is also called by the destructor. Any task; each request holds its own
+// connection until end().
+class XrpcClient {
+public:
+    ~XrpcClient() { end(); }
+
+    bool begin(const String &url, uint16_t timeoutMs = 10000);  // false if every connection is busy
+    void addHeader(const char *name, const String &value);
+    void collectHeaders(const char *keys[], size_t count);  // Transfer-Encoding is always collected
+    int GET();
+    int POST(const String &payload);
+
+    HTTPClient &http();  // Response headers and size; valid between begin() and end()
+    bool chunked();
+    JsonStreamReader body();  // Response body, de-chunked and bounded by Content-Length
+    String getString();
+    void end(JsonStreamReader *body = NULL);
+
+    const XrpcTiming &timing() const { return requestTiming; }
+
+private:
+    int send(const char *type, const String &payload);
+
+    XrpcConnection *connection = NULL;
+    String url;
+    uint16_t timeoutMs = 10000;
+    int httpCode = 0;
+    String headerNames[XRPC_MAX_HEADERS];
+    String headerValues[XRPC_MAX_HEADERS];
+    int headerCount = 0;
+    const char *collected[XRPC_MAX_HEADERS + 1];
+    size_t collectedCount = 0;
+    bool bodyRead = false;
+    uint32_t headersAt = 0;
+    XrpcTiming requestTiming = {};
+};
+
+void xrpcInit();  // Before the first request: CA bundle, TLS config, session cache
+void xrpcCloseIdle();  // Drops kept-alive connections, e.g. before a long sleep
+
+// For the fetch benchmark: compare new connections, resumed ones and kept-alive ones
+void xrpcSetKeepAlive(bool keepAlive);
+void xrpcSetResumption(bool resumption);
+
+const XrpcStats &xrpcStats();
+void resetXrpcStats();
+void printXrpcStats();
+void printXrpcTiming(const XrpcTiming &timing);  // One request's phases, on the current line
+
+#endif // XRPC_CLIENT_H
@@ -0,0 +1,446 @@
+#include "avatars.h"
+#include <WiFi.h>
+#include <LittleFS.h>
+#include <TJpg_Decoder.h>
+#include <atomic>
+#include "power.h"
+#include "xrpc_client.h"
+
+#define AVATAR_DIR "/avatars"
+#define AVATAR_FILE_MAGIC 0x31545641  // "AVT1"
+#define AVATAR_HOLDERS 8
+
+enum AvatarState : uint8_t {
+    AVATAR_EMPTY,
+    AVATAR_LOADING,  // Owned by the avatar task until it's ready
+    AVATAR_READY,
+};
+
+struct AvatarSlot {
+    uint32_t key;
+    uint32_t lastUsed;
+    uint8_t state;
+    uint8_t pins;  // Post screens currently showing it
+    lv_img_dsc_t image;
+    uint16_t pixels[AVATAR_SIZE * AVATAR_SIZE];
+};
+
+struct AvatarRequest {
+    uint32_t key;
+    char url[AVATAR_URL_MAX];
+};
+
+// Disk cache file: header followed by the thumbnail pixels. check is a second
+// hash of the URL, so a file name (key) collision reads as a miss.
+struct AvatarFileHeader {
+    uint32_t magic;
+    uint32_t key;
+    uint32_t check;
+    uint16_t size;
+    uint16_t reserved;
+};
+
+static AvatarSlot *slots = NULL;     // PSRAM
+static uint8_t *jpegBuffer = NULL;   // PSRAM, one download at a time
+static uint16_t *decodeBuffer = NULL;  // PSRAM, scaled JPEG before downscaling
+static uint16_t decodeWidth = 0;
+static uint16_t decodeHeight = 0;
+
+static TaskHandle_t avatarTask = NULL;
+static QueueHandle_t avatarQueue = NULL;
+static portMUX_TYPE avatarLock = portMUX_INITIALIZER_UNLOCKED;  // Slot metadata, pins and stats
+static int holderSlots[AVATAR_HOLDERS];
+static uint32_t useClock = 0;
+static std::atomic<uint32_t> readyGeneration(0);
+static AvatarStats stats;
+
+static bool diskReady = false;
+static int diskFiles = 0;
+
+// djb2, independent of the FNV-1a key
+static uint32_t urlCheck(const char *url) {
+    uint32_t hash = 5381;
+    while (*url) hash = hash * 33 + (uint8_t)*url++;
+    return hash;
+}
+
+// The CDN serves a small rendition of every avatar under avatar_thumbnail
+static const char *thumbnailUrl(const char *url) {
+    static const char prefix[] = AVATAR_CDN_URL "/img/avatar/";
+    static char thumbnail[AVATAR_URL_MAX + 16];
+    if (strncmp(url, prefix, strlen(prefix)) != 0) return url;
+    snprintf(thumbnail, sizeof(thumbnail), "%s/img/avatar_thumbnail/%s", AVATAR_CDN_URL, url + strlen(prefix));
+    return thumbnail;
+}
+
+// Finds key, or claims the least recently used slot no post screen is showing.
+// Returns -1 if key is already loaded (or nothing can be evicted).
+static int claimSlot(uint32_t key) {
+    int victim = -1;
+    portENTER_CRITICAL(&avatarLock);
+    for (int i = 0; i < AVATAR_CACHE_SLOTS; i++) {
+        AvatarSlot &slot = slots[i];
+        if (slot.key == key && slot.state == AVATAR_READY) {
+            slot.lastUsed = ++useClock;
+            stats.memoryHits++;
+            portEXIT_CRITICAL(&avatarLock);
+            return -1;
+        }
+        if (slot.pins > 0 || slot.state == AVATAR_LOADING) continue;
+        if (victim < 0 || slot.lastUsed < slots[victim].lastUsed) victim = i;
+    }
+    if (victim >= 0) {
+        slots[victim].key = key;
+        slots[victim].state = AVATAR_LOADING;
+    }
+    portEXIT_CRITICAL(&avatarLock);
+    return victim;
+}
+
+static void finishSlot(AvatarSlot &slot, bool ok) {
+    portENTER_CRITICAL(&avatarLock);
+    slot.state = ok ? AVATAR_READY : AVATAR_EMPTY;
+    slot.lastUsed = ++useClock;
+    if (!ok) {
+        slot.key = 0;
+        stats.failures++;
+    }
+    portEXIT_CRITICAL(&avatarLock);
+    if (ok) {
+        readyGeneration.fetch_add(1, std::memory_order_release);
+        powerWake();
+    }
+}
+
+static void avatarPath(char *path, size_t size, uint32_t key, const char *suffix) {
+    snprintf(path, size, AVATAR_DIR "/%08x.%s", (unsigned)key, suffix);
+}
+
+// check is skipped for key-only requests, which have no URL to hash
+static bool readDiskAvatar(AvatarSlot &slot, bool hasUrl, uint32_t check) {
+    if (!diskReady) return false;
+    char path[32];
+    avatarPath(path, sizeof(path), slot.key, "bin");
+    File file = LittleFS.open(path, "r");
+    if (!file) return false;
+
+    AvatarFileHeader header;
+    bool ok = file.read((uint8_t *)&header, sizeof(header)) == sizeof(header) &&
+              header.magic == AVATAR_FILE_MAGIC && header.key == slot.key &&
+              (!hasUrl || header.check == check) && header.size == AVATAR_SIZE &&
+              file.read((uint8_t *)slot.pixels, sizeof(slot.pixels)) == sizeof(slot.pixels);
+    file.close();
+    return ok;
+}
+
+// Removes one cached file other than keep. LittleFS has no access times, so this
+// is whichever file the directory listing returns first.
+static void evictDiskAvatar(const char *keep) {
+    File dir = LittleFS.open(AVATAR_DIR);
+    File file = dir.openNextFile();
+    while (file) {
+        String path = String(AVATAR_DIR "/") + file.name();
+        file.close();
+        if (!path.endsWith(keep)) {
+            if (LittleFS.remove(path)) diskFiles--;
+            break;
+        }
+        file = dir.openNextFile();
+    }
+    dir.close();
+}
+
+// Written to a temporary file and renamed, so a reset mid-write never leaves a torn thumbnail
+static void writeDiskAvatar(const AvatarSlot &slot, uint32_t check) {
+    if (!diskReady) return;
+    char path[32];
+    char tempPath[32];
+    avatarPath(path, sizeof(path), slot.key, "bin");
+    avatarPath(tempPath, sizeof(tempPath), slot.key, "tmp");
+
+    if (diskFiles >= AVATAR_DISK_FILES) evictDiskAvatar(path + strlen(AVATAR_DIR "/"));
+
+    File file = LittleFS.open(tempPath, "w");
+    if (!file) return;
+    AvatarFileHeader header = {AVATAR_FILE_MAGIC, slot.key, check, AVATAR_SIZE, 0};
+    bool ok = file.write((const uint8_t *)&header, sizeof(header)) == sizeof(header) &&
+              file.write((const uint8_t *)slot.pixels, sizeof(slot.pixels)) == sizeof(slot.pixels);
+    file.close();
+    if (ok && LittleFS.rename(tempPath, path)) {
+        diskFiles++;
+    } else {
+        LittleFS.remove(tempPath);
+    }
+}
+
+// Reads the whole JPEG into jpegBuffer; returns its length, or -1. Goes through
+// the XRPC pool, so the CDN is verified against the CA bundle and its connection
+// and TLS session are reused from one avatar to the next.
+static int downloadAvatar(const char *url) {
+    XrpcClient xrpc;
+    if (!xrpc.begin(thumbnailUrl(url))) return -1;
+    int httpCode = xrpc.GET();
+    if (httpCode != HTTP_CODE_OK || xrpc.http().getSize() > AVATAR_MAX_BYTES) return -1;
+
+    // Not JSON, but the reader is what de-chunks the body and knows where it ends
+    JsonStreamReader body = xrpc.body();
+    int length = (int)body.readBytes((char *)jpegBuffer, AVATAR_MAX_BYTES);
+    bool complete = body.finished() || (xrpc.http().getSize() < 0 && !xrpc.chunked());  // Or ended by a close
+    xrpc.end(&body);
+    return complete ? length : -1;
+}
+
+static bool storeDecodedBlock(int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t *bitmap) {
+    int count = min((int)w, decodeWidth - x);
+    for (int row = 0; row < h && y + row < decodeHeight && count > 0; row++) {
+        memcpy(&decodeBuffer[(y + row) * decodeWidth + x], &bitmap[row * w], count * sizeof(uint16_t));
+    }
+    return true;
+}
+
+// Decodes jpegBuffer at the smallest 1/2/4/8 scale that's still at least
+// AVATAR_SIZE, then box-filters the centered square down into slot.pixels
+static bool decodeAvatar(int length, AvatarSlot &slot) {
+    uint16_t width, height;
+    if (TJpgDec.getJpgSize(&width, &height, jpegBuffer, length) != JDR_OK) return false;
+
+    uint8_t scale = 1;
+    while (scale < 8 && width / (scale * 2) >= AVATAR_SIZE && height / (scale * 2) >= AVATAR_SIZE) {
+        scale *= 2;
+    }
+    decodeWidth = (width + scale - 1) / scale;
+    decodeHeight = (height + scale - 1) / scale;
+    if (decodeWidth > AVATAR_DECODE_MAX || decodeHeight > AVATAR_DECODE_MAX) return false;
+
+    memset(decodeBuffer, 0, decodeWidth * decodeHeight * sizeof(uint16_t));
+    TJpgDec.setJpgScale(scale);
+    if (TJpgDec.drawJpg(0, 0, jpegBuffer, length) != JDR_OK) return false;
+
+    int side = min(decodeWidth, decodeHeight);
+    int offsetX = (decodeWidth - side) / 2;
+    int offsetY = (decodeHeight - side) / 2;
+    for (int dy = 0; dy < AVATAR_SIZE; dy++) {
+        int y0 = offsetY + dy * side / AVATAR_SIZE;
+        int y1 = max(y0 + 1, offsetY + (dy + 1) * side / AVATAR_SIZE);
+        for (int dx = 0; dx < AVATAR_SIZE; dx++) {
+            int x0 = offsetX + dx * side / AVATAR_SIZE;
+            int x1 = max(x0 + 1, offsetX + (dx + 1) * side / AVATAR_SIZE);
+            uint32_t r = 0, g = 0, b = 0, n = 0;
+            for (int y = y0; y < y1; y++) {
+                for (int x = x0; x < x1; x++) {
+                    uint16_t pixel = decodeBuffer[y * decodeWidth + x];
+                    r += pixel >> 11;
+                    g += (pixel >> 5) & 0x3F;
+                    b += pixel & 0x1F;
+                    n++;
+                }
+            }
+            uint16_t pixel = ((r / n) << 11) | ((g / n) << 5) | (b / n);
+#if LV_COLOR_16_SWAP
+            pixel = (pixel >> 8) | (pixel << 8);
+#endif
+            slot.pixels[dy * AVATAR_SIZE + dx] = pixel;
+        }
+    }
+    return true;
+}
+
+static void loadAvatar(const AvatarRequest &request) {
+    int index = claimSlot(request.key);
+    if (index < 0) return;  // Loaded while this request was queued
+    AvatarSlot &slot = slots[index];
+    bool hasUrl = request.url[0] != '\0';
+    uint32_t check = urlCheck(request.url);
+
+    if (readDiskAvatar(slot, hasUrl, check)) {
+        portENTER_CRITICAL(&avatarLock);
+        stats.diskHits++;
+        portEXIT_CRITICAL(&avatarLock);
+        finishSlot(slot, true);
+        return;
+    }
+
+    if (!hasUrl) {
+        // Not cached on disk; the next fetch asks again with the URL
+        portENTER_CRITICAL(&avatarLock);
+        slot.state = AVATAR_EMPTY;
+        slot.key = 0;
+        portEXIT_CRITICAL(&avatarLock);
+        return;
+    }
+
+    bool ok = false;
+    uint32_t start = micros();
+    int length = WiFi.status() == WL_CONNECTED ? downloadAvatar(request.url) : -1;
+    uint32_t downloadUs = micros() - start;
+    uint32_t decodeUs = 0;
+    if (length > 0) {
+        start = micros();
+        ok = decodeAvatar(length, slot);
+        decodeUs = micros() - start;
+    }
+
+    portENTER_CRITICAL(&avatarLock);
+    stats.totalDownloadUs += downloadUs;
+    if (length > 0) {
+        stats.downloads++;
+        stats.decodes++;
+        stats.totalDecodeUs += decodeUs;
+        if (decodeUs > stats.maxDecodeUs) stats.maxDecodeUs = decodeUs;
+    }
+    portEXIT_CRITICAL(&avatarLock);
+
+    if (ok) writeDiskAvatar(slot, check);
+    finishSlot(slot, ok);
+}
+
+static void avatarWorkerTask(void *param) {
+    diskReady = LittleFS.begin(true) && (LittleFS.exists(AVATAR_DIR) || LittleFS.mkdir(AVATAR_DIR));
+    if (diskReady) {
+        File dir = LittleFS.open(AVATAR_DIR);
+        for (File file = dir.openNextFile(); file; file = dir.openNextFile()) {
+            diskFiles++;
+        }
+        dir.close();
+    } else {
+        Serial.println("WARNING: LittleFS unavailable, avatars are cached in memory only");
+    }
+
+    AvatarRequest request;
+    for (;;) {
+        if (xQueueReceive(avatarQueue, &request, portMAX_DELAY) != pdTRUE) continue;
+        loadAvatar(request);
+        if (uxQueueMessagesWaiting(avatarQueue) == 0) printAvatarStats();
+    }
+}
+
+void startAvatarWorker() {
+    if (avatarTask != NULL) return;
+    xrpcInit();
+
+    slots = (AvatarSlot *)ps_malloc(AVATAR_CACHE_SLOTS * sizeof(AvatarSlot));
+    jpegBuffer = (uint8_t *)ps_malloc(AVATAR_MAX_BYTES);
+    decodeBuffer = (uint16_t *)ps_malloc(AVATAR_DECODE_MAX * AVATAR_DECODE_MAX * sizeof(uint16_t));
+    if (slots == NULL || jpegBuffer == NULL || decodeBuffer == NULL) {
+        Serial.println("ERROR: No PSRAM for avatars, post screens will show handles only");
+        free(slots);
+        free(jpegBuffer);
+        free(decodeBuffer);
+        slots = NULL;
+        return;
+    }
+
+    memset(slots, 0, AVATAR_CACHE_SLOTS * sizeof(AvatarSlot));
+    for (int i = 0; i < AVATAR_CACHE_SLOTS; i++) {
+        lv_img_dsc_t &image = slots[i].image;
+        image.header.always_zero = 0;
+        image.header.cf = LV_IMG_CF_TRUE_COLOR;
+        image.header.w = AVATAR_SIZE;
+        image.header.h = AVATAR_SIZE;
+        image.data_size = sizeof(slots[i].pixels);
+        image.data = (const uint8_t *)slots[i].pixels;
+    }
+    for (int i = 0; i < AVATAR_HOLDERS; i++) {
+        holderSlots[i] = -1;
+    }
+
+    TJpgDec.setSwapBytes(false);
+    TJpgDec.setCallback(storeDecodedBlock);
+
+    avatarQueue = xQueueCreate(AVATAR_QUEUE_DEPTH, sizeof(AvatarRequest));
+    xTaskCreatePinnedToCore(avatarWorkerTask, "avatars", AVATAR_TASK_STACK, NULL,
+                            AVATAR_TASK_PRIORITY, &avatarTask, AVATAR_TASK_CORE);
+}
+
+// Queues key unless it's already decoded; url may be empty for a disk-only lookup
+static void queueAvatar(uint32_t key, const char *url) {
+    // Repeat authors are answered here, without touching the queue
+    bool loaded = false;
+    portENTER_CRITICAL(&avatarLock);
+    stats.requests++;
+    for (int i = 0; i < AVATAR_CACHE_SLOTS; i++) {
+        if (slots[i].key == key && slots[i].state == AVATAR_READY) {
+            slots[i].lastUsed = ++useClock;
+            stats.memoryHits++;
+            loaded = true;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&avatarLock);
+    if (loaded) return;
+
+    AvatarRequest request;
+    request.key = key;
+    strlcpy(request.url, url, sizeof(request.url));
+    xQueueSend(avatarQueue, &request, 0);
+}
+
+void requestAvatar(const char *url) {
+    uint32_t key = avatarKey(url);
+    if (key == 0 || avatarQueue == NULL || strlen(url) >= AVATAR_URL_MAX) return;
+    queueAvatar(key, url);
+}
+
+void requestCachedAvatar(uint32_t key) {
+    if (key == 0 || avatarQueue == NULL) return;
+    queueAvatar(key, "");
+}
+
+const lv_img_dsc_t *avatarFor(uint32_t key, int holder) {
+    if (slots == NULL || holder < 0 || holder >= AVATAR_HOLDERS) return NULL;
+
+    const lv_img_dsc_t *image = NULL;
+    portENTER_CRITICAL(&avatarLock);
+    if (holderSlots[holder] >= 0) {
+        slots[holderSlots[holder]].pins--;
+        holderSlots[holder] = -1;
+    }
+    for (int i = 0; key != 0 && i < AVATAR_CACHE_SLOTS; i++) {
+        if (slots[i].key == key && slots[i].state == AVATAR_READY) {
+            slots[i].pins++;
+            slots[i].lastUsed = ++useClock;
+            holderSlots[holder] = i;
+            image = &slots[i].image;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&avatarLock);
+    return image;
+}
+
+uint32_t avatarGeneration() {
+    return readyGeneration.load(std::memory_order_acquire);
+}
+
+const AvatarStats &avatarStats() {
+    return stats;
+}
+
+void printAvatarStats() {
+    portENTER_CRITICAL(&avatarLock);
+    AvatarStats s = stats;
+    portEXIT_CRITICAL(&avatarLock);
+
+    uint32_t hits = s.memoryHits + s.diskHits;
+    Serial.print("Avatars: ");
+    Serial.print(s.requests);
+    Serial.print(" requests, hit rate ");
+    Serial.print(s.requests > 0 ? hits * 100 / s.requests : 0);
+    Serial.print("% (");
+    Serial.print(s.memoryHits);
+    Serial.print(" memory, ");
+    Serial.print(s.diskHits);
+    Serial.print(" disk), ");
+    Serial.print(s.downloads);
+    Serial.print(" downloads avg ");
+    Serial.print(s.downloads > 0 ? (uint32_t)(s.totalDownloadUs / s.downloads / 1000) : 0);
+    Serial.print(" ms, decode avg ");
+    Serial.print(s.decodes > 0 ? (uint32_t)(s.totalDecodeUs / s.decodes) : 0);
+    Serial.print(" us max ");
+    Serial.print(s.maxDecodeUs);
+    Serial.print(" us, ");
+    Serial.print(s.failures);
+    Serial.print(" failed, ");
+    Serial.print(diskFiles);
+    Serial.println(" on disk");
+}
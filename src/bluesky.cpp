@@ -0,0 +1,367 @@
+#include "bluesky.h"
+#include <HTTPClient.h>
+#include "post_store.h"
+#include "bluesky_session.h"
+#include "telemetry.h"
+#include "avatars.h"
+#include "post_snapshot.h"
+#include "wifi_manager.h"
+#include "power.h"
+#include "feed_sources.h"
+#include "jetstream.h"
+#include "poll_scheduler.h"
+#include "xrpc_client.h"
+
+#define SEEN_POST_SLOTS 128  // Per generation; two generations are kept
+
+// Network worker task settings (core 0, next to the WiFi stack; loop() runs on core 1)
+#define FEED_TASK_STACK 16384
+#define FEED_TASK_PRIORITY 1
+#define FEED_TASK_CORE 0
+
+static TaskHandle_t feedTask = NULL;
+static volatile bool feedBusy = false;
+static FetchStats fetchStats;
+static SemaphoreHandle_t storeLock = NULL;  // Fetches and streamed posts both write the post store
+static String serverOverride = "";  // Replaces https://host of every XRPC and Mastodon API URL when set
+
+// Fixed-size set of recently merged posts, stored as 32-bit hashes of their URI
+// and per-network text in two open-addressed generations. When the current one fills up it
+// becomes the old one, so memory stays at 2 * SEEN_POST_SLOTS words and recent
+// posts are never lost.
+class SeenPostSet {
+public:
+    bool contains(uint32_t hash) const {
+        return lookup(tables[current], hash) || lookup(tables[current ^ 1], hash);
+    }
+
+    void insert(uint32_t hash) {
+        if (lookup(tables[current], hash)) return;
+        if (count[current] >= SEEN_POST_SLOTS * 3 / 4) {
+            current ^= 1;
+            memset(tables[current], 0, sizeof(tables[current]));
+            count[current] = 0;
+        }
+        uint32_t slot = hash & (SEEN_POST_SLOTS - 1);
+        while (tables[current][slot] != 0) {
+            slot = (slot + 1) & (SEEN_POST_SLOTS - 1);
+        }
+        tables[current][slot] = hash;
+        count[current]++;
+    }
+
+private:
+    static bool lookup(const uint32_t *table, uint32_t hash) {
+        uint32_t slot = hash & (SEEN_POST_SLOTS - 1);
+        while (table[slot] != 0) {
+            if (table[slot] == hash) return true;
+            slot = (slot + 1) & (SEEN_POST_SLOTS - 1);
+        }
+        return false;
+    }
+
+    uint32_t tables[2][SEEN_POST_SLOTS] = {};  // feedHash() never returns 0, the empty slot
+    int count[2] = {0, 0};
+    int current = 0;
+};
+
+static SeenPostSet seenPosts;
+
+// Text fingerprints are kept per network and only checked against the other one.
+// Two attendees posting the same words on one network are two posts (their URIs
+// differ), while a bridged copy has a new URI and only its text gives it away.
+static uint32_t textKey(uint32_t textHash, FeedNetwork network) {
+    uint32_t key = (textHash ^ (uint32_t)network) * 16777619u;
+    return key != 0 ? key : 1;
+}
+
+// True if the post hasn't been merged before; remembers it either way
+static bool rememberPost(const FeedItem &item) {
+    FeedNetwork other = item.network == FEED_NETWORK_BLUESKY ? FEED_NETWORK_MASTODON : FEED_NETWORK_BLUESKY;
+    if (seenPosts.contains(item.uriHash) || seenPosts.contains(textKey(item.textHash, other))) return false;
+    seenPosts.insert(item.uriHash);
+    seenPosts.insert(textKey(item.textHash, item.network));
+    return true;
+}
+
+// Tracks the lowest free heap (and the largest block at that point) during a fetch
+static void sampleFetchHeap() {
+    uint32_t freeHeap = ESP.getFreeHeap();
+    if (freeHeap < fetchStats.minFreeHeap) {
+        fetchStats.minFreeHeap = freeHeap;
+        fetchStats.largestBlockAtMin = ESP.getMaxAllocHeap();
+    }
+}
+
+static void lockStore() {
+    if (storeLock != NULL) xSemaphoreTake(storeLock, portMAX_DELAY);
+}
+
+static void unlockStore() {
+    if (storeLock != NULL) xSemaphoreGive(storeLock);
+}
+
+void setBlueskyServer(const char *baseUrl) {
+    serverOverride = baseUrl != NULL ? baseUrl : "";
+}
+
+String blueskyEndpoint(const char *configuredUrl) {
+    String url = configuredUrl;
+    if (serverOverride.length() == 0) return url;
+    int path = url.indexOf("/xrpc/");
+    if (path < 0) path = url.indexOf("/api/v1/");
+    return path < 0 ? url : serverOverride + url.substring(path);
+}
+
+void resetFeedSyncState() {
+    lockStore();
+    postStoreClearTop();
+    seenPosts = SeenPostSet();
+    unlockStore();
+    resetSourceCursors();
+}
+
+const FetchStats &lastFetchStats() {
+    return fetchStats;
+}
+
+static void printSourceStats(int index) {
+    const SourceStats &stats = sourceStats(index);
+    Serial.print("  ");
+    Serial.print(feedSourceName(index));
+    if (stats.httpCode == 0) {
+        Serial.println(": skipped, no session");
+        return;
+    }
+    Serial.print(": HTTP ");
+    Serial.print(stats.httpCode);
+    Serial.print(", ");
+    Serial.print(stats.posts);
+    Serial.print(" posts, ");
+    Serial.print(stats.filtered);
+    Serial.print(" filtered, ");
+    Serial.print(stats.bytesRead);
+    Serial.print(" bytes in ");
+    Serial.print(stats.durationUs / 1000);
+    Serial.print(" ms");
+    if (stats.parseError) Serial.print(", parse error");
+    if (stats.serverWaitMs > 0) {
+        Serial.print(", server asks for ");
+        Serial.print(stats.serverWaitMs / 1000);
+        Serial.print(" s");
+    }
+    printXrpcTiming(stats.timing);
+    Serial.println(stats.cancelled ? " (cancelled)" : "");
+}
+
+bool fetchFeeds() {
+    Serial.println("\n=== Fetching feeds ===");
+
+    uint32_t fetchStart = micros();
+    memset(&fetchStats, 0, sizeof(fetchStats));
+    fetchStats.minFreeHeap = UINT32_MAX;
+    sampleFetchHeap();
+    telemetryBegin(TELEMETRY_FETCH);
+    pollFetchBegin();
+
+    // Reuses the stored session, refreshing it first if the access token is about to expire
+    bool session = false;
+    if (feedSourcesNeedSession()) {
+        session = ensureBlueskySession();
+        if (!session) Serial.println("ERROR: Authentication failed, skipping Bluesky sources");
+    }
+
+    int count = feedSourceCount();
+    beginSourceFetches(session);
+
+    // Streaming k-way merge. Every source delivers newest first, so the newest of
+    // the sources' current heads is the newest post not merged yet; a source
+    // that's slow to answer only holds up the posts older than its head.
+    // The store is only locked per post: waiting on a source with it held would
+    // hold up the stream, which then runs out of match buffers and drops posts.
+    FeedItem *heads[FEED_MAX_SOURCES] = {};
+    bool open[FEED_MAX_SOURCES];
+    for (int i = 0; i < count; i++) open[i] = true;
+    bool changed = false;
+    bool settled = false;  // The top is full and everything still coming is older
+
+    telemetryBegin(TELEMETRY_PARSE);
+    for (;;) {
+        int newest = -1;
+        for (int i = 0; i < count; i++) {
+            if (open[i] && heads[i] == NULL) open[i] = nextSourceItem(i, heads[i]);
+            if (open[i] && (newest < 0 || heads[i]->createdAtMs > heads[newest]->createdAtMs)) newest = i;
+        }
+        if (newest < 0) break;
+        sampleFetchHeap();
+        telemetrySample(TELEMETRY_PARSE);
+        telemetrySample(TELEMETRY_FETCH);
+
+        FeedItem *item = heads[newest];
+        heads[newest] = NULL;
+        if (settled) {
+            // Draining what the sources had parsed before they saw the cancel
+        } else {
+            lockStore();
+            bool fresh = rememberPost(*item);
+            bool top = fresh && postStoreOffer(item->handle, item->text, item->createdAtMs, avatarKey(item->avatar));
+            unlockStore();
+            if (!fresh) {
+                fetchStats.skippedPosts++;  // Known, or the same post bridged from another network
+            } else {
+                fetchStats.newPosts++;
+                pollFetchPost(item->createdAtMs);
+                if (top) {
+                    changed = true;
+                    requestAvatar(item->avatar);  // Decoded in the background; screens update when it's ready
+                } else {
+                    settled = true;
+                    cancelSourceFetches();
+                }
+            }
+        }
+        releaseSourceItem(newest, item);
+    }
+    telemetryEnd(TELEMETRY_PARSE);
+
+    bool unauthorized = false;
+    bool failed = feedSourcesNeedSession() && !session;
+    int rateLimited = 0;
+    uint32_t serverWaitMs = 0;
+    for (int i = 0; i < count; i++) {
+        const SourceStats &stats = sourceStats(i);
+        printSourceStats(i);
+        if (stats.httpCode == 0) continue;
+        if (stats.httpCode != HTTP_CODE_OK || stats.parseError) failed = true;
+        if (stats.httpCode == 429) rateLimited++;
+        serverWaitMs = max(serverWaitMs, stats.serverWaitMs);
+        fetchStats.sources++;
+        if (fetchStats.httpCode == 0 || fetchStats.httpCode == HTTP_CODE_OK) fetchStats.httpCode = stats.httpCode;
+        fetchStats.bytesRead += stats.bytesRead;
+        fetchStats.poolPeak = max(fetchStats.poolPeak, stats.poolPeak);
+        fetchStats.parseError = fetchStats.parseError || stats.parseError;
+        fetchStats.slowestSourceUs = max(fetchStats.slowestSourceUs, stats.durationUs);
+        fetchStats.totalSourceUs += stats.durationUs;
+        if (stats.httpCode == 401 && feedSource(i).type != FEED_MASTODON_TAG) unauthorized = true;
+    }
+    if (unauthorized) {
+        Serial.println("Token expired, will refresh the session...");
+        invalidateBlueskyAccessToken();
+    }
+
+    fetchStats.durationUs = micros() - fetchStart;
+    Serial.print("Merged ");
+    Serial.print(fetchStats.newPosts);
+    Serial.print(" new, ");
+    Serial.print(fetchStats.skippedPosts);
+    Serial.print(" already seen or duplicate, from ");
+    Serial.print(fetchStats.sources);
+    Serial.print(" sources in ");
+    Serial.print(fetchStats.durationUs / 1000);
+    Serial.print(" ms (slowest source ");
+    Serial.print(fetchStats.slowestSourceUs / 1000);
+    Serial.print(" ms, sources added up ");
+    Serial.print(fetchStats.totalSourceUs / 1000);
+    Serial.println(" ms)");
+
+    pollFetchEnd(fetchStats.sources, failed, rateLimited, serverWaitMs);
+
+    // Only hand a new set to the UI when the top posts actually changed
+    if (changed) {
+        lockStore();
+        int shown = postStorePublishTop();
+        schedulePostSnapshot();
+        unlockStore();
+        powerWake();
+        Serial.print("SUCCESS: Showing ");
+        Serial.print(shown);
+        Serial.println(" community posts");
+    } else {
+        Serial.println("No new posts to show");
+    }
+    telemetryEnd(TELEMETRY_FETCH);
+    Serial.println("=== Fetch complete ===\n");
+    return changed;
+}
+
+bool offerStreamedPost(const FeedItem &item) {
+    lockStore();
+    bool shown = false;
+    if (rememberPost(item)) {
+        if (postStoreOffer(item.handle, item.text, item.createdAtMs, avatarKey(item.avatar))) {
+            postStorePublishTop();
+            schedulePostSnapshot();
+            powerWake();
+            requestAvatar(item.avatar);
+            shown = true;
+        }
+    }
+    unlockStore();
+    return shown;
+}
+
+// Polling only backs up the stream when it covers everything the badge follows
+static uint32_t refreshInterval() {
+    bool covered = jetstreamLive() && feedSourceCount() == 1 && feedSource(0).type == FEED_BLUESKY_TAG &&
+                   strcasecmp(feedSource(0).query, BLUESKY_SEARCH_TAG) == 0;
+    return covered ? max((uint32_t)JETSTREAM_POLL_INTERVAL, pollIntervalMs()) : pollIntervalMs();
+}
+
+// Network worker: auth, fetch and parse all happen here so loop() never waits on the network
+static void feedWorkerTask(void *param) {
+    bool clockStarted = false;
+    bool requested = false;  // Someone asked for a refresh; still waits out a server hold
+    for (;;) {
+        waitForWifi(UINT32_MAX);
+
+        // Wall clock is needed to check JWT expiry; SNTP syncs in the background
+        if (!clockStarted) {
+            configTime(0, 0, "pool.ntp.org", "time.nist.gov");
+            clockStarted = true;
+        }
+
+        // Nothing new would be seen on a dimmed screen; resuming wakes the worker
+        if (pollingPaused()) {
+            xrpcCloseIdle();
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            continue;
+        }
+
+        // Sleep until the next poll is due, or until someone asks for one early.
+        // The interval is re-read after every wake, as the stream may have come or gone.
+        uint32_t dueInMs = pollDueInMs(refreshInterval(), requested);
+        if (dueInMs > 0) {
+            // The server would drop kept-alive connections before then anyway; free their TLS buffers now
+            if (dueInMs > XRPC_KEEP_ALIVE_MS) xrpcCloseIdle();
+            if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(dueInMs)) > 0) requested = true;
+            continue;
+        }
+        requested = false;
+
+        feedBusy = true;
+        fetchFeeds();
+        lockStore();
+        writePostSnapshotIfDue();
+        unlockStore();
+        feedBusy = false;
+    }
+}
+
+void startFeedWorker() {
+    if (feedTask != NULL) return;
+    xrpcInit();
+    if (!startFeedSources()) return;
+    storeLock = xSemaphoreCreateMutex();
+    xTaskCreatePinnedToCore(feedWorkerTask, "feed", FEED_TASK_STACK, NULL,
+                            FEED_TASK_PRIORITY, &feedTask, FEED_TASK_CORE);
+}
+
+void requestFeedRefresh() {
+    if (feedTask != NULL) {
+        xTaskNotifyGive(feedTask);
+    }
+}
+
+bool feedWorkerBusy() {
+    return feedBusy;
+}
@@ -0,0 +1,224 @@
+#include "bluesky_session.h"
+#include <ArduinoJson.h>
+#include <Preferences.h>
+#include <time.h>
+#include <mbedtls/base64.h>
+#include "json_stream_reader.h"
+#include "bluesky.h"
+#include "xrpc_client.h"
+
+#define SESSION_NVS_NAMESPACE "bsky"
+#define SESSION_REFRESH_MARGIN 300   // Refresh when the access token has < 5 minutes left
+#define CLOCK_VALID_AFTER 1600000000 // Anything earlier means SNTP hasn't synced yet
+
+static String accessToken = "";
+static String refreshToken = "";
+static time_t accessExpiry = 0;  // JWT exp of the access token, 0 if unknown
+static bool sessionLoaded = false;
+
+// Reads the `exp` claim from a JWT payload (base64url JSON between the two dots)
+static time_t jwtExpiry(const String &jwt) {
+    int first = jwt.indexOf('.');
+    int second = jwt.indexOf('.', first + 1);
+    if (first < 0 || second < 0) return 0;
+
+    String payload = jwt.substring(first + 1, second);
+    payload.replace('-', '+');
+    payload.replace('_', '/');
+    while (payload.length() % 4 != 0) payload += '=';
+
+    unsigned char decoded[512];
+    size_t decodedLength = 0;
+    if (mbedtls_base64_decode(decoded, sizeof(decoded), &decodedLength,
+                              (const unsigned char *)payload.c_str(), payload.length()) != 0) {
+        return 0;
+    }
+
+    StaticJsonDocument<32> filter;
+    filter["exp"] = true;
+    StaticJsonDocument<64> claims;
+    if (deserializeJson(claims, (const char *)decoded, decodedLength, DeserializationOption::Filter(filter))) {
+        return 0;
+    }
+    return (time_t)claims["exp"].as<long long>();
+}
+
+static bool clockValid() {
+    return time(nullptr) > CLOCK_VALID_AFTER;
+}
+
+static void saveSession() {
+    Preferences prefs;
+    prefs.begin(SESSION_NVS_NAMESPACE, false);
+    prefs.putString("ident", BLUESKY_IDENTIFIER);
+    prefs.putString("server", blueskyEndpoint(BLUESKY_AUTH_URL));
+    prefs.putString("access", accessToken);
+    prefs.putString("refresh", refreshToken);
+    prefs.end();
+}
+
+static void loadSession() {
+    sessionLoaded = true;
+
+    Preferences prefs;
+    prefs.begin(SESSION_NVS_NAMESPACE, true);
+    // Ignore tokens saved for a different account or server (e.g. the mock server)
+    if (prefs.getString("ident", "") == BLUESKY_IDENTIFIER &&
+        prefs.getString("server", "") == blueskyEndpoint(BLUESKY_AUTH_URL)) {
+        accessToken = prefs.getString("access", "");
+        refreshToken = prefs.getString("refresh", "");
+        accessExpiry = jwtExpiry(accessToken);
+    }
+    prefs.end();
+
+    if (refreshToken.length() > 0) {
+        Serial.println("Restored Bluesky session from NVS");
+    }
+}
+
+// True when the access token is known to expire within the refresh margin.
+// Without a synced clock we can't tell, so the token is used until it gets a 401.
+static bool accessExpiresSoon() {
+    if (accessExpiry == 0 || !clockValid()) return false;
+    return time(nullptr) + SESSION_REFRESH_MARGIN >= accessExpiry;
+}
+
+// Reads accessJwt/refreshJwt from a createSession or refreshSession response
+static bool storeSessionResponse(JsonStreamReader &reader) {
+    StaticJsonDocument<64> filter;
+    filter["accessJwt"] = true;
+    filter["refreshJwt"] = true;
+
+    DynamicJsonDocument doc(4096);
+    DeserializationError error = deserializeJson(doc, reader, DeserializationOption::Filter(filter));
+    if (error) {
+        Serial.print("JSON parse error: ");
+        Serial.println(error.c_str());
+        return false;
+    }
+
+    String access = doc["accessJwt"].as<String>();
+    String refresh = doc["refreshJwt"].as<String>();
+    if (access.length() == 0 || refresh.length() == 0) {
+        Serial.println("ERROR: Session response is missing tokens");
+        return false;
+    }
+
+    accessToken = access;
+    refreshToken = refresh;
+    accessExpiry = jwtExpiry(accessToken);
+    saveSession();
+    return true;
+}
+
+bool authenticateBluesky() {
+    Serial.println("\n=== Authenticating with Bluesky ===");
+
+    // Check if we have credentials
+    if (String(BLUESKY_APP_PASSWORD).length() == 0) {
+        Serial.println("ERROR: No app password configured!");
+        Serial.println("Please create an app password at: https://bsky.app/settings/app-passwords");
+        return false;
+    }
+
+    XrpcClient xrpc;
+    if (!xrpc.begin(blueskyEndpoint(BLUESKY_AUTH_URL))) return false;
+    xrpc.addHeader("Content-Type", "application/json");
+
+    // Create JSON payload
+    DynamicJsonDocument doc(256);
+    doc["identifier"] = BLUESKY_IDENTIFIER;
+    doc["password"] = BLUESKY_APP_PASSWORD;
+
+    String requestBody;
+    serializeJson(doc, requestBody);
+
+    Serial.print("Authenticating as: ");
+    Serial.println(BLUESKY_IDENTIFIER);
+
+    int httpCode = xrpc.POST(requestBody);
+    Serial.print("HTTP Code: ");
+    Serial.println(httpCode);
+
+    bool ok = false;
+    if (httpCode == HTTP_CODE_OK) {
+        JsonStreamReader body = xrpc.body();
+        ok = storeSessionResponse(body);
+        xrpc.end(&body);
+        if (ok) {
+            Serial.print("SUCCESS: Got access token (length: ");
+            Serial.print(accessToken.length());
+            Serial.println(")");
+        }
+    } else {
+        Serial.print("Authentication failed with code: ");
+        Serial.println(httpCode);
+        if (httpCode > 0) {
+            Serial.println("Response: " + xrpc.getString());
+        }
+    }
+
+    xrpc.end();
+    return ok;
+}
+
+bool refreshBlueskySession() {
+    Serial.println("\n=== Refreshing Bluesky session ===");
+
+    XrpcClient xrpc;
+    if (!xrpc.begin(blueskyEndpoint(BLUESKY_REFRESH_URL))) return false;
+    xrpc.addHeader("Authorization", "Bearer " + refreshToken);
+
+    int httpCode = xrpc.POST("");
+    Serial.print("HTTP Code: ");
+    Serial.println(httpCode);
+
+    bool ok = false;
+    if (httpCode == HTTP_CODE_OK) {
+        // The old refresh token is revoked once rotated, so store the new pair right away
+        JsonStreamReader body = xrpc.body();
+        ok = storeSessionResponse(body);
+        xrpc.end(&body);
+        if (ok) {
+            Serial.println("SUCCESS: Session refreshed");
+        }
+    } else if (httpCode == 400 || httpCode == 401) {
+        // Refresh token expired or revoked; only a password login can recover
+        Serial.println("Refresh token rejected, clearing stored session");
+        accessToken = "";
+        refreshToken = "";
+        accessExpiry = 0;
+        saveSession();
+    }
+
+    xrpc.end();
+    return ok;
+}
+
+bool ensureBlueskySession() {
+    if (!sessionLoaded) {
+        loadSession();
+    }
+
+    if (accessToken.length() > 0 && !accessExpiresSoon()) {
+        return true;
+    }
+
+    if (refreshToken.length() > 0) {
+        if (refreshBlueskySession()) {
+            return true;
+        }
+        Serial.println("Session refresh failed, falling back to password login");
+    }
+
+    return authenticateBluesky();
+}
+
+const String &blueskyAccessToken() {
+    return accessToken;
+}
+
+void invalidateBlueskyAccessToken() {
+    accessToken = "";
+    accessExpiry = 0;
+}
@@ -0,0 +1,220 @@
+#include "buttons.h"
+#include <lvgl.h>
+#include <driver/gpio.h>
+#include "power.h"
+
+#define EVENT_RING 4  // Recognized gestures not yet taken by nextButtonEvent()
+#define DEBOUNCE_US (BUTTON_DEBOUNCE_MS * 1000UL)
+#define LONG_PRESS_US (BUTTON_LONG_PRESS_MS * 1000UL)
+#define DOUBLE_PRESS_US (BUTTON_DOUBLE_PRESS_MS * 1000UL)
+
+struct ButtonEdge {
+    uint8_t button;
+    bool pressed;
+    uint32_t timeUs;
+};
+
+struct ButtonState {
+    uint8_t pin;
+    bool doublePress;
+    volatile bool waitingForPress;  // Level the interrupt is armed for; owned by the ISR
+    volatile bool resync;           // Edges were dropped; re-read the pin after the lockout
+    bool pressed;                   // Debounced
+    bool longFired;
+    bool secondPress;   // This press completed a double press
+    bool clickPending;  // Released once, waiting to see if a second press follows
+    uint32_t lastAcceptedUs;
+    uint32_t pressedAtUs;
+    uint32_t releasedAtUs;
+};
+
+static ButtonState buttons[BUTTON_MAX];
+static int buttonCount = 0;
+static QueueHandle_t edgeQueue = NULL;
+static ButtonEvent pending[EVENT_RING];
+static int pendingHead = 0;
+static int pendingCount = 0;
+static ButtonStats stats;
+
+static const char *gestureNames[BUTTON_GESTURE_COUNT] = {"short press", "long press", "double press"};
+
+static void ARDUINO_ISR_ATTR onButtonEdge(void *arg) {
+    int index = (int)(intptr_t)arg;
+    ButtonState &button = buttons[index];
+    ButtonEdge edge = {(uint8_t)index, button.waitingForPress, (uint32_t)micros()};
+
+    // Re-arm for the opposite level; this also makes the release a light-sleep wake source
+    button.waitingForPress = !button.waitingForPress;
+    gpio_set_intr_type((gpio_num_t)button.pin, button.waitingForPress ? GPIO_INTR_LOW_LEVEL : GPIO_INTR_HIGH_LEVEL);
+
+    stats.edges++;
+    BaseType_t woken = pdFALSE;
+    if (xQueueSendFromISR(edgeQueue, &edge, &woken) != pdTRUE) {
+        stats.dropped++;
+        button.resync = true;
+    }
+    powerWakeFromISR(&woken);
+    if (woken) portYIELD_FROM_ISR();
+}
+
+int addButton(uint8_t pin, bool doublePress) {
+    if (buttonCount >= BUTTON_MAX) return -1;
+    if (edgeQueue == NULL) edgeQueue = xQueueCreate(BUTTON_QUEUE_DEPTH, sizeof(ButtonEdge));
+
+    int index = buttonCount++;
+    ButtonState &button = buttons[index];
+    pinMode(pin, INPUT_PULLUP);
+    button.pin = pin;
+    button.doublePress = doublePress;
+    button.pressed = digitalRead(pin) == LOW;
+    button.waitingForPress = !button.pressed;
+    button.resync = false;
+    button.longFired = button.pressed;  // Held at boot: ignore this press
+    button.secondPress = false;
+    button.clickPending = false;
+    button.lastAcceptedUs = micros() - DEBOUNCE_US;
+    attachInterruptArg(pin, onButtonEdge, (void *)(intptr_t)index, button.pressed ? ONHIGH_WE : ONLOW_WE);
+    return index;
+}
+
+static void emit(int index, ButtonGesture gesture, uint32_t timeUs) {
+    if (pendingCount == EVENT_RING) return;
+    ButtonEvent &event = pending[(pendingHead + pendingCount++) % EVENT_RING];
+    event.button = index;
+    event.gesture = gesture;
+    event.timeUs = timeUs;
+}
+
+// Fires the gestures that were decided by time passing rather than by an edge
+static void checkTimeouts(int index, uint32_t nowUs) {
+    ButtonState &button = buttons[index];
+    if (button.pressed && !button.longFired && !button.secondPress && nowUs - button.pressedAtUs >= LONG_PRESS_US) {
+        button.longFired = true;
+        emit(index, BUTTON_LONG_PRESS, button.pressedAtUs + LONG_PRESS_US);
+    }
+    if (button.clickPending && nowUs - button.releasedAtUs >= DOUBLE_PRESS_US) {
+        button.clickPending = false;
+        emit(index, BUTTON_SHORT_PRESS, button.releasedAtUs + DOUBLE_PRESS_US);
+    }
+}
+
+static void acceptEdge(int index, bool pressed, uint32_t timeUs) {
+    ButtonState &button = buttons[index];
+    button.pressed = pressed;
+    button.lastAcceptedUs = timeUs;
+
+    if (pressed) {
+        button.pressedAtUs = timeUs;
+        button.longFired = false;
+        button.secondPress = button.clickPending;
+        button.clickPending = false;
+        if (button.secondPress) emit(index, BUTTON_DOUBLE_PRESS, timeUs);  // Don't wait for the release
+    } else if (!button.longFired && !button.secondPress) {
+        if (button.doublePress) {
+            button.clickPending = true;
+            button.releasedAtUs = timeUs;
+        } else {
+            emit(index, BUTTON_SHORT_PRESS, timeUs);
+        }
+    }
+}
+
+// The first edge is taken straight away; anything within the lockout after it is
+// bounce, and the pin is read again once the lockout is over
+static void handleEdge(const ButtonEdge &edge) {
+    ButtonState &button = buttons[edge.button];
+    checkTimeouts(edge.button, edge.timeUs);
+    if (edge.timeUs - button.lastAcceptedUs < DEBOUNCE_US) {
+        stats.bounces++;
+        button.resync = true;
+        return;
+    }
+    if (edge.pressed != button.pressed) acceptEdge(edge.button, edge.pressed, edge.timeUs);
+}
+
+static void checkButtons(uint32_t nowUs) {
+    for (int i = 0; i < buttonCount; i++) {
+        ButtonState &button = buttons[i];
+        checkTimeouts(i, nowUs);
+        if (button.resync && nowUs - button.lastAcceptedUs >= DEBOUNCE_US) {
+            button.resync = false;
+            bool pressed = digitalRead(button.pin) == LOW;
+            if (pressed != button.pressed) acceptEdge(i, pressed, nowUs);
+        }
+    }
+}
+
+bool nextButtonEvent(ButtonEvent &event) {
+    if (pendingCount == 0 && edgeQueue != NULL) {
+        ButtonEdge edge;
+        while (pendingCount == 0 && xQueueReceive(edgeQueue, &edge, 0) == pdTRUE) {
+            handleEdge(edge);
+        }
+        if (pendingCount == 0) checkButtons(micros());
+    }
+    if (pendingCount == 0) return false;
+
+    event = pending[pendingHead];
+    pendingHead = (pendingHead + 1) % EVENT_RING;
+    pendingCount--;
+    return true;
+}
+
+uint32_t buttonsNextDeadlineMs() {
+    if (edgeQueue != NULL && uxQueueMessagesWaiting(edgeQueue) > 0) return 0;
+
+    uint32_t now = micros();
+    uint32_t nextUs = UINT32_MAX;
+    auto consider = [&](uint32_t deadlineUs) {
+        int32_t remaining = (int32_t)(deadlineUs - now);
+        uint32_t us = remaining > 0 ? remaining : 0;
+        if (us < nextUs) nextUs = us;
+    };
+    for (int i = 0; i < buttonCount; i++) {
+        const ButtonState &button = buttons[i];
+        if (button.resync) consider(button.lastAcceptedUs + DEBOUNCE_US);
+        if (button.pressed && !button.longFired && !button.secondPress) consider(button.pressedAtUs + LONG_PRESS_US);
+        if (button.clickPending) consider(button.releasedAtUs + DOUBLE_PRESS_US);
+    }
+    return nextUs == UINT32_MAX ? UINT32_MAX : (nextUs + 999) / 1000;
+}
+
+void recordButtonLatency(const ButtonEvent &event, bool duringFetch) {
+    uint32_t latency = micros() - event.timeUs;
+    stats.actions++;
+    stats.lastLatencyUs = latency;
+    stats.totalLatencyUs += latency;
+    if (latency > stats.maxLatencyUs) stats.maxLatencyUs = latency;
+    if (duringFetch && latency > stats.maxLatencyFetchUs) stats.maxLatencyFetchUs = latency;
+}
+
+const char *buttonGestureName(ButtonGesture gesture) {
+    return gesture < BUTTON_GESTURE_COUNT ? gestureNames[gesture] : "?";
+}
+
+const ButtonStats &buttonStats() {
+    return stats;
+}
+
+void printButtonStats() {
+    Serial.print("Buttons: ");
+    Serial.print(stats.actions);
+    Serial.print(" actions, latency last ");
+    Serial.print(stats.lastLatencyUs);
+    Serial.print(" us, avg ");
+    Serial.print(stats.actions > 0 ? (uint32_t)(stats.totalLatencyUs / stats.actions) : 0);
+    Serial.print(" us, max ");
+    Serial.print(stats.maxLatencyUs);
+    Serial.print(" us (");
+    Serial.print(stats.maxLatencyFetchUs);
+    Serial.print(" us during a fetch; one frame is ");
+    Serial.print(LV_DISP_DEF_REFR_PERIOD * 1000);
+    Serial.println(" us)");
+    Serial.print("  ");
+    Serial.print(stats.edges);
+    Serial.print(" edges, ");
+    Serial.print(stats.bounces);
+    Serial.print(" bounces, ");
+    Serial.print(stats.dropped);
+    Serial.println(" dropped");
+}
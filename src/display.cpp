@@ -0,0 +1,364 @@
+#include "display.h"
+#include <esp_lcd_panel_io.h>
+#include <esp_lcd_panel_vendor.h>
+#include <esp_lcd_panel_ops.h>
+#include <esp_heap_caps.h>
+
+// Pin definitions
+#define PIN_LCD_D0 39
+#define PIN_LCD_D1 40
+#define PIN_LCD_D2 41
+#define PIN_LCD_D3 42
+#define PIN_LCD_D4 45
+#define PIN_LCD_D5 46
+#define PIN_LCD_D6 47
+#define PIN_LCD_D7 48
+#define PIN_LCD_RES 5
+#define PIN_LCD_CS 6
+#define PIN_LCD_DC 7
+#define PIN_LCD_WR 8
+#define PIN_LCD_RD 9
+
+#define PARTIAL_BUF_PIXELS (SCREEN_WIDTH * DISPLAY_BUF_LINES)
+#define FULL_FRAME_PIXELS (SCREEN_WIDTH * SCREEN_HEIGHT)
+#define PSRAM_DMA_ALIGN 64
+
+// ST7789 scroll commands
+#define ST7789_VSCRDEF 0x33  // Vertical scroll definition: top fixed, scroll area, bottom fixed
+#define ST7789_VSCSAD 0x37   // Vertical scroll start address
+#define SCROLL_LINES 320     // Gate lines; SCREEN_WIDTH in landscape
+#define STRIP_COMMAND_BYTES 11   // CASET, RASET and RAMWR with their parameters
+#define SCROLL_COMMAND_BYTES 3   // VSCSAD and its parameters
+
+// LVGL objects
+static lv_disp_draw_buf_t disp_buf;
+static lv_disp_drv_t disp_drv;
+static lv_color_t *lv_disp_buf;
+static lv_color_t *lv_disp_buf2;
+static esp_lcd_panel_io_handle_t io_handle = NULL;
+static esp_lcd_panel_handle_t panel_handle = NULL;
+static int pipeline = DISPLAY_PIPELINE;
+static int blitBandLines = SCREEN_HEIGHT;  // Rows per blitFrame() transfer, limited by the bus's max transfer
+
+// Flush timing; the transfer-done callback runs in ISR context
+static portMUX_TYPE flushMux = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t flushStartUs = 0;
+static uint32_t frameFlushUs = 0;
+static DisplayStats stats;
+
+// blitFrame() bands still on the bus; their completions aren't LVGL's
+static int blitBandsPending = 0;
+static uint32_t blitStartUs = 0;
+
+// scrollFrameIn() strips still on the bus, and the internal DMA buffer they're gathered in
+static volatile int scrollStripsPending = 0;
+static lv_color_t *scrollStrip = NULL;
+
+// Direct mode: rows touched since the last pushed frame
+static int dirtyY1 = SCREEN_HEIGHT;
+static int dirtyY2 = -1;
+
+// LVGL flush callback
+static bool lvgl_flush_ready(esp_lcd_panel_io_handle_t panel_io, esp_lcd_panel_io_event_data_t *edata, void *user_ctx) {
+    // Transfers complete in order, and a blit is only queued once LVGL's are done
+    portENTER_CRITICAL_ISR(&flushMux);
+    bool blit = blitBandsPending > 0;
+    bool strip = !blit && scrollStripsPending > 0;
+    if (blit && --blitBandsPending == 0) stats.totalBlitUs += micros() - blitStartUs;
+    if (strip) scrollStripsPending--;
+    portEXIT_CRITICAL_ISR(&flushMux);
+    if (blit || strip) return false;
+
+    portENTER_CRITICAL_ISR(&flushMux);
+    frameFlushUs += micros() - flushStartUs;
+    portEXIT_CRITICAL_ISR(&flushMux);
+
+    lv_disp_drv_t *disp_driver = (lv_disp_drv_t *)user_ctx;
+    lv_disp_flush_ready(disp_driver);
+    return false;
+}
+
+// Direct mode renders straight into the full frame, so copy what changed into the
+// other buffer before LVGL swaps to it for the next frame
+static void syncDirectBuffers(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *color_map) {
+    lv_color_t *other = (color_map == drv->draw_buf->buf1) ? (lv_color_t *)drv->draw_buf->buf2
+                                                           : (lv_color_t *)drv->draw_buf->buf1;
+    size_t rowBytes = (area->x2 - area->x1 + 1) * sizeof(lv_color_t);
+    for (int y = area->y1; y <= area->y2; y++) {
+        size_t offset = y * SCREEN_WIDTH + area->x1;
+        memcpy(other + offset, color_map + offset, rowBytes);
+    }
+}
+
+// LVGL flush function
+static void lvgl_flush(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *color_map) {
+    if (pipeline == DISPLAY_PIPELINE_DIRECT) {
+        syncDirectBuffers(drv, area, color_map);
+        if (area->y1 < dirtyY1) dirtyY1 = area->y1;
+        if (area->y2 > dirtyY2) dirtyY2 = area->y2;
+        if (!lv_disp_flush_is_last(drv)) {
+            lv_disp_flush_ready(drv);
+            return;
+        }
+
+        // Full-width rows are contiguous in the frame, so the whole dirty band goes out in one transfer
+        int y1 = dirtyY1;
+        int y2 = dirtyY2;
+        dirtyY1 = SCREEN_HEIGHT;
+        dirtyY2 = -1;
+        flushStartUs = micros();
+        esp_lcd_panel_draw_bitmap(panel_handle, 0, y1, SCREEN_WIDTH, y2 + 1, color_map + y1 * SCREEN_WIDTH);
+        return;
+    }
+
+    flushStartUs = micros();
+    esp_lcd_panel_draw_bitmap(panel_handle, area->x1, area->y1, area->x2 + 1, area->y2 + 1, color_map);
+}
+
+// Called by LVGL after every refresh with its render time and redrawn pixel count
+static void lvgl_monitor(lv_disp_drv_t *drv, uint32_t time, uint32_t px) {
+    portENTER_CRITICAL(&flushMux);
+    uint32_t flushUs = frameFlushUs;
+    frameFlushUs = 0;
+    portEXIT_CRITICAL(&flushMux);
+
+    stats.frames++;
+    stats.totalFlushUs += flushUs;
+    if (flushUs > stats.maxFlushUs) stats.maxFlushUs = flushUs;
+    stats.totalRenderMs += time;
+    stats.totalPixels += px;
+}
+
+// Allocates the draw buffers for the configured pipeline, falling back to partial
+// buffers in internal RAM if PSRAM isn't available
+static size_t allocDrawBuffers() {
+    if (pipeline != DISPLAY_PIPELINE_PARTIAL) {
+        size_t bytes = FULL_FRAME_PIXELS * sizeof(lv_color_t);
+        lv_disp_buf = (lv_color_t *)heap_caps_aligned_alloc(PSRAM_DMA_ALIGN, bytes, MALLOC_CAP_SPIRAM);
+        lv_disp_buf2 = (lv_color_t *)heap_caps_aligned_alloc(PSRAM_DMA_ALIGN, bytes, MALLOC_CAP_SPIRAM);
+        if (lv_disp_buf != NULL && lv_disp_buf2 != NULL) {
+            memset(lv_disp_buf, 0, bytes);
+            memset(lv_disp_buf2, 0, bytes);
+            return FULL_FRAME_PIXELS;
+        }
+
+        Serial.println("WARNING: No PSRAM for frame buffers, using partial buffers");
+        heap_caps_free(lv_disp_buf);
+        heap_caps_free(lv_disp_buf2);
+        pipeline = DISPLAY_PIPELINE_PARTIAL;
+    }
+
+    lv_disp_buf = (lv_color_t *)heap_caps_malloc(PARTIAL_BUF_PIXELS * sizeof(lv_color_t), MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+    lv_disp_buf2 = (lv_color_t *)heap_caps_malloc(PARTIAL_BUF_PIXELS * sizeof(lv_color_t), MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+    return PARTIAL_BUF_PIXELS;
+}
+
+void initDisplay() {
+    pinMode(PIN_LCD_RD, OUTPUT);
+    digitalWrite(PIN_LCD_RD, HIGH);
+
+    // Initialize LVGL and its draw buffers first; the bus transfer size depends on them
+    lv_init();
+    size_t bufPixels = allocDrawBuffers();
+    blitBandLines = bufPixels / SCREEN_WIDTH;
+
+    // Initialize I80 bus
+    esp_lcd_i80_bus_handle_t i80_bus = NULL;
+    esp_lcd_i80_bus_config_t bus_config = {
+        .dc_gpio_num = PIN_LCD_DC,
+        .wr_gpio_num = PIN_LCD_WR,
+        .clk_src = LCD_CLK_SRC_PLL160M,
+        .data_gpio_nums = {
+            PIN_LCD_D0, PIN_LCD_D1, PIN_LCD_D2, PIN_LCD_D3,
+            PIN_LCD_D4, PIN_LCD_D5, PIN_LCD_D6, PIN_LCD_D7,
+        },
+        .bus_width = 8,
+        .max_transfer_bytes = bufPixels * sizeof(uint16_t),
+        .psram_trans_align = PSRAM_DMA_ALIGN,
+        .sram_trans_align = 0
+    };
+    esp_lcd_new_i80_bus(&bus_config, &i80_bus);
+
+    // Initialize panel IO
+    esp_lcd_panel_io_i80_config_t io_config = {
+        .cs_gpio_num = PIN_LCD_CS,
+        .pclk_hz = DISPLAY_PCLK_HZ,
+        .trans_queue_depth = DISPLAY_TRANS_QUEUE_DEPTH,
+        .on_color_trans_done = lvgl_flush_ready,
+        .user_ctx = &disp_drv,
+        .lcd_cmd_bits = 8,
+        .lcd_param_bits = 8,
+        .dc_levels = {
+            .dc_idle_level = 0,
+            .dc_cmd_level = 0,
+            .dc_dummy_level = 0,
+            .dc_data_level = 1,
+        },
+    };
+    esp_lcd_new_panel_io_i80(i80_bus, &io_config, &io_handle);
+
+    // Initialize LCD panel
+    esp_lcd_panel_dev_config_t panel_config = {
+        .reset_gpio_num = PIN_LCD_RES,
+        .bits_per_pixel = 16,
+    };
+    esp_lcd_new_panel_st7789(io_handle, &panel_config, &panel_handle);
+    esp_lcd_panel_reset(panel_handle);
+    esp_lcd_panel_init(panel_handle);
+    esp_lcd_panel_invert_color(panel_handle, true);
+
+    esp_lcd_panel_swap_xy(panel_handle, true);
+    esp_lcd_panel_mirror(panel_handle, false, true);
+    esp_lcd_panel_set_gap(panel_handle, 0, 35);
+
+    // The whole panel is one scroll area, no fixed top or bottom
+    uint8_t scrollArea[] = {0, 0, SCROLL_LINES >> 8, SCROLL_LINES & 0xFF, 0, 0};
+    esp_lcd_panel_io_tx_param(io_handle, ST7789_VSCRDEF, scrollArea, sizeof(scrollArea));
+    scrollStrip = (lv_color_t *)heap_caps_malloc(DISPLAY_SCROLL_STRIP * SCREEN_HEIGHT * sizeof(lv_color_t),
+                                                  MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+
+    lv_disp_draw_buf_init(&disp_buf, lv_disp_buf, lv_disp_buf2, bufPixels);
+
+    lv_disp_drv_init(&disp_drv);
+    disp_drv.hor_res = SCREEN_WIDTH;
+    disp_drv.ver_res = SCREEN_HEIGHT;
+    disp_drv.flush_cb = lvgl_flush;
+    disp_drv.monitor_cb = lvgl_monitor;
+    disp_drv.draw_buf = &disp_buf;
+    disp_drv.direct_mode = (pipeline == DISPLAY_PIPELINE_DIRECT);
+    lv_disp_drv_register(&disp_drv);
+
+    Serial.print("Display pipeline: ");
+    Serial.print(displayPipelineName());
+    Serial.print(", ");
+    Serial.print(DISPLAY_PCLK_HZ / 1000000);
+    Serial.println(" MHz pixel clock");
+}
+
+const char *displayPipelineName() {
+    switch (pipeline) {
+        case DISPLAY_PIPELINE_DIRECT: return "direct (PSRAM full frame)";
+        case DISPLAY_PIPELINE_HYBRID: return "hybrid (PSRAM full-size partial)";
+        default: return "partial (internal DMA)";
+    }
+}
+
+DisplayStats displayStats() {
+    return stats;
+}
+
+void resetDisplayStats() {
+    memset(&stats, 0, sizeof(stats));
+}
+
+void printDisplayStats() {
+    if (stats.frames == 0 && stats.blits == 0 && stats.scrollSteps == 0) return;
+
+    Serial.print("Display: ");
+    Serial.print(stats.frames);
+    Serial.print(" frames");
+    if (stats.frames > 0) {
+        Serial.print(", flush avg ");
+        Serial.print(stats.totalFlushUs / stats.frames);
+        Serial.print(" us, max ");
+        Serial.print(stats.maxFlushUs);
+        Serial.print(" us, render avg ");
+        Serial.print(stats.totalRenderMs / stats.frames);
+        Serial.print(" ms, ");
+        Serial.print(stats.totalPixels / stats.frames);
+        Serial.print(" px/frame");
+    }
+    if (stats.blits > 0) {
+        Serial.print("; ");
+        Serial.print(stats.blits);
+        Serial.print(" blits, bus avg ");
+        Serial.print(stats.totalBlitUs / stats.blits);
+        Serial.print(" us, CPU avg ");
+        Serial.print(stats.totalBlitCpuUs / stats.blits);
+        Serial.print(" us");
+    }
+    if (stats.scrollSteps > 0) {
+        Serial.print("; ");
+        Serial.print(stats.scrollSteps);
+        Serial.print(" scroll steps, avg ");
+        Serial.print(stats.scrollBytes / stats.scrollSteps);
+        Serial.print(" bytes, bus avg ");
+        Serial.print(stats.totalScrollUs / stats.scrollSteps);
+        Serial.print(" us");
+    }
+    Serial.println();
+}
+
+lv_color_t *allocFrame() {
+    size_t bytes = FULL_FRAME_PIXELS * sizeof(lv_color_t);
+    return (lv_color_t *)heap_caps_aligned_alloc(PSRAM_DMA_ALIGN, bytes, MALLOC_CAP_SPIRAM);
+}
+
+// Sent in bands no larger than the bus was set up for. LVGL's last transfer has to
+// finish first, or its completion would be counted as one of ours.
+void blitFrame(const lv_color_t *frame) {
+    uint32_t start = micros();
+    while (disp_drv.draw_buf->flushing) {
+        taskYIELD();
+    }
+
+    int bandLines = blitBandLines;
+    int bands = (SCREEN_HEIGHT + bandLines - 1) / bandLines;
+    portENTER_CRITICAL(&flushMux);
+    blitStartUs = micros();
+    blitBandsPending += bands;
+    portEXIT_CRITICAL(&flushMux);
+    for (int y = 0; y < SCREEN_HEIGHT; y += bandLines) {
+        int y2 = y + bandLines < SCREEN_HEIGHT ? y + bandLines : SCREEN_HEIGHT;
+        esp_lcd_panel_draw_bitmap(panel_handle, 0, y, SCREEN_WIDTH, y2, frame + y * SCREEN_WIDTH);
+    }
+    stats.blits++;
+    stats.totalBlitCpuUs += micros() - start;
+}
+
+// Panel memory column m shows at screen column m - start (wrapping), so after
+// writing frame's columns into the slots that scroll off the left edge, moving the
+// start address to toX brings them in on the right. With DISPLAY_SCROLL_INVERT the
+// panel scrolls the other way and the frame comes in from the left instead.
+void scrollFrameIn(const lv_color_t *frame, int fromX, int toX) {
+    if (scrollStrip == NULL) {
+        if (toX >= SCREEN_WIDTH) blitFrame(frame);  // No DMA memory left for strips: cut
+        return;
+    }
+
+    uint32_t start = micros();
+    while (disp_drv.draw_buf->flushing) {
+        taskYIELD();
+    }
+
+    for (int x = fromX; x < toX; x += DISPLAY_SCROLL_STRIP) {
+        int width = toX - x < DISPLAY_SCROLL_STRIP ? toX - x : DISPLAY_SCROLL_STRIP;
+        int column = DISPLAY_SCROLL_INVERT ? SCREEN_WIDTH - x - width : x;
+        while (scrollStripsPending > 0) {
+            taskYIELD();
+        }
+        for (int y = 0; y < SCREEN_HEIGHT; y++) {
+            memcpy(scrollStrip + y * width, frame + y * SCREEN_WIDTH + column, width * sizeof(lv_color_t));
+        }
+        portENTER_CRITICAL(&flushMux);
+        scrollStripsPending++;
+        portEXIT_CRITICAL(&flushMux);
+        esp_lcd_panel_draw_bitmap(panel_handle, column, 0, column + width, SCREEN_HEIGHT, scrollStrip);
+        stats.scrollBytes += STRIP_COMMAND_BYTES + width * SCREEN_HEIGHT * sizeof(lv_color_t);
+    }
+
+    // Sent once the strips are out; the I80 driver drains its queue before a command
+    int line = (DISPLAY_SCROLL_INVERT ? SCREEN_WIDTH - toX : toX) % SCROLL_LINES;
+    uint8_t address[] = {(uint8_t)(line >> 8), (uint8_t)(line & 0xFF)};
+    esp_lcd_panel_io_tx_param(io_handle, ST7789_VSCSAD, address, sizeof(address));
+
+    // Direct mode only redraws dirty areas of LVGL's frame, which still holds the old picture
+    if (toX >= SCREEN_WIDTH && pipeline == DISPLAY_PIPELINE_DIRECT) {
+        memcpy(disp_buf.buf1, frame, FULL_FRAME_PIXELS * sizeof(lv_color_t));
+        memcpy(disp_buf.buf2, frame, FULL_FRAME_PIXELS * sizeof(lv_color_t));
+    }
+
+    stats.scrollSteps++;
+    stats.scrollBytes += SCROLL_COMMAND_BYTES;
+    stats.totalScrollUs += micros() - start;
+}
@@ -0,0 +1,195 @@
+#include "feed_parse.h"
+
+uint32_t feedHash(const char *text) {
+    uint32_t hash = 2166136261u;  // FNV-1a
+    while (*text) {
+        hash ^= (uint8_t)*text++;
+        hash *= 16777619u;
+    }
+    return hash != 0 ? hash : 1;  // 0 marks an empty slot in the merge's seen set
+}
+
+uint32_t feedTextHash(const char *text) {
+    uint32_t hash = 2166136261u;
+    for (; *text; text++) {
+        uint8_t c = *text;
+        if (c < 0x80 && !isalnum(c)) continue;  // Bridges reformat spacing, links and punctuation
+        hash ^= c < 0x80 ? tolower(c) : c;
+        hash *= 16777619u;
+    }
+    return hash != 0 ? hash : 1;
+}
+
+// True if value is one entry of a comma-separated list, ignoring case
+static bool inList(const char *list, const char *value) {
+    size_t length = strlen(value);
+    for (const char *p = list; *p != '\0';) {
+        while (*p == ',' || *p == ' ') p++;
+        const char *end = p;
+        while (*end != '\0' && *end != ',') end++;
+        const char *last = end;
+        while (last > p && last[-1] == ' ') last--;
+        if (length > 0 && (size_t)(last - p) == length && strncasecmp(p, value, length) == 0) return true;
+        p = end;
+    }
+    return false;
+}
+
+// True if text contains an entry of a comma-separated list, ignoring case
+static bool containsListed(const char *list, const char *text) {
+    char word[48];
+    for (const char *p = list; *p != '\0';) {
+        while (*p == ',' || *p == ' ') p++;
+        size_t length = 0;
+        while (p[length] != '\0' && p[length] != ',') length++;
+        size_t copied = min(length, sizeof(word) - 1);
+        memcpy(word, p, copied);
+        while (copied > 0 && word[copied - 1] == ' ') copied--;
+        word[copied] = '\0';
+        if (copied > 0 && strcasestr(text, word) != NULL) return true;
+        p += length;
+    }
+    return false;
+}
+
+bool passesFeedRules(FeedSourceType type, const char *handle, const char *text) {
+    if (type != FEED_BLUESKY_AUTHOR) {
+        if (inList(FEED_EXCLUDE_AUTHORS, handle)) return false;
+        if (FEED_INCLUDE_AUTHORS[0] != '\0' && !inList(FEED_INCLUDE_AUTHORS, handle)) return false;
+    }
+    return !containsListed(FEED_EXCLUDE_WORDS, text);
+}
+
+// Mastodon content is HTML: paragraphs and <br> become line breaks, other tags
+// are dropped and the common entities decoded. Works in place.
+static void htmlToText(char *text) {
+    static const struct {
+        const char *name;
+        char c;
+    } entities[] = {{"&amp;", '&'}, {"&lt;", '<'}, {"&gt;", '>'}, {"&quot;", '"'}, {"&#39;", '\''}, {"&apos;", '\''}, {"&nbsp;", ' '}};
+
+    char *out = text;
+    const char *in = text;
+    while (*in != '\0') {
+        if (*in == '<') {
+            const char *end = strchr(in, '>');
+            if (end == NULL) break;  // Cut off mid-tag
+            bool lineBreak = strncasecmp(in, "<br", 3) == 0 || (strncasecmp(in, "<p", 2) == 0 && out > text);
+            if (lineBreak) *out++ = '\n';
+            in = end + 1;
+        } else if (*in == '&') {
+            size_t i = 0;
+            while (i < sizeof(entities) / sizeof(entities[0]) && strncmp(in, entities[i].name, strlen(entities[i].name)) != 0) i++;
+            if (i < sizeof(entities) / sizeof(entities[0])) {
+                *out++ = entities[i].c;
+                in += strlen(entities[i].name);
+            } else {
+                *out++ = *in++;
+            }
+        } else {
+            *out++ = *in++;
+        }
+    }
+    *out = '\0';
+}
+
+// Only the fields the post screens use are kept; embeds, facets, labels and
+// viewer state are skipped while streaming
+static void buildFilter(FeedSourceType type, JsonDocument &filter) {
+    if (type == FEED_MASTODON_TAG) {
+        filter["id"] = true;
+        filter["uri"] = true;
+        filter["created_at"] = true;
+        filter["content"] = true;
+        filter["spoiler_text"] = true;
+        filter["account"]["acct"] = true;
+        filter["account"]["avatar_static"] = true;
+        return;
+    }
+    JsonObject post = type == FEED_BLUESKY_AUTHOR ? filter.createNestedObject("post") : filter.to<JsonObject>();
+    if (type == FEED_BLUESKY_AUTHOR) filter["reason"] = true;
+    post["uri"] = true;
+    post["author"]["handle"] = true;
+    post["author"]["avatar"] = true;
+    post["record"]["text"] = true;
+    post["record"]["createdAt"] = true;
+}
+
+// Fills item from one parsed array element. cursorValue is what this post would
+// advance the source's cursor to.
+static FeedItemResult readItem(const FeedSource &source, JsonDocument &doc, FeedItem &item, const char *&cursorValue) {
+    const char *uri;
+    const char *createdAt;
+    if (source.type == FEED_MASTODON_TAG) {
+        uri = doc["uri"] | "";
+        createdAt = doc["created_at"] | "";
+        cursorValue = doc["id"] | "";
+        const char *acct = doc["account"]["acct"] | "";
+        if (strchr(acct, '@') != NULL) {
+            copyUtf8(item.handle, sizeof(item.handle), acct);
+        } else {
+            // Local accounts come without the instance
+            const char *host = strstr(source.server, "://");
+            snprintf(item.handle, sizeof(item.handle), "%s@%s", acct, host != NULL ? host + 3 : source.server);
+        }
+        copyUtf8(item.avatar, sizeof(item.avatar), doc["account"]["avatar_static"] | "");
+        copyUtf8(item.text, sizeof(item.text), doc["content"] | "");
+        htmlToText(item.text);
+        if ((doc["spoiler_text"] | "")[0] != '\0') {
+            item.createdAtMs = parseIsoTimestamp(createdAt);
+            return FEED_ITEM_FILTERED;  // Behind a content warning
+        }
+    } else {
+        // Reposts and pins in an author feed carry their original date, out of order
+        if (source.type == FEED_BLUESKY_AUTHOR && !doc["reason"].isNull()) return FEED_ITEM_SKIPPED;
+        JsonObject post = source.type == FEED_BLUESKY_AUTHOR ? doc["post"].as<JsonObject>() : doc.as<JsonObject>();
+        uri = post["uri"] | "";
+        createdAt = post["record"]["createdAt"] | "";
+        cursorValue = createdAt;
+        copyUtf8(item.handle, sizeof(item.handle), post["author"]["handle"] | "");
+        copyUtf8(item.avatar, sizeof(item.avatar), post["author"]["avatar"] | "");
+        copyUtf8(item.text, sizeof(item.text), post["record"]["text"] | "");
+    }
+
+    item.createdAtMs = parseIsoTimestamp(createdAt);
+    item.network = source.type == FEED_MASTODON_TAG ? FEED_NETWORK_MASTODON : FEED_NETWORK_BLUESKY;
+    item.uriHash = feedHash(uri);
+    item.textHash = feedTextHash(item.text);
+    if (uri[0] == '\0' || item.handle[0] == '\0' || item.text[0] == '\0' || item.createdAtMs == 0) return FEED_ITEM_SKIPPED;
+    return passesFeedRules(source.type, item.handle, item.text) ? FEED_ITEM_POST : FEED_ITEM_FILTERED;
+}
+
+FeedParser::FeedParser(const FeedSource &source, JsonStreamReader &reader, JsonDocument &doc)
+    : source(source), reader(reader), doc(doc) {
+    buildFilter(source.type, filter);
+}
+
+bool FeedParser::next(FeedItem &item) {
+    if (done) return false;
+    if (!started) {
+        started = true;
+        const char *key = source.type == FEED_BLUESKY_TAG ? "posts" : source.type == FEED_BLUESKY_AUTHOR ? "feed" : NULL;
+        if (!reader.findArray(key)) {
+            parseError = true;  // Not the response we asked for
+            done = true;
+        }
+    } else {
+        int c = reader.skipUntil(",]");
+        if (c < 0) parseError = true;  // Cut off between two posts
+        done = c != ',';
+    }
+    if (done) return false;
+
+    DeserializationError error = deserializeJson(doc, reader, DeserializationOption::Filter(filter));
+    if (error) {
+        // An empty array lands here too ("]" isn't a value)
+        if (error != DeserializationError::InvalidInput || count > 0) parseError = true;
+        done = true;
+        return false;
+    }
+    count++;
+    if (doc.memoryUsage() > peak) peak = doc.memoryUsage();
+    cursor = "";
+    itemResult = readItem(source, doc, item, cursor);
+    return true;
+}
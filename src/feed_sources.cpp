@@ -0,0 +1,278 @@
+#include "feed_sources.h"
+#include <ArduinoJson.h>
+#include <esp_heap_caps.h>
+#include "bluesky.h"
+#include "bluesky_session.h"
+#include "feed_parse.h"
+#include "json_stream_reader.h"
+#include "poll_scheduler.h"
+#include "xrpc_client.h"
+
+// Incremental sync: only ask for posts since the newest one each source has
+// returned and stop reading once its stream reaches older posts. Set to 0 to
+// always download the full page.
+#ifndef BLUESKY_INCREMENTAL_SYNC
+#define BLUESKY_INCREMENTAL_SYNC 1
+#endif
+
+#define CLOCK_VALID_AFTER 1600000000  // ratelimit-reset is wall clock, so it needs SNTP
+
+// Source tasks share core 0 with the WiFi stack and the feed worker
+#define SOURCE_TASK_STACK 12288
+#define SOURCE_TASK_PRIORITY 1
+#define SOURCE_TASK_CORE 0
+
+static const FeedSource sources[] = {FEED_SOURCES};
+#define SOURCE_COUNT ((int)(sizeof(sources) / sizeof(sources[0])))
+static_assert(SOURCE_COUNT <= FEED_MAX_SOURCES, "FEED_SOURCES lists more than FEED_MAX_SOURCES sources");
+
+struct SourceState {
+    TaskHandle_t task;
+    QueueHandle_t freeItems;   // Items the source can fill
+    QueueHandle_t readyItems;  // Filled items for the merge, then NULL at the end
+    FeedItem *pool;
+    DynamicJsonDocument *doc;
+    char name[64];
+    char url[384];
+    char cursor[40];  // Newest createdAt (Bluesky) or status id (Mastodon) seen
+    int64_t cursorMs;
+    bool skip;        // Bluesky source without a session this round
+    SourceStats stats;
+};
+
+static SourceState states[FEED_MAX_SOURCES];
+static volatile bool cancelled = false;
+
+// Appends an ISO timestamp to dest, escaping the characters that aren't safe in a query string
+static void appendEncodedTimestamp(char *dest, size_t size, const char *timestamp) {
+    size_t length = strlen(dest);
+    for (const char *c = timestamp; *c && length + 4 < size; c++) {
+        if (*c == ':') length += sprintf(dest + length, "%%3A");
+        else if (*c == '+') length += sprintf(dest + length, "%%2B");
+        else dest[length++] = *c;
+    }
+    dest[length] = '\0';
+}
+
+static void buildUrl(int index) {
+    const FeedSource &source = sources[index];
+    SourceState &state = states[index];
+    bool incremental = BLUESKY_INCREMENTAL_SYNC && state.cursor[0] != '\0';
+    switch (source.type) {
+        case FEED_BLUESKY_TAG:
+            snprintf(state.url, sizeof(state.url), "%s?q=%%23%s&limit=%d&sort=latest",
+                     blueskyEndpoint(BLUESKY_API_URL).c_str(), source.query, FEED_PAGE_LIMIT);
+            if (incremental) {
+                // Inclusive, so the boundary post comes back too
+                strlcat(state.url, "&since=", sizeof(state.url));
+                appendEncodedTimestamp(state.url, sizeof(state.url), state.cursor);
+            }
+            break;
+        case FEED_BLUESKY_AUTHOR:
+            snprintf(state.url, sizeof(state.url), "%s?actor=%s&limit=%d&filter=posts_no_replies",
+                     blueskyEndpoint(BLUESKY_AUTHOR_FEED_URL).c_str(), source.query, FEED_PAGE_LIMIT);
+            break;
+        case FEED_MASTODON_TAG: {
+            String timeline = String(source.server) + "/api/v1/timelines/tag/" + source.query;
+            snprintf(state.url, sizeof(state.url), "%s?limit=%d", blueskyEndpoint(timeline.c_str()).c_str(), FEED_PAGE_LIMIT);
+            if (incremental) {
+                strlcat(state.url, "&since_id=", sizeof(state.url));
+                strlcat(state.url, state.cursor, sizeof(state.url));
+            }
+            break;
+        }
+    }
+}
+
+// Parses straight from the socket, one array element at a time, and hands each
+// post to the merge as soon as it's read
+static void readPosts(int index, JsonStreamReader &reader) {
+    const FeedSource &source = sources[index];
+    SourceState &state = states[index];
+    SourceStats &stats = state.stats;
+
+    int64_t newestMs = state.cursorMs;
+    char newest[sizeof(state.cursor)];
+    strlcpy(newest, state.cursor, sizeof(newest));
+
+    FeedParser parser(source, reader, *state.doc);
+    FeedItem *item = NULL;
+    for (;;) {
+        if (cancelled) {
+            stats.cancelled = true;
+            break;
+        }
+        if (item == NULL) xQueueReceive(state.freeItems, &item, portMAX_DELAY);
+        if (!parser.next(*item)) break;
+        FeedItemResult result = parser.result();
+        if (result != FEED_ITEM_SKIPPED && item->createdAtMs > newestMs) {
+            newestMs = item->createdAtMs;
+            strlcpy(newest, parser.cursorValue(), sizeof(newest));
+        }
+
+        // Newest first: a post older than the last refresh's newest means the rest is known
+        bool known = result != FEED_ITEM_SKIPPED && state.cursorMs > 0 && item->createdAtMs < state.cursorMs;
+        if (result == FEED_ITEM_POST && !known) {
+            stats.posts++;
+            xQueueSend(state.readyItems, &item, portMAX_DELAY);
+            item = NULL;
+        } else if (result == FEED_ITEM_FILTERED) {
+            stats.filtered++;
+        }
+        if (known) break;
+    }
+    if (item != NULL) xQueueSend(state.freeItems, &item, 0);
+
+    stats.parseError = parser.error();
+    stats.poolPeak = parser.poolPeak();
+    stats.bytesRead = reader.bytesRead();
+    state.cursorMs = newestMs;
+    strlcpy(state.cursor, newest, sizeof(state.cursor));
+}
+
+// How long the server wants us to stay away: Retry-After, or until ratelimit-reset
+// once the window is used up. With only a few requests left in the window they are
+// spread over the rest of it.
+static uint32_t serverWaitMs(HTTPClient &http, int httpCode) {
+    uint32_t waitMs = 0;
+    if (http.hasHeader("Retry-After")) waitMs = max(http.header("Retry-After").toInt(), 0L) * 1000;
+
+    time_t now = time(nullptr);
+    if (http.hasHeader("ratelimit-reset") && http.hasHeader("ratelimit-remaining") && now > CLOCK_VALID_AFTER) {
+        long resetInMs = (http.header("ratelimit-reset").toInt() - now) * 1000;
+        long remaining = http.header("ratelimit-remaining").toInt();
+        if (resetInMs > 0 && (httpCode == 429 || remaining <= 0)) {
+            waitMs = max(waitMs, (uint32_t)resetInMs);
+        } else if (resetInMs > 0 && remaining < POLL_RATE_RESERVE) {
+            waitMs = max(waitMs, (uint32_t)(resetInMs / remaining));
+        }
+    }
+    return waitMs;
+}
+
+static void fetchSource(int index) {
+    const FeedSource &source = sources[index];
+    SourceState &state = states[index];
+    SourceStats &stats = state.stats;
+    memset(&stats, 0, sizeof(stats));
+    if (state.skip) return;
+
+    uint32_t start = micros();
+    buildUrl(index);
+    XrpcClient xrpc;
+    if (!xrpc.begin(state.url)) {
+        stats.httpCode = HTTPC_ERROR_CONNECTION_REFUSED;
+        return;
+    }
+    if (source.type != FEED_MASTODON_TAG) xrpc.addHeader("Authorization", "Bearer " + blueskyAccessToken());
+    const char *headerKeys[] = {"Retry-After", "ratelimit-remaining", "ratelimit-reset"};
+    xrpc.collectHeaders(headerKeys, 3);
+    stats.httpCode = xrpc.GET();
+    if (stats.httpCode > 0) stats.serverWaitMs = serverWaitMs(xrpc.http(), stats.httpCode);
+    if (stats.httpCode == HTTP_CODE_OK) {
+        JsonStreamReader reader = xrpc.body();
+        readPosts(index, reader);
+        xrpc.end(&reader);  // A cancelled read leaves the rest of the page, drained to keep the connection
+    }
+    xrpc.end();
+    stats.timing = xrpc.timing();
+    stats.durationUs = micros() - start;
+}
+
+static void sourceTask(void *param) {
+    int index = (int)(intptr_t)param;
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        fetchSource(index);
+        FeedItem *end = NULL;
+        xQueueSend(states[index].readyItems, &end, portMAX_DELAY);
+    }
+}
+
+bool startFeedSources() {
+    for (int i = 0; i < SOURCE_COUNT; i++) {
+        SourceState &state = states[i];
+        if (state.task != NULL) continue;
+
+        const FeedSource &source = sources[i];
+        if (source.type == FEED_MASTODON_TAG) {
+            const char *host = strstr(source.server, "://");
+            snprintf(state.name, sizeof(state.name), "#%s@%s", source.query, host != NULL ? host + 3 : source.server);
+        } else {
+            snprintf(state.name, sizeof(state.name), "%s%s", source.type == FEED_BLUESKY_TAG ? "#" : "@", source.query);
+        }
+
+        size_t poolBytes = sizeof(FeedItem) * FEED_SOURCE_QUEUE;
+        state.pool = (FeedItem *)heap_caps_malloc(poolBytes, MALLOC_CAP_SPIRAM);
+        if (state.pool == NULL) state.pool = (FeedItem *)malloc(poolBytes);
+        state.doc = new DynamicJsonDocument(BLUESKY_JSON_CAPACITY);
+        state.freeItems = xQueueCreate(FEED_SOURCE_QUEUE, sizeof(FeedItem *));
+        state.readyItems = xQueueCreate(FEED_SOURCE_QUEUE + 1, sizeof(FeedItem *));  // Room for the end marker
+        if (state.pool == NULL || state.doc->capacity() == 0 || state.freeItems == NULL || state.readyItems == NULL) {
+            Serial.print("ERROR: Not enough memory for feed source ");
+            Serial.println(state.name);
+            return false;
+        }
+        for (int slot = 0; slot < FEED_SOURCE_QUEUE; slot++) {
+            FeedItem *item = &state.pool[slot];
+            xQueueSend(state.freeItems, &item, 0);
+        }
+
+        char taskName[16];
+        snprintf(taskName, sizeof(taskName), "source%d", i);
+        xTaskCreatePinnedToCore(sourceTask, taskName, SOURCE_TASK_STACK, (void *)(intptr_t)i,
+                                SOURCE_TASK_PRIORITY, &state.task, SOURCE_TASK_CORE);
+    }
+    return true;
+}
+
+int feedSourceCount() {
+    return SOURCE_COUNT;
+}
+
+const FeedSource &feedSource(int index) {
+    return sources[index];
+}
+
+const char *feedSourceName(int index) {
+    return states[index].name;
+}
+
+bool feedSourcesNeedSession() {
+    for (int i = 0; i < SOURCE_COUNT; i++) {
+        if (sources[i].type != FEED_MASTODON_TAG) return true;
+    }
+    return false;
+}
+
+void beginSourceFetches(bool blueskySession) {
+    cancelled = false;
+    for (int i = 0; i < SOURCE_COUNT; i++) {
+        states[i].skip = sources[i].type != FEED_MASTODON_TAG && !blueskySession;
+        xTaskNotifyGive(states[i].task);
+    }
+}
+
+bool nextSourceItem(int source, FeedItem *&item) {
+    xQueueReceive(states[source].readyItems, &item, portMAX_DELAY);
+    return item != NULL;
+}
+
+void releaseSourceItem(int source, FeedItem *item) {
+    xQueueSend(states[source].freeItems, &item, 0);
+}
+
+void cancelSourceFetches() {
+    cancelled = true;
+}
+
+const SourceStats &sourceStats(int source) {
+    return states[source].stats;
+}
+
+void resetSourceCursors() {
+    for (int i = 0; i < SOURCE_COUNT; i++) {
+        states[i].cursor[0] = '\0';
+        states[i].cursorMs = 0;
+    }
+}
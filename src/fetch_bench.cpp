@@ -0,0 +1,228 @@
+#ifdef FETCH_BENCH
+
+#include "fetch_bench.h"
+#include "bluesky.h"
+#include "feed_sources.h"
+#include "wifi_manager.h"
+#include "poll_scheduler.h"
+#include "xrpc_client.h"
+
+#define FETCH_BENCH_STACK 16384
+
+struct BenchScenario {
+    const char *name;        // Scenario name on the mock server
+    bool fullSync;           // Forget seen posts before every fetch
+};
+
+static const BenchScenario scenarios[] = {
+    {"ok", true},            // The searchPosts sample
+    {"ok", false},           // Same payload, incremental sync after the first fetch
+    {"large", true},         // Synthetic page with long texts and embeds
+    {"slow", true},          // Delayed headers and a throttled body
+    {"chunked", true},       // Chunked transfer encoding
+    {"unauthorized", true},  // 401 on every new access token, forcing a refresh
+    {"ratelimited", true},   // 429 with ratelimit-* headers
+    {"truncated", true},     // Body cut off halfway
+    {"staggered", true},     // Each source answers after a different delay
+};
+
+struct ConnectionMode {
+    const char *name;
+    bool keepAlive;
+    bool resumption;
+};
+
+// The sample payload again, each way a connection can be had
+static const ConnectionMode connectionModes[] = {
+    {"new connections", false, false},  // DNS, TCP and a full TLS handshake per request
+    {"resumed TLS", false, true},       // New connections, abbreviated handshakes
+    {"kept alive", true, true},         // One connection per source, reused
+};
+
+static bool selectScenario(const char *name) {
+    XrpcClient xrpc;
+    return xrpc.begin(String(MOCK_XRPC_URL) + "/_mock/scenario?name=" + name) && xrpc.GET() == HTTP_CODE_OK;
+}
+
+static uint32_t percentile(const uint32_t *sorted, int count, int pct) {
+    int index = count * pct / 100;
+    if (index >= count) index = count - 1;
+    return sorted[index];
+}
+
+static void runScenario(const BenchScenario &scenario) {
+    if (!selectScenario(scenario.name)) {
+        Serial.print("Mock server didn't accept scenario ");
+        Serial.println(scenario.name);
+        return;
+    }
+
+    uint32_t latencies[FETCH_BENCH_ITERATIONS];
+    uint64_t totalBytes = 0;
+    uint32_t minFreeHeap = UINT32_MAX;
+    uint32_t largestAtMin = 0;
+    size_t poolPeak = 0;
+    uint64_t slowestSourceUs = 0;
+    uint64_t totalSourceUs = 0;
+    int succeeded = 0;
+
+    resetFeedSyncState();
+    for (int i = 0; i < FETCH_BENCH_ITERATIONS; i++) {
+        if (scenario.fullSync) resetFeedSyncState();
+        fetchFeeds();
+
+        const FetchStats &stats = lastFetchStats();
+        latencies[i] = stats.durationUs;
+        totalBytes += stats.bytesRead;
+        slowestSourceUs += stats.slowestSourceUs;
+        totalSourceUs += stats.totalSourceUs;
+        if (stats.httpCode == HTTP_CODE_OK && !stats.parseError) succeeded++;
+        if (stats.poolPeak > poolPeak) poolPeak = stats.poolPeak;
+        if (stats.minFreeHeap < minFreeHeap) {
+            minFreeHeap = stats.minFreeHeap;
+            largestAtMin = stats.largestBlockAtMin;
+        }
+    }
+
+    // Insertion sort; the sample is small
+    for (int i = 1; i < FETCH_BENCH_ITERATIONS; i++) {
+        uint32_t value = latencies[i];
+        int j = i - 1;
+        while (j >= 0 && latencies[j] > value) {
+            latencies[j + 1] = latencies[j];
+            j--;
+        }
+        latencies[j + 1] = value;
+    }
+
+    Serial.print("BENCH ");
+    Serial.print(scenario.name);
+    Serial.print(scenario.fullSync ? " (full)" : " (incremental)");
+    Serial.print(": ok ");
+    Serial.print(succeeded);
+    Serial.print("/");
+    Serial.print(FETCH_BENCH_ITERATIONS);
+    Serial.print(", p50 ");
+    Serial.print(percentile(latencies, FETCH_BENCH_ITERATIONS, 50) / 1000);
+    Serial.print(" ms, p90 ");
+    Serial.print(percentile(latencies, FETCH_BENCH_ITERATIONS, 90) / 1000);
+    Serial.print(" ms, p99 ");
+    Serial.print(percentile(latencies, FETCH_BENCH_ITERATIONS, 99) / 1000);
+    Serial.print(" ms, max ");
+    Serial.print(latencies[FETCH_BENCH_ITERATIONS - 1] / 1000);
+    Serial.print(" ms, avg bytes ");
+    Serial.print((uint32_t)(totalBytes / FETCH_BENCH_ITERATIONS));
+    Serial.print(", avg slowest source ");
+    Serial.print((uint32_t)(slowestSourceUs / FETCH_BENCH_ITERATIONS / 1000));
+    Serial.print(" ms, sources added up ");
+    Serial.print((uint32_t)(totalSourceUs / FETCH_BENCH_ITERATIONS / 1000));
+    Serial.print(" ms, JSON pool peak ");
+    Serial.print(poolPeak);
+    Serial.print(", min free heap ");
+    Serial.print(minFreeHeap);
+    Serial.print(", largest block ");
+    Serial.print(largestAtMin);
+    Serial.print(" (");
+    Serial.print(minFreeHeap > 0 ? 100 - (uint32_t)((uint64_t)largestAtMin * 100 / minFreeHeap) : 0);
+    Serial.println("% fragmented)");
+}
+
+// Polls the way the feed worker does for durationMs, or just waits if paused
+static void pollFor(uint32_t durationMs) {
+    uint32_t start = millis();
+    for (;;) {
+        uint32_t leftMs = durationMs - (millis() - start);
+        if ((int32_t)leftMs <= 0) return;
+        uint32_t dueInMs = pollingPaused() ? leftMs : pollDueInMs(pollIntervalMs(), false);
+        if (dueInMs > 0) {
+            vTaskDelay(pdMS_TO_TICKS(min(dueInMs, leftMs)));
+            continue;
+        }
+        fetchFeeds();
+    }
+}
+
+static void printMockStats() {
+    XrpcClient xrpc;
+    if (xrpc.begin(String(MOCK_XRPC_URL) + "/_mock/stats") && xrpc.GET() == HTTP_CODE_OK) {
+        Serial.print("Mock server: ");
+        Serial.println(xrpc.getString());
+    }
+}
+
+// Same fetches with keep-alive and TLS session resumption on and off. Against
+// an https:// mock this splits the cost of a request into DNS, TCP, TLS, first
+// byte and body, as printed per source and summed up in the XRPC stats.
+static void runConnectionModes() {
+    for (const ConnectionMode &mode : connectionModes) {
+        xrpcSetKeepAlive(mode.keepAlive);
+        xrpcSetResumption(mode.resumption);
+        resetXrpcStats();
+        Serial.print("BENCH connections, ");
+        Serial.print(mode.name);
+        Serial.println(":");
+        runScenario(scenarios[0]);
+        printXrpcStats();
+    }
+    xrpcSetKeepAlive(true);
+    xrpcSetResumption(true);
+    printMockStats();
+}
+
+// Adaptive polling against scripted traffic: the mock times every post from its
+// arrival to the poll that picked it up, and counts the polls that found nothing
+static void runPollSchedule() {
+    if (!selectScenario("scripted")) {
+        Serial.println("Mock server didn't accept scenario scripted");
+        return;
+    }
+    resetFeedSyncState();
+    resetPollStats();
+    uint32_t quarterMs = FETCH_BENCH_POLL_MINUTES * 60000UL / 4;
+    pollFor(quarterMs * 2);
+
+    uint32_t pollsBefore = pollStats().polls;
+    setPollingPaused(true);
+    pollFor(quarterMs);
+    setPollingPaused(false);
+    uint32_t pausedPolls = pollStats().polls - pollsBefore;
+    pollFor(quarterMs);
+
+    Serial.print("BENCH poll schedule (");
+    Serial.print(FETCH_BENCH_POLL_MINUTES);
+    Serial.print(" min, ");
+    Serial.print(pausedPolls);
+    Serial.println(pausedPolls == 0 ? " polls while paused):" : " polls while paused, expected none):");
+    printPollStats();
+    printMockStats();
+}
+
+static void fetchBenchTask(void *param) {
+    waitForWifi(UINT32_MAX);
+
+    xrpcInit();
+    setBlueskyServer(MOCK_XRPC_URL);
+    if (!startFeedSources()) {
+        vTaskDelete(NULL);
+        return;
+    }
+    Serial.print("\n=== Fetch benchmark against ");
+    Serial.print(MOCK_XRPC_URL);
+    Serial.println(" ===");
+
+    for (const BenchScenario &scenario : scenarios) {
+        runScenario(scenario);
+    }
+    runConnectionModes();
+    if (FETCH_BENCH_POLL_MINUTES > 0) runPollSchedule();
+
+    Serial.println("=== Fetch benchmark complete ===\n");
+    selectScenario("ok");
+    vTaskDelete(NULL);
+}
+
+void startFetchBenchmark() {
+    xTaskCreatePinnedToCore(fetchBenchTask, "fetchbench", FETCH_BENCH_STACK, NULL, 1, NULL, 0);
+}
+
+#endif // FETCH_BENCH
@@ -0,0 +1,296 @@
+#include "fonts.h"
+#include <LittleFS.h>
+#include <atomic>
+#include "post_layout.h"
+
+#define FALLBACK_MAGIC 0x31464742  // "BGF1"
+#define FALLBACK_VERSION 1
+
+// File header, followed by count index entries sorted by codepoint, then the
+// PackBits-compressed 4 bpp bitmaps (tools/subset_fonts.py writes it)
+struct FallbackHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t size;
+    uint16_t lineHeight;
+    int16_t baseLine;
+    uint8_t bpp;
+    uint8_t reserved[3];
+    uint32_t count;
+};
+
+struct FallbackGlyph {
+    uint32_t codepoint;
+    uint32_t offset;
+    uint16_t advW;  // 1/16 px
+    uint8_t boxW;
+    uint8_t boxH;
+    int8_t ofsX;
+    int8_t ofsY;
+    uint16_t length;  // Compressed
+};
+
+static_assert(sizeof(FallbackHeader) == 20, "BGF1 header is 20 bytes");
+static_assert(sizeof(FallbackGlyph) == 16, "BGF1 index entries are 16 bytes");
+
+struct FallbackFont {
+    lv_font_t font;
+    File file;
+    FallbackGlyph *glyphs;  // PSRAM
+    uint32_t count;
+    uint16_t size;
+};
+
+// Unpacked bitmaps, replaced in clock order. Only the UI task draws, so only it
+// touches the cache; the layout on the feed worker needs the index alone.
+struct GlyphSlot {
+    const FallbackFont *font;
+    uint32_t codepoint;
+    bool referenced;
+    uint8_t bitmap[FONT_GLYPH_MAX_BYTES];
+};
+
+static FallbackFont fallbacks[FONT_FALLBACK_MAX];
+static int fallbackCount = 0;
+static GlyphSlot *slots = NULL;  // PSRAM
+static int clockHand = 0;
+static uint8_t packed[FONT_GLYPH_MAX_BYTES + FONT_GLYPH_MAX_BYTES / 128 + 1];
+static FontStats stats;
+static std::atomic<uint32_t> lookups(0);  // Both tasks look glyphs up
+static std::atomic<uint32_t> missing(0);
+
+static const FallbackGlyph *findGlyph(const FallbackFont &fallback, uint32_t codepoint) {
+    uint32_t low = 0;
+    uint32_t high = fallback.count;
+    while (low < high) {
+        uint32_t mid = (low + high) / 2;
+        if (fallback.glyphs[mid].codepoint < codepoint) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low < fallback.count && fallback.glyphs[low].codepoint == codepoint ? &fallback.glyphs[low] : NULL;
+}
+
+// Joiners and variation selectors (every emoji with U+FE0F) take no space instead of drawing a box
+static bool zeroWidth(uint32_t codepoint) {
+    return (codepoint >= 0x200B && codepoint <= 0x200F) || codepoint == 0x2060 ||
+           (codepoint >= 0xFE00 && codepoint <= 0xFE0F) || codepoint == 0xFEFF;
+}
+
+static bool getFallbackGlyphDsc(const lv_font_t *font, lv_font_glyph_dsc_t *dsc, uint32_t letter, uint32_t next) {
+    LV_UNUSED(next);
+    const FallbackFont &fallback = *(const FallbackFont *)font->dsc;
+    lookups++;
+    const FallbackGlyph *glyph = findGlyph(fallback, letter);
+    dsc->bpp = 4;
+    dsc->is_placeholder = false;
+    if (glyph == NULL) {
+        if (!zeroWidth(letter)) {
+            missing++;
+            return false;
+        }
+        dsc->adv_w = 0;
+        dsc->box_w = 0;
+        dsc->box_h = 0;
+        dsc->ofs_x = 0;
+        dsc->ofs_y = 0;
+        return true;
+    }
+    dsc->adv_w = (glyph->advW + 8) >> 4;
+    dsc->box_w = glyph->boxW;
+    dsc->box_h = glyph->boxH;
+    dsc->ofs_x = glyph->ofsX;
+    dsc->ofs_y = glyph->ofsY;
+    return true;
+}
+
+// PackBits: n < 128 copies n + 1 bytes, n >= 128 repeats the next byte n - 125 times
+static bool unpack(const uint8_t *in, size_t inLength, uint8_t *out, size_t outLength) {
+    size_t i = 0;
+    size_t o = 0;
+    while (o < outLength && i < inLength) {
+        uint8_t n = in[i++];
+        if (n < 128) {
+            size_t count = n + 1;
+            if (i + count > inLength || o + count > outLength) return false;
+            memcpy(out + o, in + i, count);
+            i += count;
+            o += count;
+        } else {
+            size_t count = n - 125;
+            if (i >= inLength || o + count > outLength) return false;
+            memset(out + o, in[i++], count);
+            o += count;
+        }
+    }
+    return o == outLength;
+}
+
+static const uint8_t *getFallbackGlyphBitmap(const lv_font_t *font, uint32_t letter) {
+    const FallbackFont &fallback = *(const FallbackFont *)font->dsc;
+    const FallbackGlyph *glyph = findGlyph(fallback, letter);
+    if (glyph == NULL) return NULL;
+
+    for (int i = 0; i < FONT_CACHE_SLOTS; i++) {
+        if (slots[i].font == &fallback && slots[i].codepoint == letter) {
+            slots[i].referenced = true;
+            stats.hits++;
+            return slots[i].bitmap;
+        }
+    }
+
+    // Second chance: skip recently used slots once, take the first that wasn't
+    while (slots[clockHand].referenced) {
+        slots[clockHand].referenced = false;
+        clockHand = (clockHand + 1) % FONT_CACHE_SLOTS;
+    }
+    GlyphSlot &slot = slots[clockHand];
+    clockHand = (clockHand + 1) % FONT_CACHE_SLOTS;
+
+    uint32_t start = micros();
+    size_t bytes = (glyph->boxW * glyph->boxH * 4 + 7) / 8;
+    slot.font = NULL;
+    File &file = ((FallbackFont &)fallback).file;
+    if (bytes > FONT_GLYPH_MAX_BYTES || glyph->length > sizeof(packed) || !file.seek(glyph->offset) ||
+        file.read(packed, glyph->length) != glyph->length || !unpack(packed, glyph->length, slot.bitmap, bytes)) {
+        return NULL;
+    }
+    slot.font = &fallback;
+    slot.codepoint = letter;
+    slot.referenced = true;
+
+    uint32_t elapsed = micros() - start;
+    stats.misses++;
+    stats.bytesRead += glyph->length;
+    stats.totalLoadUs += elapsed;
+    if (elapsed > stats.maxLoadUs) stats.maxLoadUs = elapsed;
+    return slot.bitmap;
+}
+
+static bool loadFallback(FallbackFont &fallback, const char *path) {
+    fallback.file = LittleFS.open(path, "r");
+    if (!fallback.file) return false;
+
+    FallbackHeader header;
+    if (fallback.file.read((uint8_t *)&header, sizeof(header)) != sizeof(header) ||
+        header.magic != FALLBACK_MAGIC || header.version != FALLBACK_VERSION || header.bpp != 4 || header.count == 0) {
+        Serial.print("WARNING: ");
+        Serial.print(path);
+        Serial.println(" is not a BGF1 font, ignored");
+        fallback.file.close();
+        return false;
+    }
+
+    size_t indexBytes = header.count * sizeof(FallbackGlyph);
+    fallback.glyphs = (FallbackGlyph *)ps_malloc(indexBytes);
+    if (fallback.glyphs == NULL || fallback.file.read((uint8_t *)fallback.glyphs, indexBytes) != indexBytes) {
+        free(fallback.glyphs);
+        fallback.glyphs = NULL;
+        fallback.file.close();
+        return false;
+    }
+    fallback.count = header.count;
+    fallback.size = header.size;
+
+    memset(&fallback.font, 0, sizeof(fallback.font));
+    fallback.font.get_glyph_dsc = getFallbackGlyphDsc;
+    fallback.font.get_glyph_bitmap = getFallbackGlyphBitmap;
+    fallback.font.line_height = header.lineHeight;
+    fallback.font.base_line = header.baseLine;
+    fallback.font.subpx = LV_FONT_SUBPX_NONE;
+    fallback.font.dsc = &fallback;
+
+    stats.glyphs += header.count;
+    stats.indexBytes += indexBytes;
+    return true;
+}
+
+// The loaded fallback closest in size
+static const lv_font_t *fallbackFor(uint8_t fontSize) {
+    const FallbackFont *best = NULL;
+    for (int i = 0; i < fallbackCount; i++) {
+        if (best == NULL || abs(fallbacks[i].size - fontSize) < abs(best->size - fontSize)) {
+            best = &fallbacks[i];
+        }
+    }
+    return best != NULL ? &best->font : NULL;
+}
+
+void fontFallbackBegin() {
+    if (fallbackCount > 0) return;
+    if (!LittleFS.begin(true)) {
+        Serial.println("WARNING: LittleFS unavailable, no fallback font");
+        return;
+    }
+
+    File dir = LittleFS.open(FONT_FALLBACK_DIR);
+    if (dir && dir.isDirectory()) {
+        for (File entry = dir.openNextFile(); entry && fallbackCount < FONT_FALLBACK_MAX; entry = dir.openNextFile()) {
+            char path[64];
+            snprintf(path, sizeof(path), "%s/%s", FONT_FALLBACK_DIR, entry.name());
+            bool isFont = !entry.isDirectory() && strncmp(entry.name(), "fallback_", 9) == 0;
+            entry.close();
+            if (isFont && loadFallback(fallbacks[fallbackCount], path)) fallbackCount++;
+        }
+    }
+    if (fallbackCount == 0) {
+        Serial.println("No fallback font in " FONT_FALLBACK_DIR ", characters outside the post fonts show as boxes");
+        return;
+    }
+
+    slots = (GlyphSlot *)ps_malloc(FONT_CACHE_SLOTS * sizeof(GlyphSlot));
+    if (slots == NULL) {
+        Serial.println("ERROR: No PSRAM for the glyph cache, fallback font disabled");
+        for (int i = 0; i < fallbackCount; i++) {
+            free(fallbacks[i].glyphs);
+            fallbacks[i].file.close();
+        }
+        fallbackCount = 0;
+        return;
+    }
+    memset(slots, 0, FONT_CACHE_SLOTS * sizeof(GlyphSlot));
+    stats.fallbacks = fallbackCount;
+    postLayoutSetFallback(fallbackFor);
+
+    Serial.print("Fallback font: ");
+    Serial.print(stats.glyphs);
+    Serial.print(" glyphs in ");
+    Serial.print(fallbackCount);
+    Serial.print(" size(s), ");
+    Serial.print(stats.indexBytes);
+    Serial.println(" bytes of index in PSRAM");
+}
+
+const FontStats &fontStats() {
+    stats.lookups = lookups.load();
+    stats.missing = missing.load();
+    return stats;
+}
+
+void printFontStats() {
+    const FontStats &s = fontStats();
+    uint32_t loads = s.hits + s.misses;
+    Serial.print("Fonts: ");
+    Serial.print(s.fallbacks);
+    Serial.print(" fallback size(s), ");
+    Serial.print(s.glyphs);
+    Serial.print(" glyphs; ");
+    Serial.print(s.lookups);
+    Serial.print(" lookups past the post fonts, ");
+    Serial.print(s.missing);
+    Serial.print(" missing; bitmap cache hit rate ");
+    Serial.print(loads > 0 ? s.hits * 100 / loads : 0);
+    Serial.print("% (");
+    Serial.print(s.hits);
+    Serial.print("/");
+    Serial.print(loads);
+    Serial.print("), ");
+    Serial.print(s.bytesRead);
+    Serial.print(" bytes read, load avg ");
+    Serial.print(s.misses > 0 ? (uint32_t)(s.totalLoadUs / s.misses) : 0);
+    Serial.print(" us max ");
+    Serial.print(s.maxLoadUs);
+    Serial.println(" us");
+}
@@ -0,0 +1,89 @@
+// Minimal Arduino core stand-in for the native (host) build. Only what the
+// shared UI, post store and feed parse code uses: String, Stream, Serial, the
+// timing calls and ps_malloc.
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <ctype.h>
+#include <strings.h>
+#include <string>
+#include <algorithm>
+#include <type_traits>
+
+using std::min;
+using std::max;
+
+class String {
+public:
+    String(const char *text = "") : value(text != NULL ? text : "") {}
+    String(const std::string &text) : value(text) {}
+    explicit String(long number) : value(std::to_string(number)) {}
+
+    const char *c_str() const { return value.c_str(); }
+    unsigned int length() const { return value.length(); }
+    char operator[](unsigned int index) const { return index < value.length() ? value[index] : '\0'; }
+
+    int indexOf(char c, unsigned int from = 0) const {
+        size_t pos = value.find(c, from);
+        return pos == std::string::npos ? -1 : (int)pos;
+    }
+    String substring(unsigned int from, unsigned int to) const { return String(value.substr(from, to - from)); }
+    void replace(char find, char with) { std::replace(value.begin(), value.end(), find, with); }
+
+    String &operator+=(const String &other) { value += other.value; return *this; }
+    String &operator+=(const char *other) { value += other; return *this; }
+    String &operator+=(char c) { value += c; return *this; }
+    friend String operator+(const String &a, const String &b) { return String(a.value + b.value); }
+    friend String operator+(const String &a, const char *b) { return String(a.value + b); }
+    friend String operator+(const char *a, const String &b) { return String(a + b.value); }
+
+    bool operator==(const String &other) const { return value == other.value; }
+    bool operator!=(const String &other) const { return value != other.value; }
+    bool operator<(const String &other) const { return value < other.value; }
+    bool operator>(const String &other) const { return value > other.value; }
+    bool operator<=(const String &other) const { return value <= other.value; }
+    bool operator>=(const String &other) const { return value >= other.value; }
+
+private:
+    std::string value;
+};
+
+// The part of Stream that JsonStreamReader reads through
+class Stream {
+public:
+    virtual ~Stream() {}
+    virtual int available() = 0;
+    virtual size_t readBytes(char *buffer, size_t length) = 0;
+};
+
+// Serial prints to stdout; the benchmark turns it off while timing
+class HostSerial {
+public:
+    bool enabled = true;
+
+    void print(const char *text) { if (enabled) fputs(text, stdout); }
+    void print(const String &text) { print(text.c_str()); }
+    template <typename T>
+    typename std::enable_if<std::is_arithmetic<T>::value>::type print(T number) {
+        if (enabled) printf("%lld", (long long)number);
+    }
+
+    void println() { print("\n"); }
+    template <typename T>
+    void println(const T &value) { print(value); println(); }
+};
+
+extern HostSerial Serial;
+
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+
+// No PSRAM on the host
+inline void *ps_malloc(size_t size) { return malloc(size); }
+
+#endif // HOST_ARDUINO_H
@@ -0,0 +1,20 @@
+#include "Arduino.h"
+#include <chrono>
+#include <thread>
+
+HostSerial Serial;
+
+static const auto hostStart = std::chrono::steady_clock::now();
+
+uint32_t micros() {
+    return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - hostStart).count();
+}
+
+uint32_t millis() {
+    return micros() / 1000;
+}
+
+void delay(uint32_t ms) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
@@ -0,0 +1,12 @@
+// avatars.h for the native build: no network or flash, so there are never any thumbnails
+#include "avatars.h"
+
+static AvatarStats stats;
+
+void startAvatarWorker() {}
+void requestAvatar(const char *url) {}
+void requestCachedAvatar(uint32_t key) {}
+const lv_img_dsc_t *avatarFor(uint32_t key, int holder) { return NULL; }
+uint32_t avatarGeneration() { return 0; }
+const AvatarStats &avatarStats() { return stats; }
+void printAvatarStats() {}
@@ -0,0 +1,659 @@
+// Native render benchmark: builds, lays out, renders and flushes each of the
+// badge screens with posts from a searchPosts payload (by default a hand-written
+// sample, not captured traffic), then writes a PNG snapshot of every screen.
+// Pre-rendered static screens are checked against LVGL's own render of the same
+// screen and timed as blits. A long post is scrolled with LVGL's label scroll and
+// with the hardware page slide, on simulated time.
+// Screen switches are timed the old way (rebuilt on every switch) and the current
+// way (kept alive, animated), with the LVGL pool's fragmentation over each.
+// Every character of the posts is looked up in the post fonts, timing the lookup
+// and listing the characters that would need the device's fallback font.
+// Then the rotation is soaked for [soak cycles] screen changes (0 to skip),
+// checking that the LVGL pool neither leaks nor fragments. Last, the payload and
+// the large pages in bench/payloads are replayed through the feed parser.
+//
+//   pio run -e native
+//   .pio/build/native/program [payload.json] [output dir] [iterations] [soak cycles]
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <time.h>
+#include <vector>
+#include <sys/stat.h>
+#include "display.h"
+#include "host_display.h"
+#include "png_writer.h"
+#include "feed_replay.h"
+#include "avatars.h"
+#include "post_store.h"
+#include "screens.h"
+#include "lvgl_pool.h"
+
+#define DEFAULT_PAYLOAD "bench/payloads/searchPosts_sample.json"
+#define PAYLOAD_DIR "bench/payloads"
+#define DEFAULT_OUTPUT_DIR "bench_out"
+#define DEFAULT_ITERATIONS 20
+#define BENCH_TICK_MS 1
+#define SCROLL_BASELINE_MS 3000  // LVGL label scroll run for the comparison
+#define DEFAULT_SOAK_CYCLES 100000
+#define SOAK_STEP_MS 50          // Coarser ticks than BENCH_TICK_MS: nothing is timed in the soak
+#define SOAK_RENDER_EVERY 100    // Cycles between drawn frames; the others only run timers
+#define SWITCH_ROTATIONS 20      // Rotations through all screens per switch path
+#define SWITCH_TICK_MS 10        // Frame period while a transition runs
+
+struct LayoutCheck {
+    int posts = 0;
+    int truncated = 0;
+    int paged = 0;
+    int failures = 0;
+    int perSize[64] = {};
+    uint64_t totalUs = 0;
+    uint32_t maxUs = 0;
+};
+
+static LayoutCheck layoutCheck;
+
+// Glyph lookups over the payload's post text at every post font size
+#define GLYPH_MISSING_SHOWN 12
+
+struct GlyphCheck {
+    uint64_t lookups = 0;
+    uint64_t totalNs = 0;
+    uint64_t missing = 0;  // Characters the post fonts don't have (fallback font on the device)
+    std::vector<uint32_t> missingCodepoints;
+};
+
+static GlyphCheck glyphCheck;
+
+// Posts the soak cycles through, one new set per rotation
+struct SoakPost {
+    std::string handle;
+    std::string text;
+};
+
+static std::vector<SoakPost> soakPosts;
+
+struct SoakResult {
+    uint32_t cycles = 0;
+    uint32_t samples = 0;       // Rotations back at the first sample's posts
+    uint32_t leaks = 0;         // Samples whose live blocks or bytes differ from the first
+    uint16_t earlySlabs = 0;    // Most slabs in use over the first quarter of the samples
+    uint16_t worstSlabs = 0;
+    uint32_t minLargestFree = UINT32_MAX;
+    uint8_t worstFragPct = 0;
+    LvglPoolStats first = {};
+    LvglPoolStats last = {};
+    uint64_t us = 0;
+};
+
+// One way of changing screens, over SWITCH_ROTATIONS rotations
+struct SwitchBench {
+    uint32_t switches = 0;
+    uint64_t firstFrameUs = 0;  // Switch call to the first frame on the panel
+    uint32_t maxFirstFrameUs = 0;
+    uint64_t totalUs = 0;       // Including the rest of the transition's frames
+    uint8_t worstFragPct = 0;
+    uint32_t minLargestFree = UINT32_MAX;
+    uint16_t worstSlabs = 0;
+    uint32_t allocs = 0;        // LVGL allocations the switches made
+    int32_t liveBlockDrift = 0; // Live blocks after the last switch minus before the first
+};
+
+struct ScreenTiming {
+    uint64_t buildUs = 0;
+    uint64_t layoutUs = 0;
+    uint64_t renderUs = 0;
+    uint64_t flushUs = 0;
+    uint32_t maxFrameUs = 0;
+    uint64_t busUs = 0;
+    bool prerendered = false;
+    bool frameMatches = false;
+    uint64_t blitUs = 0;
+};
+
+struct ScrollBench {
+    int screen = -1;
+    uint32_t lvglFrames = 0;       // Over SCROLL_BASELINE_MS
+    uint32_t lvglPixels = 0;
+    uint32_t slideSteps = 0;
+    uint32_t slidePixels = 0;
+    uint32_t slideMs = 0;          // Slide start to last step
+    uint32_t slideLvglFrames = 0;  // LVGL must not draw during the slide
+    int badSteps = 0;              // Panel not showing the old and new page side by side
+    bool endMatches = false;       // Panel after the slide is LVGL's render of the new page
+};
+
+// Lays out every post in the payload and re-measures the result with the UI font:
+// it must fit the text box and must not wrap again in the label
+static void checkPostLayouts(JsonArray posts) {
+    static char laidOut[POST_TEXT_MAX];
+    static char pageText[POST_TEXT_MAX];
+    for (JsonObject post : posts) {
+        const char *text = post["record"]["text"] | "";
+        PostLayout layout;
+        layoutPostText(laidOut, sizeof(laidOut), text, layout);
+
+        // Every page on its own has to fit the box
+        const lv_font_t *font = postLayoutFont(layout.fontSize);
+        int perPage = layout.pages > 1 ? postLayoutLinesPerPage(layout.fontSize) : layout.lines;
+        for (int page = 0; page < layout.pages; page++) {
+            postLayoutPage(pageText, sizeof(pageText), laidOut, layout, page);
+            int lines = min(perPage, layout.lines - page * perPage);
+            lv_point_t size;
+            lv_txt_get_size(&size, pageText, font, 0, POST_TEXT_LINE_SPACE, POST_TEXT_WIDTH, LV_TEXT_FLAG_NONE);
+            lv_coord_t expectedHeight = lines * (lv_font_get_line_height(font) + POST_TEXT_LINE_SPACE) - POST_TEXT_LINE_SPACE;
+            if (size.x > POST_TEXT_WIDTH || size.y > POST_TEXT_HEIGHT || (lines > 0 && size.y != expectedHeight)) {
+                printf("Layout overflow at %dpx (page %d/%d, %d lines, %dx%d): %.40s...\n",
+                       layout.fontSize, page + 1, layout.pages, lines, (int)size.x, (int)size.y, text);
+                layoutCheck.failures++;
+            }
+        }
+
+        layoutCheck.posts++;
+        if (layout.truncated) layoutCheck.truncated++;
+        if (layout.pages > 1) layoutCheck.paged++;
+        layoutCheck.perSize[layout.fontSize]++;
+        layoutCheck.totalUs += layout.layoutUs;
+        if (layout.layoutUs > layoutCheck.maxUs) layoutCheck.maxUs = layout.layoutUs;
+    }
+}
+
+static void checkGlyphLookups(JsonArray posts) {
+    for (uint8_t size = 16; size <= 28; size += 2) {
+        const lv_font_t *font = postLayoutFont(size);
+        for (JsonObject post : posts) {
+            const char *text = post["record"]["text"] | "";
+            uint32_t pos = 0;
+            while (text[pos] != '\0') {
+                uint32_t letter = _lv_txt_encoded_next(text, &pos);
+                if (letter == '\n' || letter == '\r') continue;
+                lv_font_glyph_dsc_t dsc;
+                struct timespec start, end;
+                clock_gettime(CLOCK_MONOTONIC, &start);
+                bool found = lv_font_get_glyph_dsc(font, &dsc, letter, 0);
+                clock_gettime(CLOCK_MONOTONIC, &end);
+                glyphCheck.totalNs += (end.tv_sec - start.tv_sec) * 1000000000ULL + end.tv_nsec - start.tv_nsec;
+                glyphCheck.lookups++;
+                if (found && !dsc.is_placeholder) continue;
+                glyphCheck.missing++;
+                std::vector<uint32_t> &seen = glyphCheck.missingCodepoints;
+                if (std::find(seen.begin(), seen.end(), letter) == seen.end()) seen.push_back(letter);
+            }
+        }
+    }
+}
+
+// The post screens' text label has to sit inside the panel's content area
+static bool checkPostLabelGeometry() {
+    for (int screen = 3; screen < 3 + DISPLAY_POST_COUNT; screen++) {
+        lv_obj_t *panel = lv_obj_get_child(screenObject(screen), 0);
+        lv_obj_t *text = lv_obj_get_child(panel, 2);  // After the avatar and the author label
+        lv_obj_update_layout(panel);
+        lv_area_t content;
+        lv_area_t label;
+        lv_obj_get_content_coords(panel, &content);
+        lv_obj_get_coords(text, &label);
+        if (!_lv_area_is_in(&label, &content, 0)) {
+            printf("Post text box (%d,%d)-(%d,%d) is outside the panel content (%d,%d)-(%d,%d)\n",
+                   label.x1, label.y1, label.x2, label.y2, content.x1, content.y1, content.x2, content.y2);
+            return false;
+        }
+    }
+    return true;
+}
+
+static void runTicks(uint32_t ms) {
+    for (uint32_t t = 0; t < ms; t += BENCH_TICK_MS) {
+        lv_tick_inc(BENCH_TICK_MS);
+        lv_timer_handler();
+    }
+}
+
+// Old page moved left by offset, the new page's first offset columns on the right
+// (mirrored with DISPLAY_SCROLL_INVERT)
+static bool slideFrameMatches(const uint16_t *shown, const uint16_t *oldPage, const uint16_t *newPage, int offset) {
+    for (int y = 0; y < SCREEN_HEIGHT; y++) {
+        const uint16_t *row = shown + y * SCREEN_WIDTH;
+        for (int x = 0; x < SCREEN_WIDTH; x++) {
+            uint16_t expected;
+            if (DISPLAY_SCROLL_INVERT) {
+                expected = x < offset ? newPage[y * SCREEN_WIDTH + x + SCREEN_WIDTH - offset]
+                                      : oldPage[y * SCREEN_WIDTH + x - offset];
+            } else {
+                expected = x < SCREEN_WIDTH - offset ? oldPage[y * SCREEN_WIDTH + x + offset]
+                                                     : newPage[y * SCREEN_WIDTH + x - (SCREEN_WIDTH - offset)];
+            }
+            if (row[x] != expected) return false;
+        }
+    }
+    return true;
+}
+
+// The first post screen with a paged post: LVGL's vertical label scroll over the
+// whole text as the baseline, then one hardware slide to its second page
+static ScrollBench benchPageScroll(lv_obj_t *scratch) {
+    ScrollBench result;
+    for (int screen = 3; screen < 3 + DISPLAY_POST_COUNT && result.screen < 0; screen++) {
+        if (screenPages(screen) > 1) result.screen = screen;
+    }
+    if (result.screen < 0) return result;
+    int post = result.screen - 3;
+
+    // Baseline: all pages in one label, scrolled by LVGL
+    lv_scr_load(scratch);
+    buildScreen(result.screen);
+    lv_obj_t *obj = screenObject(result.screen);
+    lv_scr_load(obj);
+    lv_obj_t *label = lv_obj_get_child(lv_obj_get_child(obj, 0), 2);
+    lv_label_set_text(label, postStoreFront().texts[post]);
+    lv_label_set_long_mode(label, LV_LABEL_LONG_SCROLL_CIRCULAR);
+    lv_refr_now(NULL);
+    resetDisplayStats();
+    resetHostFlushedPixels();
+    runTicks(SCROLL_BASELINE_MS);
+    result.lvglFrames = displayStats().frames;
+    result.lvglPixels = hostFlushedPixels();
+
+    // Hardware slide, driven by the screen's own page timer
+    lv_scr_load(scratch);
+    buildScreen(result.screen);
+    obj = screenObject(result.screen);
+    showScreen(result.screen);
+    runTicks(POST_PAGE_DWELL_MS - BENCH_TICK_MS);
+    std::vector<uint16_t> oldPage(SCREEN_WIDTH * SCREEN_HEIGHT);
+    std::vector<uint16_t> newPage(SCREEN_WIDTH * SCREEN_HEIGHT);
+    hostDisplayedFrame(oldPage.data());
+
+    std::vector<std::vector<uint16_t>> steps;
+    std::vector<int> offsets;
+    resetDisplayStats();
+    resetHostFlushedPixels();
+    uint32_t firstStepMs = 0;
+    uint32_t lastStepMs = 0;
+    uint32_t lastSteps = 0;
+    for (uint32_t ms = 0; ms < POST_PAGE_DWELL_MS && (lastSteps == 0 || hostScrollStart() != 0); ms += BENCH_TICK_MS) {
+        runTicks(BENCH_TICK_MS);
+        uint32_t stepCount = displayStats().scrollSteps;
+        if (stepCount == lastSteps) continue;
+        if (lastSteps == 0) firstStepMs = ms;
+        lastStepMs = ms;
+        lastSteps = stepCount;
+        int start = hostScrollStart();
+        if (start == 0) break;
+        steps.emplace_back(SCREEN_WIDTH * SCREEN_HEIGHT);
+        hostDisplayedFrame(steps.back().data());
+        offsets.push_back(DISPLAY_SCROLL_INVERT ? SCREEN_WIDTH - start : start);
+    }
+    result.slideSteps = displayStats().scrollSteps;
+    result.slidePixels = hostFlushedPixels();
+    result.slideLvglFrames = displayStats().frames;
+    result.slideMs = lastStepMs - firstStepMs + POST_PAGE_STEP_MS;  // The first step lands one period in
+    hostDisplayedFrame(newPage.data());
+
+    for (size_t i = 0; i < steps.size(); i++) {
+        if (!slideFrameMatches(steps[i].data(), oldPage.data(), newPage.data(), offsets[i])) result.badSteps++;
+    }
+    lv_obj_invalidate(obj);
+    lv_refr_now(NULL);
+    result.endMatches = hostScrollStart() == 0 && result.slideSteps > 0 &&
+                        memcmp(newPage.data(), hostFramebuffer(), newPage.size() * sizeof(uint16_t)) == 0;
+    return result;
+}
+
+// Screen changes the way showScreen() did before screens were kept alive (rebuild:
+// the screen is built from scratch, loaded with a cut and fully redrawn) and the
+// way it does now (the prebuilt screen is loaded with SCREEN_TRANSITION_ANIM, or
+// blitted if it's pre-rendered). Both run on the same allocator, lvgl_pool.h.
+static SwitchBench benchSwitches(bool rebuild, lv_obj_t *scratch) {
+    SwitchBench result;
+    lv_scr_load(scratch);
+    lv_refr_now(NULL);
+    lv_mem_buf_free_all();
+    LvglPoolStats before = lvglPoolStats();
+
+    // showScreen() animates from the active screen, which has to outlive the transition
+    lv_obj_t *start = NULL;
+    if (!rebuild) {
+        start = lv_obj_create(NULL);
+        lv_scr_load(start);
+    }
+
+    for (uint32_t i = 0; i < SWITCH_ROTATIONS * SCREEN_COUNT; i++) {
+        int screen = i % SCREEN_COUNT;
+        uint32_t began = micros();
+        if (rebuild) {
+            buildScreen(screen);
+            lv_scr_load(screenObject(screen));
+        } else {
+            showScreen(screen);
+        }
+        lv_refr_now(NULL);
+        uint32_t firstFrameUs = micros() - began;
+        for (uint32_t ms = 0; !rebuild && ms < TRANSITION_DURATION; ms += SWITCH_TICK_MS) {
+            lv_tick_inc(SWITCH_TICK_MS);
+            lv_timer_handler();
+        }
+        result.totalUs += micros() - began;
+        result.firstFrameUs += firstFrameUs;
+        if (firstFrameUs > result.maxFirstFrameUs) result.maxFirstFrameUs = firstFrameUs;
+        result.switches++;
+
+        lv_mem_buf_free_all();
+        const LvglPoolStats &pool = lvglPoolStats();
+        if (lvglPoolFragPct(pool) > result.worstFragPct) result.worstFragPct = lvglPoolFragPct(pool);
+        if (pool.largestFree < result.minLargestFree) result.minLargestFree = pool.largestFree;
+        if (pool.slabsUsed > result.worstSlabs) result.worstSlabs = pool.slabsUsed;
+    }
+    if (start != NULL && lv_obj_is_valid(start)) lv_obj_del(start);  // Unless the first showScreen() replaced it
+    lv_mem_buf_free_all();
+    const LvglPoolStats &after = lvglPoolStats();
+    result.allocs = after.allocs - before.allocs;
+    result.liveBlockDrift = (int32_t)(after.liveBlocks - before.liveBlocks);
+    return result;
+}
+
+static void printSwitchBench(const char *name, const SwitchBench &b) {
+    uint32_t switches = b.switches > 0 ? b.switches : 1;
+    printf("%-22s %10llu %9u %10llu %9u %6u%% %12u %6u %+11d\n", name,
+           (unsigned long long)(b.firstFrameUs / switches), b.maxFirstFrameUs,
+           (unsigned long long)(b.totalUs / switches), b.allocs / switches, b.worstFragPct, b.minLargestFree,
+           b.worstSlabs, b.liveBlockDrift);
+}
+
+static void runSoakTicks() {
+    for (uint32_t ms = 0; ms < TRANSITION_DURATION + SOAK_STEP_MS; ms += SOAK_STEP_MS) {
+        lv_tick_inc(SOAK_STEP_MS);
+        lv_timer_handler();
+    }
+}
+
+// Rotates through the screens for cycles screen changes. Each screen's widget tree
+// is rebuilt before it's shown, as the rotation did before screens were kept
+// alive, and every rotation brings a new post set. Whenever the posts come round
+// to the first sampled set again, the pool has to hold exactly what it held then.
+static SoakResult soakRotation(uint32_t cycles) {
+    SoakResult result;
+    if (cycles == 0 || soakPosts.empty()) return result;
+
+    // Only timers and animations run; a frame is drawn every SOAK_RENDER_EVERY cycles
+    lv_timer_t *refresh = lv_disp_get_default()->refr_timer;
+    lv_timer_pause(refresh);
+
+    // Start from the last screen, with nothing left active from the benchmark
+    lv_obj_t *start = lv_obj_create(NULL);
+    lv_scr_load(start);
+    showScreen(SCREEN_COUNT - 1);
+    runSoakTicks();
+    if (lv_obj_is_valid(start)) lv_obj_del(start);
+
+    std::vector<LvglPoolStats> samples;
+    uint32_t postSets = soakPosts.size();
+    int64_t createdAtMs = 1735689600000LL;
+    uint32_t began = micros();
+    for (uint32_t cycle = 0; cycle < cycles; cycle++) {
+        int screen = cycle % SCREEN_COUNT;
+        uint32_t rotation = cycle / SCREEN_COUNT;
+        if (screen == 0) {
+            // Sample before the new posts, so the pool holds the previous rotation's set.
+            // LVGL's cached draw buffers are dropped first: they grow to the largest
+            // area drawn so far and are reallocated on the next frame.
+            if (rotation > postSets && (rotation - 1) % postSets == 0) {
+                lv_mem_buf_free_all();
+                samples.push_back(lvglPoolStats());
+            }
+            for (int i = 0; i < DISPLAY_POST_COUNT; i++) {
+                const SoakPost &post = soakPosts[(rotation * DISPLAY_POST_COUNT + i) % postSets];
+                postStoreOffer(post.handle.c_str(), post.text.c_str(), ++createdAtMs, 0);
+            }
+            postStorePublishTop();
+            if (postStoreAcquire()) updatePostScreens(postStoreFront());
+        }
+        buildScreen(screen);
+        showScreen(screen);
+        runSoakTicks();
+        if (cycle % SOAK_RENDER_EVERY == 0) lv_refr_now(NULL);
+    }
+    result.us = micros() - began;
+    result.cycles = cycles;
+    lv_timer_resume(refresh);
+
+    result.samples = samples.size();
+    if (samples.empty()) return result;
+    result.first = samples.front();
+    result.last = samples.back();
+    for (size_t i = 0; i < samples.size(); i++) {
+        const LvglPoolStats &sample = samples[i];
+        if (sample.liveBlocks != result.first.liveBlocks || sample.smallBytes != result.first.smallBytes ||
+            sample.largeBytes != result.first.largeBytes) {
+            result.leaks++;
+        }
+        if (i < (samples.size() + 3) / 4 && sample.slabsUsed > result.earlySlabs) result.earlySlabs = sample.slabsUsed;
+        if (sample.slabsUsed > result.worstSlabs) result.worstSlabs = sample.slabsUsed;
+        if (sample.largestFree < result.minLargestFree) result.minLargestFree = sample.largestFree;
+        if (lvglPoolFragPct(sample) > result.worstFragPct) result.worstFragPct = lvglPoolFragPct(sample);
+    }
+    return result;
+}
+
+// Same selection as the device: skip @seagl.org, newest DISPLAY_POST_COUNT first
+static bool loadPosts(const char *path) {
+    std::ifstream file(path);
+    if (!file) {
+        printf("Can't open %s\n", path);
+        return false;
+    }
+
+    StaticJsonDocument<256> filter;
+    JsonObject postFilter = filter["posts"].createNestedObject();
+    postFilter["author"]["handle"] = true;
+    postFilter["author"]["avatar"] = true;
+    postFilter["record"]["text"] = true;
+    postFilter["record"]["createdAt"] = true;
+
+    DynamicJsonDocument doc(64 * 1024);
+    DeserializationError error = deserializeJson(doc, file, DeserializationOption::Filter(filter));
+    if (error) {
+        printf("JSON parse error in %s: %s\n", path, error.c_str());
+        return false;
+    }
+
+    checkPostLayouts(doc["posts"].as<JsonArray>());
+    checkGlyphLookups(doc["posts"].as<JsonArray>());
+
+    for (JsonObject post : doc["posts"].as<JsonArray>()) {
+        const char *handle = post["author"]["handle"] | "";
+        const char *text = post["record"]["text"] | "";
+        int64_t createdAtMs = parseIsoTimestamp(post["record"]["createdAt"] | "");
+        if (strcmp(handle, "seagl.org") == 0 || handle[0] == '\0' || text[0] == '\0' || createdAtMs == 0) continue;
+        soakPosts.push_back({handle, text});
+        postStoreOffer(handle, text, createdAtMs, avatarKey(post["author"]["avatar"] | ""));
+    }
+    postStorePublishTop();
+    postStoreAcquire();
+    return true;
+}
+
+int main(int argc, char **argv) {
+    const char *payload = argc > 1 ? argv[1] : DEFAULT_PAYLOAD;
+    const char *outputDir = argc > 2 ? argv[2] : DEFAULT_OUTPUT_DIR;
+    int iterations = argc > 3 ? atoi(argv[3]) : DEFAULT_ITERATIONS;
+    if (iterations < 1) iterations = 1;
+    uint32_t soakCycles = argc > 4 ? strtoul(argv[4], NULL, 10) : DEFAULT_SOAK_CYCLES;
+
+    initDisplay();
+    if (!postStoreInit() || !loadPosts(payload)) return 1;
+
+    Serial.enabled = false;
+    uint32_t start = micros();
+    buildScreens();
+    uint32_t buildAllUs = micros() - start;
+    bool geometryOk = checkPostLabelGeometry();
+
+    // Screens are rebuilt while this blank one is active
+    lv_obj_t *scratch = lv_obj_create(NULL);
+    mkdir(outputDir, 0755);
+
+    ScreenTiming timings[SCREEN_COUNT];
+    for (int screen = 0; screen < SCREEN_COUNT; screen++) {
+        ScreenTiming &t = timings[screen];
+        for (int i = 0; i < iterations; i++) {
+            lv_scr_load(scratch);
+            start = micros();
+            buildScreen(screen);
+            t.buildUs += micros() - start;
+
+            // Load directly; showScreen() would animate over TRANSITION_DURATION
+            lv_obj_t *obj = screenObject(screen);
+            lv_scr_load(obj);
+
+            lv_obj_mark_layout_as_dirty(obj);
+            start = micros();
+            lv_obj_update_layout(obj);
+            t.layoutUs += micros() - start;
+
+            // Full-screen redraw, as on every rotation before screens were persistent
+            lv_obj_invalidate(obj);
+            resetDisplayStats();
+            resetHostFlushedPixels();
+            start = micros();
+            lv_refr_now(NULL);
+            uint32_t frameUs = micros() - start;
+            uint32_t flushUs = displayStats().totalFlushUs;
+            t.renderUs += frameUs - flushUs;
+            t.flushUs += flushUs;
+            t.busUs += modeledBusUs(hostFlushedPixels());
+            if (frameUs > t.maxFrameUs) t.maxFrameUs = frameUs;
+        }
+
+        // A pre-rendered frame must be exactly what LVGL draws for that screen
+        const lv_color_t *frame = staticScreenFrame(screen);
+        if (frame != NULL) {
+            t.prerendered = true;
+            t.frameMatches = memcmp(frame, hostFramebuffer(), SCREEN_WIDTH * SCREEN_HEIGHT * sizeof(lv_color_t)) == 0;
+            start = micros();
+            for (int i = 0; i < iterations; i++) {
+                blitFrame(frame);
+            }
+            t.blitUs = micros() - start;
+        }
+
+        char path[256];
+        snprintf(path, sizeof(path), "%s/screen_%d.png", outputDir, screen);
+        writePngRGB565(path, hostFramebuffer(), SCREEN_WIDTH, SCREEN_HEIGHT);
+    }
+    ScrollBench scroll = benchPageScroll(scratch);
+    SwitchBench rebuildSwitches = benchSwitches(true, scratch);
+    SwitchBench keptSwitches = benchSwitches(false, scratch);
+
+    lv_mem_monitor_t mon;
+    lvglPoolMonitor(&mon);
+    SoakResult soak = soakRotation(soakCycles);
+    Serial.enabled = true;
+
+    printf("Payload: %s%s, %d iterations per screen\n", payload,
+           strcmp(payload, DEFAULT_PAYLOAD) == 0 ? " (hand-written sample)" : "", iterations);
+    printf("Initial build of all screens: %u us\n\n", buildAllUs);
+    printf("screen   build_us  layout_us  render_us  flush_us  frame_max_us  i80_model_us\n");
+    for (int screen = 0; screen < SCREEN_COUNT; screen++) {
+        ScreenTiming &t = timings[screen];
+        printf("%6d %10llu %10llu %10llu %9llu %13u %13llu\n", screen,
+               (unsigned long long)(t.buildUs / iterations),
+               (unsigned long long)(t.layoutUs / iterations),
+               (unsigned long long)(t.renderUs / iterations),
+               (unsigned long long)(t.flushUs / iterations),
+               t.maxFrameUs,
+               (unsigned long long)(t.busUs / iterations));
+    }
+
+    bool framesOk = true;
+    printf("\nstatic   lvgl_frame_us  blit_us  snapshot_us  i80_model_us  matches\n");
+    for (int screen = 0; screen < SCREEN_COUNT; screen++) {
+        ScreenTiming &t = timings[screen];
+        if (!t.prerendered) continue;
+        framesOk = framesOk && t.frameMatches;
+        printf("%6d %14llu %8llu %12u %13u %8s\n", screen,
+               (unsigned long long)((t.renderUs + t.flushUs) / iterations),
+               (unsigned long long)(t.blitUs / iterations),
+               staticScreenRenderUs(screen),
+               modeledBusUs(SCREEN_WIDTH * SCREEN_HEIGHT),
+               t.frameMatches ? "yes" : "NO");
+    }
+    bool scrollOk = true;
+    if (scroll.screen >= 0) {
+        scrollOk = scroll.badSteps == 0 && scroll.endMatches && scroll.slideLvglFrames == 0;
+        uint32_t slideMs = scroll.slideMs > 0 ? scroll.slideMs : 1;
+        uint64_t lvglBytes = (uint64_t)scroll.lvglPixels * sizeof(lv_color_t);
+        uint64_t slideBytes = (uint64_t)scroll.slidePixels * sizeof(lv_color_t);
+        printf("\nlong post (screen %d)   frames/s  bus_bytes/s  bytes/frame  i80_busy\n", scroll.screen);
+        printf("LVGL label scroll   %10.1f %12llu %12llu %8.1f%%\n",
+               scroll.lvglFrames * 1000.0 / SCROLL_BASELINE_MS,
+               (unsigned long long)(lvglBytes * 1000 / SCROLL_BASELINE_MS),
+               (unsigned long long)(scroll.lvglFrames > 0 ? lvglBytes / scroll.lvglFrames : 0),
+               modeledBusUs(scroll.lvglPixels) / (SCROLL_BASELINE_MS * 10.0));
+        printf("hardware page slide %10.1f %12llu %12llu %8.1f%%\n",
+               scroll.slideSteps * 1000.0 / slideMs,
+               (unsigned long long)(slideBytes * 1000 / slideMs),
+               (unsigned long long)(scroll.slideSteps > 0 ? slideBytes / scroll.slideSteps : 0),
+               modeledBusUs(scroll.slidePixels) / (slideMs * 10.0));
+        printf("Slide: %u steps in %u ms, %d steps off, LVGL frames during it %u, final frame %s\n",
+               scroll.slideSteps, scroll.slideMs, scroll.badSteps, scroll.slideLvglFrames,
+               scroll.endMatches ? "matches" : "DIFFERS");
+    } else {
+        printf("\nNo paged post in the payload, page slide not benchmarked\n");
+    }
+
+    printf("\nscreen switches        first_frame_us    max_us  switch_us allocs/sw  frag  largest_free  slabs  live_drift\n");
+    printSwitchBench("rebuilt (before)", rebuildSwitches);
+    printSwitchBench("kept alive (now)", keptSwitches);
+    printf("%u switches each; switch_us includes the %u ms transition's frames\n", keptSwitches.switches,
+           (unsigned)TRANSITION_DURATION);
+
+    printf("\nLVGL heap: %u used, %u largest free, %u%% fragmented\n",
+           (unsigned)(mon.total_size - mon.free_size), (unsigned)mon.free_biggest_size, (unsigned)mon.frag_pct);
+    printf("Snapshots written to %s/\n", outputDir);
+
+    printf("\nPost layout: %d posts, avg %llu us, max %u us, %d paged, %d truncated, %d overflowing\n",
+           layoutCheck.posts, (unsigned long long)(layoutCheck.posts > 0 ? layoutCheck.totalUs / layoutCheck.posts : 0),
+           layoutCheck.maxUs, layoutCheck.paged, layoutCheck.truncated, layoutCheck.failures);
+    printf("Font sizes:");
+    for (int size = 63; size > 0; size--) {
+        if (layoutCheck.perSize[size] > 0) printf(" %dpx x%d", size, layoutCheck.perSize[size]);
+    }
+    printf("\n");
+
+#ifdef BADGE_FONTS_SUBSET
+    printf("\nFonts: generated subsets (tools/subset_fonts.py)\n");
+#else
+    printf("\nFonts: built-in Montserrat (subsets not generated)\n");
+#endif
+    printf("Glyph lookup: %llu lookups at 16-28 px, avg %llu ns; %llu (%u distinct) not in the post fonts:",
+           (unsigned long long)glyphCheck.lookups,
+           (unsigned long long)(glyphCheck.lookups > 0 ? glyphCheck.totalNs / glyphCheck.lookups : 0),
+           (unsigned long long)glyphCheck.missing, (unsigned)glyphCheck.missingCodepoints.size());
+    for (size_t i = 0; i < glyphCheck.missingCodepoints.size() && i < GLYPH_MISSING_SHOWN; i++) {
+        printf(" U+%04X", glyphCheck.missingCodepoints[i]);
+    }
+    printf(glyphCheck.missingCodepoints.size() > GLYPH_MISSING_SHOWN ? " ...\n" : "\n");
+
+    bool soakOk = true;
+    if (soak.cycles > 0) {
+        soakOk = soak.samples > 0 && soak.leaks == 0 && soak.last.slabsUsed <= soak.earlySlabs &&
+                 soak.last.failures == 0;
+        printf("\nSoak: %u screen changes in %llu ms, %u samples at the same posts\n", soak.cycles,
+               (unsigned long long)(soak.us / 1000), soak.samples);
+        printf("LVGL pool: %u blocks / %u arena bytes / %u PSRAM bytes live, %u samples differ\n",
+               soak.first.liveBlocks, soak.first.smallBytes, soak.first.largeBytes, soak.leaks);
+        printf("Slabs in use: first %u, most in the first quarter %u, worst %u, last %u (of %u)\n",
+               soak.first.slabsUsed, soak.earlySlabs, soak.worstSlabs, soak.last.slabsUsed,
+               (unsigned)LVGL_POOL_SLAB_COUNT);
+        printf("Largest free: first %u, lowest %u, last %u; worst fragmentation %u%%\n",
+               soak.first.largestFree, soak.minLargestFree, soak.last.largestFree, soak.worstFragPct);
+        printf("%u allocs, %u frees, %u reallocs, %u spilled to PSRAM, %u failed\n", soak.last.allocs,
+               soak.last.frees, soak.last.reallocs, soak.last.spills, soak.last.failures);
+    }
+
+    bool replayOk = replayFeedPayloads(PAYLOAD_DIR, payload);
+    return layoutCheck.failures == 0 && geometryOk && framesOk && scrollOk && soakOk && replayOk ? 0 : 1;
+}
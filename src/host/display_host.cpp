@@ -0,0 +1,131 @@
+// display.h for the native build: LVGL flushes into an in-memory RGB565 framebuffer
+// instead of the ST7789, with the same stats the device reports.
+#include "display.h"
+#include "host_display.h"
+
+#define FULL_FRAME_PIXELS (SCREEN_WIDTH * SCREEN_HEIGHT)
+
+static lv_disp_draw_buf_t disp_buf;
+static lv_disp_drv_t disp_drv;
+static lv_color_t drawBuffer[FULL_FRAME_PIXELS];
+static uint16_t framebuffer[FULL_FRAME_PIXELS];  // Panel memory
+static int scrollStart = 0;                      // Panel memory column shown at screen column 0
+static uint32_t frameFlushUs = 0;
+static uint32_t flushedPixels = 0;
+static DisplayStats stats;
+
+static void hostFlush(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *color_map) {
+    uint32_t start = micros();
+    int width = area->x2 - area->x1 + 1;
+    for (int y = area->y1; y <= area->y2; y++) {
+        memcpy(&framebuffer[y * SCREEN_WIDTH + area->x1], color_map, width * sizeof(uint16_t));
+        color_map += width;
+    }
+    frameFlushUs += micros() - start;
+    flushedPixels += width * (area->y2 - area->y1 + 1);
+    lv_disp_flush_ready(drv);
+}
+
+static void hostMonitor(lv_disp_drv_t *drv, uint32_t time, uint32_t px) {
+    stats.frames++;
+    stats.totalFlushUs += frameFlushUs;
+    if (frameFlushUs > stats.maxFlushUs) stats.maxFlushUs = frameFlushUs;
+    stats.totalRenderMs += time;
+    stats.totalPixels += px;
+    frameFlushUs = 0;
+}
+
+void initDisplay() {
+    lv_init();
+
+    // One full-frame buffer so every screen renders in a single pass
+    lv_disp_draw_buf_init(&disp_buf, drawBuffer, NULL, FULL_FRAME_PIXELS);
+
+    lv_disp_drv_init(&disp_drv);
+    disp_drv.hor_res = SCREEN_WIDTH;
+    disp_drv.ver_res = SCREEN_HEIGHT;
+    disp_drv.flush_cb = hostFlush;
+    disp_drv.monitor_cb = hostMonitor;
+    disp_drv.draw_buf = &disp_buf;
+    lv_disp_drv_register(&disp_drv);
+}
+
+const char *displayPipelineName() {
+    return "host framebuffer";
+}
+
+DisplayStats displayStats() {
+    return stats;
+}
+
+void resetDisplayStats() {
+    memset(&stats, 0, sizeof(stats));
+}
+
+void printDisplayStats() {
+    if (stats.frames == 0) return;
+
+    Serial.print("Display: ");
+    Serial.print(stats.frames);
+    Serial.print(" frames, flush avg ");
+    Serial.print(stats.totalFlushUs / stats.frames);
+    Serial.println(" us");
+}
+
+lv_color_t *allocFrame() {
+    return (lv_color_t *)malloc(FULL_FRAME_PIXELS * sizeof(lv_color_t));
+}
+
+void blitFrame(const lv_color_t *frame) {
+    uint32_t start = micros();
+    memcpy(framebuffer, frame, sizeof(framebuffer));
+    flushedPixels += FULL_FRAME_PIXELS;
+    stats.blits++;
+    stats.totalBlitCpuUs += micros() - start;
+}
+
+// Same addressing as the ST7789 in landscape: memory column m shows at screen
+// column m - scrollStart
+void scrollFrameIn(const lv_color_t *frame, int fromX, int toX) {
+    uint32_t start = micros();
+    for (int x = fromX; x < toX; x++) {
+        int column = DISPLAY_SCROLL_INVERT ? SCREEN_WIDTH - 1 - x : x;
+        for (int y = 0; y < SCREEN_HEIGHT; y++) {
+            framebuffer[y * SCREEN_WIDTH + column] = frame[y * SCREEN_WIDTH + column].full;
+        }
+    }
+    scrollStart = (DISPLAY_SCROLL_INVERT ? SCREEN_WIDTH - toX : toX) % SCREEN_WIDTH;
+    flushedPixels += (toX - fromX) * SCREEN_HEIGHT;
+    stats.scrollSteps++;
+    stats.scrollBytes += (toX - fromX) * SCREEN_HEIGHT * sizeof(lv_color_t);
+    stats.totalScrollUs += micros() - start;
+}
+
+void hostDisplayedFrame(uint16_t *dest) {
+    for (int y = 0; y < SCREEN_HEIGHT; y++) {
+        for (int x = 0; x < SCREEN_WIDTH; x++) {
+            dest[y * SCREEN_WIDTH + x] = framebuffer[y * SCREEN_WIDTH + (x + scrollStart) % SCREEN_WIDTH];
+        }
+    }
+}
+
+int hostScrollStart() {
+    return scrollStart;
+}
+
+const uint16_t *hostFramebuffer() {
+    return framebuffer;
+}
+
+uint32_t hostFlushedPixels() {
+    return flushedPixels;
+}
+
+void resetHostFlushedPixels() {
+    flushedPixels = 0;
+}
+
+uint32_t modeledBusUs(uint32_t pixels) {
+    // 8-bit bus: one byte per WR clock, two bytes per RGB565 pixel
+    return (uint32_t)((uint64_t)pixels * 2 * 1000000 / DISPLAY_PCLK_HZ);
+}
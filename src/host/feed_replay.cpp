@@ -0,0 +1,207 @@
+#include "feed_replay.h"
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <malloc.h>
+#include "feed_parse.h"
+
+#define NEXT_RESPONSE "HTTP/1.1 200 OK\r\n"  // What follows the body on a kept-alive connection
+#define SEGMENT_MAX 1460                     // Bytes the stream has available at once, like a TCP segment
+#define CHUNK_MAX 700                        // Same uneven chunks as the mock's chunked scenario
+
+enum Transfer {
+    TRANSFER_LENGTH,   // Content-Length
+    TRANSFER_CHUNKED,
+    TRANSFER_CLOSE,    // Neither; the body ends when the server closes
+};
+
+static const char *const transferNames[] = {"length", "chunked", "close"};
+
+struct ReplayPayload {
+    const char *file;
+    FeedSourceType type;
+};
+
+static const ReplayPayload largePayloads[] = {
+    {"searchPosts_large.json", FEED_BLUESKY_TAG},
+    {"getAuthorFeed_large.json", FEED_BLUESKY_AUTHOR},
+    {"tagTimeline_large.json", FEED_MASTODON_TAG},
+};
+
+// Deterministic sizes, so a failing run can be repeated
+static uint32_t nextRandom(uint32_t &state) {
+    state = state * 1664525u + 1013904223u;
+    return state >> 8;
+}
+
+// A socket's worth of bytes, handed out a segment at a time
+class ReplayStream : public Stream {
+public:
+    explicit ReplayStream(const std::string &data) : data(data) {}
+
+    int available() override {
+        size_t left = data.size() - pos;
+        return (int)min(left, (size_t)(1 + nextRandom(seed) % SEGMENT_MAX));
+    }
+
+    size_t readBytes(char *buffer, size_t length) override {
+        size_t n = min(length, data.size() - pos);
+        memcpy(buffer, data.data() + pos, n);
+        pos += n;
+        return n;
+    }
+
+    std::string rest() const { return data.substr(pos); }
+
+private:
+    std::string data;
+    size_t pos = 0;
+    uint32_t seed = 1;
+};
+
+static std::string chunkedBody(const std::string &body) {
+    std::string out;
+    uint32_t seed = 7;
+    for (size_t offset = 0; offset < body.size();) {
+        size_t size = min((size_t)(1 + nextRandom(seed) % CHUNK_MAX), body.size() - offset);
+        char header[16];
+        snprintf(header, sizeof(header), "%zx\r\n", size);
+        out += header;
+        out += body.substr(offset, size);
+        out += "\r\n";
+        offset += size;
+    }
+    return out + "0\r\n\r\n";
+}
+
+// Bytes in use on the heap, where the C library can say
+static size_t heapInUse() {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+    return mallinfo2().uordblks;
+#else
+    return 0;
+#endif
+}
+
+// Posts in the payload's array, from a full parse
+static int countPosts(const std::string &body, FeedSourceType type) {
+    DynamicJsonDocument doc(body.size() * 8);
+    if (deserializeJson(doc, body)) return -1;
+    JsonArray posts = doc.as<JsonArray>();
+    if (type == FEED_BLUESKY_TAG) posts = doc["posts"].as<JsonArray>();
+    if (type == FEED_BLUESKY_AUTHOR) posts = doc["feed"].as<JsonArray>();
+    return posts.isNull() ? -1 : (int)posts.size();
+}
+
+// The same payload as a server that indents its JSON sends it
+static std::string prettyPrinted(const std::string &body) {
+    DynamicJsonDocument doc(body.size() * 8);
+    std::string out;
+    if (!deserializeJson(doc, body)) serializeJsonPretty(doc, out);
+    return out;
+}
+
+struct ReplayResult {
+    int parsed = 0;
+    int posts = 0;
+    int filtered = 0;
+    int skipped = 0;
+    size_t bytes = 0;
+    size_t poolPeak = 0;
+    long heapGrowth = 0;  // Over the parse, beyond the pool allocated before it
+    bool error = false;
+    bool endOk = true;    // Stopped exactly at the end of the body
+};
+
+static ReplayResult replay(const std::string &body, FeedSourceType type, Transfer transfer) {
+    static const FeedSource sources[] = {
+        {FEED_BLUESKY_TAG, "seagl2025", NULL},
+        {FEED_BLUESKY_AUTHOR, "attendee0.bsky.social", NULL},
+        {FEED_MASTODON_TAG, "seagl2025", "https://mastodon.example"},
+    };
+    ReplayResult result;
+    std::string wire = transfer == TRANSFER_CHUNKED ? chunkedBody(body) : body;
+    if (transfer != TRANSFER_CLOSE) wire += NEXT_RESPONSE;
+    ReplayStream stream(wire);
+    JsonStreamReader reader(stream, transfer == TRANSFER_CHUNKED, transfer == TRANSFER_LENGTH ? (int)body.size() : -1);
+
+    DynamicJsonDocument doc(BLUESKY_JSON_CAPACITY);
+    FeedItem *item = new FeedItem;
+    size_t heapBefore = heapInUse();
+    size_t heapPeak = heapBefore;
+    {
+        FeedParser parser(sources[type], reader, doc);
+        while (parser.next(*item)) {
+            switch (parser.result()) {
+                case FEED_ITEM_POST: result.posts++; break;
+                case FEED_ITEM_FILTERED: result.filtered++; break;
+                case FEED_ITEM_SKIPPED: result.skipped++; break;
+            }
+            heapPeak = max(heapPeak, heapInUse());
+        }
+        heapPeak = max(heapPeak, heapInUse());
+        result.parsed = parser.parsed();
+        result.poolPeak = parser.poolPeak();
+        result.error = parser.error();
+    }
+    result.heapGrowth = (long)(heapPeak - heapBefore);
+    delete item;
+
+    // What the XRPC client does before reusing the connection
+    if (transfer != TRANSFER_CLOSE) {
+        reader.drain(body.size());
+        result.endOk = reader.finished() && stream.rest() == NEXT_RESPONSE;
+    }
+    result.bytes = reader.bytesRead();
+    return result;
+}
+
+static bool loadFile(const std::string &path, std::string &out) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return false;
+    std::stringstream contents;
+    contents << file.rdbuf();
+    out = contents.str();
+    return true;
+}
+
+// One payload, compact and pretty-printed, in every transfer; true if all of
+// them parsed every post within the bounds
+static bool replayPayload(const std::string &path, FeedSourceType type) {
+    std::string compact;
+    if (!loadFile(path, compact)) {
+        printf("Can't open %s\n", path.c_str());
+        return false;
+    }
+    int expected = countPosts(compact, type);
+    std::string name = path.substr(path.find_last_of('/') + 1);
+    const std::string bodies[] = {compact, prettyPrinted(compact)};
+
+    bool ok = expected > 0;
+    for (int pretty = 0; pretty < 2; pretty++) {
+        for (int transfer = TRANSFER_LENGTH; transfer <= TRANSFER_CLOSE; transfer++) {
+            ReplayResult r = replay(bodies[pretty], type, (Transfer)transfer);
+            bool pass = !r.error && r.parsed == expected && r.endOk && r.poolPeak <= BLUESKY_JSON_CAPACITY &&
+                        r.heapGrowth <= 0;
+            ok = ok && pass;
+            printf("%-26s %-7s %-8s %6d/%-4d %5d %8d %7d %7zu %9zu %11ld %5s\n", name.c_str(),
+                   pretty ? "pretty" : "compact", transferNames[transfer], r.parsed, expected, r.posts, r.filtered,
+                   r.skipped, r.bytes, r.poolPeak, r.heapGrowth, pass ? "ok" : "FAIL");
+            if (r.error) printf("  parse error after %d posts\n", r.parsed);
+            if (!r.endOk) printf("  reader didn't stop at the end of the body\n");
+        }
+    }
+    return ok;
+}
+
+bool replayFeedPayloads(const char *dir, const char *searchPayload) {
+    printf("\nFeed parse replay, JSON pool %u bytes per source, no other heap allowed\n", (unsigned)BLUESKY_JSON_CAPACITY);
+    printf("payload                    format  transfer   parsed posts filtered skipped   bytes pool_peak heap_growth\n");
+    bool ok = replayPayload(searchPayload, FEED_BLUESKY_TAG);
+    for (const ReplayPayload &payload : largePayloads) {
+        ok = replayPayload(std::string(dir) + "/" + payload.file, payload.type) && ok;
+    }
+    return ok;
+}
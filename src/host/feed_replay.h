@@ -0,0 +1,11 @@
+// Replays feed payloads through the device's parser (feed_parse.cpp and
+// JsonStreamReader) and checks that a parse stays inside its JSON pool
+#ifndef FEED_REPLAY_H
+#define FEED_REPLAY_H
+
+// The large pages in dir (tools/mock_xrpc.py --write-payloads) plus the
+// searchPosts payload, each compact and pretty-printed, and each of those sent
+// with a Content-Length, chunked and until the connection closes. Prints a table; false if any replay failed.
+bool replayFeedPayloads(const char *dir, const char *searchPayload);
+
+#endif // FEED_REPLAY_H
@@ -0,0 +1,16 @@
+// Host-only view of the in-memory panel the native build renders into
+#ifndef HOST_DISPLAY_H
+#define HOST_DISPLAY_H
+
+#include <stdint.h>
+
+const uint16_t *hostFramebuffer();  // Panel memory, SCREEN_WIDTH x SCREEN_HEIGHT RGB565
+void hostDisplayedFrame(uint16_t *dest);  // What the panel shows: memory through the scroll start
+int hostScrollStart();
+uint32_t hostFlushedPixels();       // Pixels flushed since the last reset
+void resetHostFlushedPixels();
+
+// Time the real 8-bit I80 bus would need for `pixels` at DISPLAY_PCLK_HZ
+uint32_t modeledBusUs(uint32_t pixels);
+
+#endif // HOST_DISPLAY_H
@@ -0,0 +1,98 @@
+#include "png_writer.h"
+#include <stdio.h>
+#include <vector>
+#include <algorithm>
+
+static uint32_t crcTable[256];
+
+static void initCrcTable() {
+    for (uint32_t n = 0; n < 256; n++) {
+        uint32_t c = n;
+        for (int k = 0; k < 8; k++) {
+            c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        }
+        crcTable[n] = c;
+    }
+}
+
+static uint32_t crc32(uint32_t crc, const uint8_t *data, size_t length) {
+    crc = ~crc;
+    for (size_t i = 0; i < length; i++) {
+        crc = crcTable[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+static void putBE32(std::vector<uint8_t> &out, uint32_t value) {
+    out.push_back(value >> 24);
+    out.push_back(value >> 16);
+    out.push_back(value >> 8);
+    out.push_back(value);
+}
+
+static void writeChunk(FILE *file, const char *type, const std::vector<uint8_t> &data) {
+    std::vector<uint8_t> chunk;
+    putBE32(chunk, data.size());
+    chunk.insert(chunk.end(), type, type + 4);
+    chunk.insert(chunk.end(), data.begin(), data.end());
+    putBE32(chunk, crc32(0, chunk.data() + 4, chunk.size() - 4));
+    fwrite(chunk.data(), 1, chunk.size(), file);
+}
+
+bool writePngRGB565(const char *path, const uint16_t *pixels, int width, int height) {
+    initCrcTable();
+
+    // Raw scanlines: filter byte 0 followed by RGB888
+    std::vector<uint8_t> raw;
+    raw.reserve((size_t)height * (1 + width * 3));
+    for (int y = 0; y < height; y++) {
+        raw.push_back(0);
+        for (int x = 0; x < width; x++) {
+            uint16_t c = pixels[y * width + x];
+            raw.push_back(((c >> 11) & 0x1F) * 255 / 31);
+            raw.push_back(((c >> 5) & 0x3F) * 255 / 63);
+            raw.push_back((c & 0x1F) * 255 / 31);
+        }
+    }
+
+    // zlib stream made of stored (uncompressed) deflate blocks
+    std::vector<uint8_t> idat = {0x78, 0x01};
+    size_t offset = 0;
+    do {
+        size_t length = std::min<size_t>(raw.size() - offset, 65535);
+        bool last = offset + length == raw.size();
+        idat.push_back(last ? 1 : 0);
+        idat.push_back(length & 0xFF);
+        idat.push_back(length >> 8);
+        idat.push_back(~length & 0xFF);
+        idat.push_back((~length >> 8) & 0xFF);
+        idat.insert(idat.end(), raw.begin() + offset, raw.begin() + offset + length);
+        offset += length;
+    } while (offset < raw.size());
+
+    uint32_t a = 1, b = 0;  // Adler-32
+    for (uint8_t byte : raw) {
+        a = (a + byte) % 65521;
+        b = (b + a) % 65521;
+    }
+    putBE32(idat, (b << 16) | a);
+
+    std::vector<uint8_t> ihdr;
+    putBE32(ihdr, width);
+    putBE32(ihdr, height);
+    ihdr.push_back(8);  // Bit depth
+    ihdr.push_back(2);  // Truecolor RGB
+    ihdr.push_back(0);
+    ihdr.push_back(0);
+    ihdr.push_back(0);
+
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) return false;
+    static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    fwrite(signature, 1, sizeof(signature), file);
+    writeChunk(file, "IHDR", ihdr);
+    writeChunk(file, "IDAT", idat);
+    writeChunk(file, "IEND", std::vector<uint8_t>());
+    fclose(file);
+    return true;
+}
@@ -0,0 +1,9 @@
+// Dependency-free PNG export for host snapshots (uncompressed deflate blocks)
+#ifndef PNG_WRITER_H
+#define PNG_WRITER_H
+
+#include <stdint.h>
+
+bool writePngRGB565(const char *path, const uint16_t *pixels, int width, int height);
+
+#endif // PNG_WRITER_H
@@ -0,0 +1,31 @@
+// telemetry.h for the native build: only the LVGL pool is real, there are no ESP heaps
+#include "telemetry.h"
+#include <lvgl.h>
+#include "lvgl_pool.h"
+
+MemorySample sampleMemory() {
+    MemorySample sample = {};
+    sample.uptimeSec = millis() / 1000;
+
+    lv_mem_monitor_t mon;
+    lvglPoolMonitor(&mon);
+    sample.lvglUsed = mon.total_size - mon.free_size;
+    sample.lvglLargest = mon.free_biggest_size;
+    sample.lvglFragPct = mon.frag_pct;
+    return sample;
+}
+
+void telemetryBegin(TelemetryScope scope) {}
+void telemetrySample(TelemetryScope scope) {}
+void telemetryEnd(TelemetryScope scope) {}
+void telemetryUpdate() {}
+void resetTelemetryHighWater() {}
+
+void printTelemetryReport(bool full) {
+    MemorySample sample = sampleMemory();
+    Serial.print("MEM lv ");
+    Serial.print(sample.lvglUsed);
+    Serial.print(" used ");
+    Serial.print(sample.lvglFragPct);
+    Serial.println("%");
+}
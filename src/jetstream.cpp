@@ -0,0 +1,382 @@
+#include "jetstream.h"
+#include <ArduinoJson.h>
+#include <esp_websocket_client.h>
+#include <esp_heap_caps.h>
+#include <sys/time.h>
+#include "bluesky.h"
+#include "feed_sources.h"
+#include "post_store.h"
+#include "wifi_manager.h"
+#include "xrpc_client.h"
+
+#define EVENT_JSON_CAPACITY 4096  // One filtered candidate event
+#define WEBSOCKET_TASK_STACK 8192  // The client's own task; events are matched on it
+
+// A tagged post on its way from the WebSocket task to the connection task,
+// which looks up the author before offering it
+struct StreamMatch {
+    FeedItem item;
+    char did[64];
+};
+
+struct ProfileEntry {
+    char did[64];
+    char handle[POST_AUTHOR_MAX];
+    char avatar[256];
+};
+
+static TaskHandle_t streamTask = NULL;
+static volatile bool live = false;
+static volatile bool closed = false;  // The client dropped the connection or failed to open it
+static JetstreamStats stats;
+static char tagLower[64];
+
+static char *message = NULL;  // Event being assembled from WebSocket fragments
+static bool messageSkipped = false;
+static DynamicJsonDocument *doc = NULL;
+static StaticJsonDocument<384> filter;
+
+static uint64_t cursorUs = 0;       // time_us of the newest event seen
+static uint64_t connectedAtUs = 0;  // Wall clock at connect; older events are replayed
+
+static StreamMatch *matchPool = NULL;
+static QueueHandle_t freeMatches = NULL;
+static QueueHandle_t readyMatches = NULL;
+static ProfileEntry *profiles = NULL;
+static int nextProfile = 0;
+
+static uint64_t wallClockUs() {
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    return (uint64_t)now.tv_sec * 1000000ULL + now.tv_usec;
+}
+
+// Case-insensitive search for needle (lower case) in the first length bytes of text.
+// Almost every event fails on the first character, so this is a byte compare per event byte.
+static bool containsIgnoreCase(const char *text, size_t length, const char *needle) {
+    size_t needleLength = strlen(needle);
+    if (needleLength == 0 || length < needleLength) return false;
+    char first = needle[0];
+    char firstUpper = toupper(first);
+    const char *last = text + length - needleLength;
+    for (const char *p = text; p <= last; p++) {
+        if (*p != first && *p != firstUpper) continue;
+        size_t i = 1;
+        while (i < needleLength && tolower((uint8_t)p[i]) == needle[i]) i++;
+        if (i == needleLength) return true;
+    }
+    return false;
+}
+
+// "#tag" as a whole hashtag, for clients that don't write facets
+static bool textHasTag(const char *text) {
+    size_t tagLength = strlen(tagLower);
+    for (const char *p = strchr(text, '#'); p != NULL; p = strchr(p + 1, '#')) {
+        char next = p[1 + tagLength];
+        if (strncasecmp(p + 1, tagLower, tagLength) == 0 && !isalnum((uint8_t)next) && next != '_') return true;
+    }
+    return false;
+}
+
+static bool facetsHaveTag(JsonArrayConst facets) {
+    for (JsonObjectConst facet : facets) {
+        for (JsonObjectConst feature : facet["features"].as<JsonArrayConst>()) {
+            if (strcasecmp(feature["tag"] | "", tagLower) == 0) return true;
+        }
+    }
+    return false;
+}
+
+// Full parse of an event that mentions the tag somewhere
+static void checkCandidate(const char *data, size_t length, uint64_t timeUs) {
+    DeserializationError error = deserializeJson(*doc, data, length, DeserializationOption::Filter(filter));
+    if (error) return;
+    JsonObjectConst commit = (*doc)["commit"];
+    if (strcmp((*doc)["kind"] | "", "commit") != 0 || strcmp(commit["operation"] | "", "create") != 0 ||
+        strcmp(commit["collection"] | "", "app.bsky.feed.post") != 0) {
+        return;
+    }
+    const char *text = commit["record"]["text"] | "";
+    if (!facetsHaveTag(commit["record"]["facets"].as<JsonArrayConst>()) && !textHasTag(text)) return;
+
+    stats.matches++;
+    StreamMatch *match;
+    if (xQueueReceive(freeMatches, &match, 0) != pdTRUE) {
+        stats.dropped++;
+        return;
+    }
+    const char *did = (*doc)["did"] | "";
+    char uri[160];
+    snprintf(uri, sizeof(uri), "at://%s/app.bsky.feed.post/%s", did, commit["rkey"] | "");
+    strlcpy(match->did, did, sizeof(match->did));
+    FeedItem &item = match->item;
+    item.createdAtMs = parseIsoTimestamp(commit["record"]["createdAt"] | "");
+    if (item.createdAtMs == 0) item.createdAtMs = timeUs / 1000;
+    copyUtf8(item.text, sizeof(item.text), text);
+    item.uriHash = feedHash(uri);
+    item.textHash = feedTextHash(item.text);
+    item.network = FEED_NETWORK_BLUESKY;
+    item.handle[0] = '\0';
+    item.avatar[0] = '\0';
+    xQueueSend(readyMatches, &match, 0);
+}
+
+static void handleEvent(const char *data, size_t length) {
+    uint32_t start = micros();
+    stats.messages++;
+
+    // Every event carries time_us near the start; the cursor doesn't need the parser
+    uint64_t timeUs = 0;
+    const char *timeField = strstr(data, "\"time_us\":");
+    if (timeField != NULL) {
+        timeUs = strtoull(timeField + 10, NULL, 10);
+        if (timeUs > cursorUs) cursorUs = timeUs;
+        if (timeUs < connectedAtUs) stats.replayed++;
+        stats.lagUs = (int64_t)(wallClockUs() - timeUs);
+    }
+
+    if (containsIgnoreCase(data, length, tagLower)) {
+        stats.prefilterHits++;
+        checkCandidate(data, length, timeUs);
+    }
+
+    uint32_t elapsed = micros() - start;
+    if (elapsed > stats.maxMatchUs) stats.maxMatchUs = elapsed;
+}
+
+static void onWebsocketEvent(void *arg, esp_event_base_t base, int32_t eventId, void *eventData) {
+    esp_websocket_event_data_t *data = (esp_websocket_event_data_t *)eventData;
+    switch (eventId) {
+        case WEBSOCKET_EVENT_CONNECTED:
+            stats.connects++;
+            connectedAtUs = wallClockUs();
+            live = true;
+            break;
+        case WEBSOCKET_EVENT_DISCONNECTED:
+        case WEBSOCKET_EVENT_ERROR:
+            live = false;
+            closed = true;
+            break;
+        case WEBSOCKET_EVENT_DATA:
+            if (data->op_code != 0x01) break;  // Text frames only; the client answers pings itself
+            stats.bytes += data->data_len;
+            // Long frames arrive in buffer-sized pieces
+            if (data->payload_offset == 0) {
+                messageSkipped = data->payload_len > JETSTREAM_MESSAGE_MAX;
+                if (messageSkipped) stats.oversized++;
+            }
+            if (messageSkipped) break;
+            memcpy(message + data->payload_offset, data->data_ptr, data->data_len);
+            if (data->payload_offset + data->data_len < data->payload_len) break;
+            message[data->payload_len] = '\0';
+            handleEvent(message, data->payload_len);
+            break;
+    }
+}
+
+// Handle and avatar for a DID, from the cache or getProfile
+static bool resolveProfile(const char *did, FeedItem &item) {
+    for (int i = 0; i < JETSTREAM_PROFILE_CACHE; i++) {
+        if (strcmp(profiles[i].did, did) == 0) {
+            strlcpy(item.handle, profiles[i].handle, sizeof(item.handle));
+            strlcpy(item.avatar, profiles[i].avatar, sizeof(item.avatar));
+            return true;
+        }
+    }
+
+    XrpcClient xrpc;
+    int httpCode = HTTPC_ERROR_CONNECTION_REFUSED;
+    bool ok = false;
+    if (xrpc.begin(blueskyEndpoint(JETSTREAM_PROFILE_URL) + "?actor=" + did, 5000)) httpCode = xrpc.GET();
+    if (httpCode == HTTP_CODE_OK) {
+        StaticJsonDocument<64> profileFilter;
+        profileFilter["handle"] = true;
+        profileFilter["avatar"] = true;
+        StaticJsonDocument<512> profile;
+        JsonStreamReader body = xrpc.body();
+        ok = !deserializeJson(profile, body, DeserializationOption::Filter(profileFilter));
+        xrpc.end(&body);
+        ok = ok && (profile["handle"] | "")[0] != '\0';
+        if (ok) {
+            ProfileEntry &entry = profiles[nextProfile];
+            nextProfile = (nextProfile + 1) % JETSTREAM_PROFILE_CACHE;
+            strlcpy(entry.did, did, sizeof(entry.did));
+            copyUtf8(entry.handle, sizeof(entry.handle), profile["handle"] | "");
+            copyUtf8(entry.avatar, sizeof(entry.avatar), profile["avatar"] | "");
+            strlcpy(item.handle, entry.handle, sizeof(item.handle));
+            strlcpy(item.avatar, entry.avatar, sizeof(item.avatar));
+        }
+    }
+    xrpc.end();
+    if (!ok) {
+        Serial.print("Jetstream: no profile for ");
+        Serial.print(did);
+        Serial.print(" (HTTP ");
+        Serial.print(httpCode);
+        Serial.println(")");
+    }
+    return ok;
+}
+
+static void showMatch(StreamMatch *match) {
+    FeedItem &item = match->item;
+    if (!resolveProfile(match->did, item)) return;
+    if (!passesFeedRules(FEED_BLUESKY_TAG, item.handle, item.text)) return;
+
+    bool shown = offerStreamedPost(item);
+    if (shown) stats.shown++;
+    Serial.print("Jetstream: #");
+    Serial.print(BLUESKY_SEARCH_TAG);
+    Serial.print(" post from @");
+    Serial.print(item.handle);
+    Serial.print(", ");
+    Serial.print(stats.lagUs / 1000);
+    Serial.println(shown ? " ms behind, shown" : " ms behind, already seen or older than the top");
+}
+
+static void buildUrl(char *url, size_t size) {
+    snprintf(url, size, "%s?wantedCollections=app.bsky.feed.post", JETSTREAM_URL);
+    if (cursorUs == 0) return;
+    if (wallClockUs() > cursorUs + JETSTREAM_MAX_REPLAY_US) {
+        Serial.println("Jetstream: down too long to replay, starting live and polling for the gap");
+        cursorUs = 0;
+        requestFeedRefresh();
+        return;
+    }
+    size_t length = strlen(url);
+    snprintf(url + length, size - length, "&cursor=%llu", (unsigned long long)(cursorUs - JETSTREAM_REWIND_US));
+}
+
+// Owns the connection: opens it, looks up authors for the matches it produces,
+// and reopens it with backoff when it drops
+static void jetstreamTask(void *param) {
+    static char url[256];
+    uint32_t backoffMs = JETSTREAM_BACKOFF_BASE;
+    for (;;) {
+        waitForWifi(UINT32_MAX);
+        buildUrl(url, sizeof(url));
+        Serial.print("Jetstream: connecting to ");
+        Serial.println(url);
+
+        esp_websocket_client_config_t config = {};
+        config.uri = url;
+        config.cert_pem = JETSTREAM_CA_PEM;
+        config.disable_auto_reconnect = true;  // Every reconnect needs a fresh cursor in the URL
+        config.buffer_size = 4096;
+        config.task_stack = WEBSOCKET_TASK_STACK;
+        config.user_agent = "SeaGLBadge/1.0";
+        closed = false;
+        uint32_t connectsBefore = stats.connects;
+        esp_websocket_client_handle_t client = esp_websocket_client_init(&config);
+        esp_websocket_register_events(client, WEBSOCKET_EVENT_ANY, onWebsocketEvent, NULL);
+        esp_websocket_client_start(client);
+
+        while (!closed && wifiConnected()) {
+            StreamMatch *match;
+            if (xQueueReceive(readyMatches, &match, pdMS_TO_TICKS(1000)) == pdTRUE) {
+                showMatch(match);
+                xQueueSend(freeMatches, &match, 0);
+            }
+        }
+
+        esp_websocket_client_destroy(client);
+        live = false;
+        bool wasLive = stats.connects != connectsBefore;
+        if (wasLive) {
+            stats.disconnects++;
+            backoffMs = JETSTREAM_BACKOFF_BASE;
+        }
+        uint32_t delayMs = backoffMs + random(backoffMs / 4 + 1);
+        Serial.print(wasLive ? "Jetstream: disconnected" : "Jetstream: connection failed");
+        Serial.print(", retrying in ");
+        Serial.print(delayMs);
+        Serial.println(" ms");
+        vTaskDelay(pdMS_TO_TICKS(delayMs));
+        backoffMs = min(backoffMs * 2, (uint32_t)JETSTREAM_BACKOFF_MAX);
+    }
+}
+
+void startJetstream() {
+    if (!JETSTREAM_ENABLED || streamTask != NULL) return;
+    xrpcInit();
+    const char *ca = JETSTREAM_CA_PEM;
+    if (ca == NULL && !XRPC_ALLOW_UNVERIFIED && strncmp(JETSTREAM_URL, "wss://", 6) == 0) {
+        Serial.println("ERROR: No CA bundle for Jetstream, not streaming (see tools/ca_bundle.py)");
+        return;
+    }
+
+    size_t i = 0;
+    for (; BLUESKY_SEARCH_TAG[i] != '\0' && i < sizeof(tagLower) - 1; i++) tagLower[i] = tolower(BLUESKY_SEARCH_TAG[i]);
+    tagLower[i] = '\0';
+
+    message = (char *)heap_caps_malloc(JETSTREAM_MESSAGE_MAX + 1, MALLOC_CAP_SPIRAM);
+    matchPool = (StreamMatch *)heap_caps_malloc(sizeof(StreamMatch) * JETSTREAM_MATCH_QUEUE, MALLOC_CAP_SPIRAM);
+    profiles = (ProfileEntry *)heap_caps_calloc(JETSTREAM_PROFILE_CACHE, sizeof(ProfileEntry), MALLOC_CAP_SPIRAM);
+    doc = new DynamicJsonDocument(EVENT_JSON_CAPACITY);
+    freeMatches = xQueueCreate(JETSTREAM_MATCH_QUEUE, sizeof(StreamMatch *));
+    readyMatches = xQueueCreate(JETSTREAM_MATCH_QUEUE, sizeof(StreamMatch *));
+    if (message == NULL || matchPool == NULL || profiles == NULL || doc->capacity() == 0 ||
+        freeMatches == NULL || readyMatches == NULL) {
+        Serial.println("ERROR: Not enough memory for Jetstream, streaming disabled");
+        return;
+    }
+    for (int slot = 0; slot < JETSTREAM_MATCH_QUEUE; slot++) {
+        StreamMatch *match = &matchPool[slot];
+        xQueueSend(freeMatches, &match, 0);
+    }
+
+    filter["kind"] = true;
+    filter["did"] = true;
+    filter["commit"]["operation"] = true;
+    filter["commit"]["collection"] = true;
+    filter["commit"]["rkey"] = true;
+    filter["commit"]["record"]["text"] = true;
+    filter["commit"]["record"]["createdAt"] = true;
+    filter["commit"]["record"]["facets"][0]["features"][0]["tag"] = true;
+
+    xTaskCreatePinnedToCore(jetstreamTask, "jetstream", JETSTREAM_TASK_STACK, NULL,
+                            JETSTREAM_TASK_PRIORITY, &streamTask, JETSTREAM_TASK_CORE);
+}
+
+bool jetstreamLive() {
+    return live;
+}
+
+const JetstreamStats &jetstreamStats() {
+    return stats;
+}
+
+void printJetstreamStats() {
+    if (!JETSTREAM_ENABLED) {
+        Serial.println("Jetstream: off (JETSTREAM_ENABLED)");
+        return;
+    }
+    Serial.print("Jetstream: ");
+    Serial.print(live ? "live" : "down");
+    Serial.print(", ");
+    Serial.print(stats.connects);
+    Serial.print(" connects, ");
+    Serial.print(stats.disconnects);
+    Serial.print(" drops, ");
+    Serial.print(stats.messages);
+    Serial.print(" events (");
+    Serial.print(stats.replayed);
+    Serial.print(" replayed, ");
+    Serial.print(stats.oversized);
+    Serial.print(" oversized), ");
+    Serial.print((uint32_t)(stats.bytes / 1024));
+    Serial.println(" KB");
+    Serial.print("  ");
+    Serial.print(stats.prefilterHits);
+    Serial.print(" parsed, ");
+    Serial.print(stats.matches);
+    Serial.print(" matched, ");
+    Serial.print(stats.shown);
+    Serial.print(" shown, ");
+    Serial.print(stats.dropped);
+    Serial.print(" dropped; slowest match check ");
+    Serial.print(stats.maxMatchUs);
+    Serial.print(" us, lag ");
+    Serial.print((int32_t)(stats.lagUs / 1000));
+    Serial.println(" ms");
+}
@@ -0,0 +1,296 @@
+#include "lvgl_pool.h"
+#include <Arduino.h>
+
+#define NO_SLAB -1
+
+static const uint16_t classSizes[LVGL_POOL_CLASS_COUNT] = {16, 24, 32, 48, 64, 96, 128, 192, 256};
+
+// One slab of the arena. Blocks are handed out from the free list first, then
+// from the part of the slab never used yet, so a new slab needs no setup.
+struct PoolSlab {
+    void *freeList;
+    uint16_t untouched;  // Index of the first block never handed out
+    uint16_t used;
+    int8_t sizeClass;    // NO_SLAB while the slab is free
+    int16_t prev;        // Neighbours in its class's list of slabs with room
+    int16_t next;
+};
+
+// Header in front of every PSRAM tier block
+struct LargeHeader {
+    uint32_t size;
+    uint32_t internal;  // Fell back to the internal heap
+};
+
+static_assert(sizeof(LargeHeader) == 8, "large blocks stay 8-byte aligned");
+static_assert(LVGL_POOL_SLAB_COUNT <= INT16_MAX, "slab indexes are int16_t");
+
+alignas(8) static uint8_t arena[LVGL_POOL_ARENA_SIZE];
+static PoolSlab slabs[LVGL_POOL_SLAB_COUNT];
+static int16_t roomy[LVGL_POOL_CLASS_COUNT];   // Head of each class's slabs with free blocks
+static uint16_t classSlabs[LVGL_POOL_CLASS_COUNT];
+static bool ready = false;
+static LvglPoolStats stats;
+
+static void setup() {
+    for (int i = 0; i < LVGL_POOL_SLAB_COUNT; i++) {
+        slabs[i].sizeClass = NO_SLAB;
+        slabs[i].prev = NO_SLAB;
+        slabs[i].next = NO_SLAB;
+    }
+    for (int c = 0; c < LVGL_POOL_CLASS_COUNT; c++) {
+        roomy[c] = NO_SLAB;
+    }
+    ready = true;
+}
+
+static int classFor(size_t size) {
+    for (int c = 0; c < LVGL_POOL_CLASS_COUNT; c++) {
+        if (size <= classSizes[c]) return c;
+    }
+    return NO_SLAB;
+}
+
+static uint16_t blocksPerSlab(int sizeClass) {
+    return LVGL_POOL_SLAB_SIZE / classSizes[sizeClass];
+}
+
+static bool inArena(const void *p) {
+    return (const uint8_t *)p >= arena && (const uint8_t *)p < arena + sizeof(arena);
+}
+
+// A class's slabs with room, doubly linked by index
+static void unlinkSlab(int16_t &head, int16_t index) {
+    PoolSlab &slab = slabs[index];
+    if (slab.prev != NO_SLAB) slabs[slab.prev].next = slab.next;
+    if (slab.next != NO_SLAB) slabs[slab.next].prev = slab.prev;
+    if (head == index) head = slab.next;
+    slab.prev = NO_SLAB;
+    slab.next = NO_SLAB;
+}
+
+static void pushSlab(int16_t &head, int16_t index) {
+    slabs[index].prev = NO_SLAB;
+    slabs[index].next = head;
+    if (head != NO_SLAB) slabs[head].prev = index;
+    head = index;
+}
+
+static void countSmall(int sizeClass, int delta) {
+    stats.classUsed[sizeClass] += delta;
+    if (stats.classUsed[sizeClass] > stats.classPeak[sizeClass]) stats.classPeak[sizeClass] = stats.classUsed[sizeClass];
+    stats.smallBytes += delta * classSizes[sizeClass];
+    if (stats.smallBytes > stats.smallPeak) stats.smallPeak = stats.smallBytes;
+}
+
+// Lowest free slab, so the slabs in use pack towards the start of the arena and
+// the free ones stay in one run at the end
+static int16_t takeSlab() {
+    for (int i = 0; i < LVGL_POOL_SLAB_COUNT; i++) {
+        if (slabs[i].sizeClass == NO_SLAB) return i;
+    }
+    return NO_SLAB;
+}
+
+static void *allocSmall(int sizeClass) {
+    int16_t index = roomy[sizeClass];
+    if (index == NO_SLAB) {
+        index = takeSlab();
+        if (index == NO_SLAB) return NULL;
+        PoolSlab &slab = slabs[index];
+        slab.freeList = NULL;
+        slab.untouched = 0;
+        slab.used = 0;
+        slab.sizeClass = sizeClass;
+        pushSlab(roomy[sizeClass], index);
+        classSlabs[sizeClass]++;
+        stats.slabsUsed++;
+        if (stats.slabsUsed > stats.slabsPeak) stats.slabsPeak = stats.slabsUsed;
+    }
+
+    PoolSlab &slab = slabs[index];
+    void *block;
+    if (slab.freeList != NULL) {
+        block = slab.freeList;
+        slab.freeList = *(void **)block;
+    } else {
+        block = arena + index * LVGL_POOL_SLAB_SIZE + slab.untouched * classSizes[sizeClass];
+        slab.untouched++;
+    }
+    slab.used++;
+    if (slab.used == blocksPerSlab(sizeClass)) unlinkSlab(roomy[sizeClass], index);
+    countSmall(sizeClass, 1);
+    return block;
+}
+
+static void freeSmall(void *p) {
+    int16_t index = ((uint8_t *)p - arena) / LVGL_POOL_SLAB_SIZE;
+    PoolSlab &slab = slabs[index];
+    int sizeClass = slab.sizeClass;
+    if (slab.used == blocksPerSlab(sizeClass)) pushSlab(roomy[sizeClass], index);
+    *(void **)p = slab.freeList;
+    slab.freeList = p;
+    slab.used--;
+    countSmall(sizeClass, -1);
+
+    // An empty slab goes back to the arena unless it's its class's last one, so a
+    // class hovering at a slab boundary doesn't take and return it on every call
+    if (slab.used == 0 && classSlabs[sizeClass] > 1) {
+        unlinkSlab(roomy[sizeClass], index);
+        slab.sizeClass = NO_SLAB;
+        classSlabs[sizeClass]--;
+        stats.slabsUsed--;
+    }
+}
+
+static void *allocLarge(size_t size) {
+    LargeHeader *header = (LargeHeader *)ps_malloc(sizeof(LargeHeader) + size);
+    bool internal = header == NULL;
+    if (internal) header = (LargeHeader *)malloc(sizeof(LargeHeader) + size);
+    if (header == NULL) return NULL;
+    header->size = size;
+    header->internal = internal;
+    if (internal) stats.largeInternal++;
+    stats.largeBytes += size;
+    if (stats.largeBytes > stats.largePeak) stats.largePeak = stats.largeBytes;
+    return header + 1;
+}
+
+static void freeLarge(void *p) {
+    LargeHeader *header = (LargeHeader *)p - 1;
+    stats.largeBytes -= header->size;
+    free(header);
+}
+
+// Usable size of an allocation
+static size_t blockSize(void *p) {
+    if (inArena(p)) return classSizes[slabs[((uint8_t *)p - arena) / LVGL_POOL_SLAB_SIZE].sizeClass];
+    return ((LargeHeader *)p - 1)->size;
+}
+
+extern "C" void *lvglPoolAlloc(size_t size) {
+    if (!ready) setup();
+    stats.allocs++;
+    void *p = NULL;
+    int sizeClass = classFor(size);
+    if (sizeClass != NO_SLAB) {
+        p = allocSmall(sizeClass);
+        if (p == NULL) stats.spills++;
+    }
+    if (p == NULL) p = allocLarge(size);
+    if (p == NULL) {
+        stats.failures++;
+        return NULL;
+    }
+    stats.liveBlocks++;
+    return p;
+}
+
+extern "C" void lvglPoolFree(void *p) {
+    if (p == NULL) return;
+    stats.frees++;
+    stats.liveBlocks--;
+    if (inArena(p)) {
+        freeSmall(p);
+    } else {
+        freeLarge(p);
+    }
+}
+
+extern "C" void *lvglPoolRealloc(void *p, size_t size) {
+    if (p == NULL) return lvglPoolAlloc(size);
+    stats.reallocs++;
+
+    // Still the same class, or a large block shrinking but staying large: nothing to move
+    size_t oldSize = blockSize(p);
+    if (inArena(p) && classFor(size) == classFor(oldSize)) return p;
+    if (!inArena(p) && size <= oldSize && classFor(size) == NO_SLAB) return p;
+
+    void *moved = lvglPoolAlloc(size);
+    if (moved == NULL) return NULL;
+    memcpy(moved, p, min(oldSize, size));
+    lvglPoolFree(p);
+    return moved;
+}
+
+const LvglPoolStats &lvglPoolStats() {
+    uint32_t run = 0;
+    uint32_t longest = 0;
+    for (int i = 0; i < LVGL_POOL_SLAB_COUNT; i++) {
+        run = ready && slabs[i].sizeClass != NO_SLAB ? 0 : run + 1;
+        if (run > longest) longest = run;
+    }
+    stats.largestFree = longest * LVGL_POOL_SLAB_SIZE;
+    return stats;
+}
+
+uint8_t lvglPoolFragPct(const LvglPoolStats &s) {
+    uint32_t freeSlabBytes = (LVGL_POOL_SLAB_COUNT - s.slabsUsed) * LVGL_POOL_SLAB_SIZE;
+    return freeSlabBytes > 0 ? 100 - (uint64_t)s.largestFree * 100 / freeSlabBytes : 0;
+}
+
+uint16_t lvglPoolClassSize(int sizeClass) {
+    return sizeClass >= 0 && sizeClass < LVGL_POOL_CLASS_COUNT ? classSizes[sizeClass] : 0;
+}
+
+void lvglPoolMonitor(lv_mem_monitor_t *mon) {
+    const LvglPoolStats &s = lvglPoolStats();
+    memset(mon, 0, sizeof(*mon));
+    uint32_t freeBytes = LVGL_POOL_ARENA_SIZE - s.smallBytes;
+    mon->total_size = LVGL_POOL_ARENA_SIZE + s.largeBytes;
+    mon->free_size = freeBytes;
+    mon->free_biggest_size = s.largestFree;
+    mon->free_cnt = LVGL_POOL_SLAB_COUNT - s.slabsUsed;
+    mon->used_cnt = s.liveBlocks;
+    mon->max_used = s.smallPeak + s.largePeak;
+    mon->used_pct = mon->total_size > 0 ? 100 - (uint64_t)freeBytes * 100 / mon->total_size : 0;
+    mon->frag_pct = lvglPoolFragPct(s);
+}
+
+void printLvglPoolStats() {
+    const LvglPoolStats &s = lvglPoolStats();
+    Serial.print("LVGL pool: ");
+    Serial.print(s.liveBlocks);
+    Serial.print(" blocks live, arena ");
+    Serial.print(s.smallBytes);
+    Serial.print("/");
+    Serial.print(LVGL_POOL_ARENA_SIZE);
+    Serial.print(" bytes (peak ");
+    Serial.print(s.smallPeak);
+    Serial.print(") in ");
+    Serial.print(s.slabsUsed);
+    Serial.print("/");
+    Serial.print(LVGL_POOL_SLAB_COUNT);
+    Serial.print(" slabs (peak ");
+    Serial.print(s.slabsPeak);
+    Serial.print("), largest free ");
+    Serial.print(s.largestFree);
+    Serial.print(", PSRAM ");
+    Serial.print(s.largeBytes);
+    Serial.print(" bytes (peak ");
+    Serial.print(s.largePeak);
+    Serial.println(")");
+    Serial.print("  ");
+    Serial.print(s.allocs);
+    Serial.print(" allocs, ");
+    Serial.print(s.frees);
+    Serial.print(" frees, ");
+    Serial.print(s.reallocs);
+    Serial.print(" reallocs, ");
+    Serial.print(s.spills);
+    Serial.print(" spilled to PSRAM, ");
+    Serial.print(s.largeInternal);
+    Serial.print(" large in internal RAM, ");
+    Serial.print(s.failures);
+    Serial.println(" failed");
+    Serial.print("  Blocks by class (now/peak):");
+    for (int c = 0; c < LVGL_POOL_CLASS_COUNT; c++) {
+        Serial.print(" ");
+        Serial.print(classSizes[c]);
+        Serial.print("=");
+        Serial.print(s.classUsed[c]);
+        Serial.print("/");
+        Serial.print(s.classPeak[c]);
+    }
+    Serial.println();
+}
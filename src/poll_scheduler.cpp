@@ -0,0 +1,213 @@
+#include "poll_scheduler.h"
+#include <sys/time.h>
+
+#define CLOCK_VALID_AFTER 1600000000  // Before this, SNTP hasn't set the clock yet
+#define BACKOFF_MAX_SHIFT 10
+
+// Starts at API_REFRESH_INTERVAL, as if posts were arriving at the rate that fits it
+static PollStats freshStats() {
+    PollStats fresh = {};
+    fresh.intervalMs = API_REFRESH_INTERVAL;
+    fresh.postsPerMin = POLL_TARGET_POSTS * 60000.0f / API_REFRESH_INTERVAL;
+    return fresh;
+}
+
+static PollStats stats = freshStats();
+static bool polled = false;
+static uint32_t lastPollAt = 0;       // millis() at the start of the last poll
+static int64_t lastPollWallMs = 0;    // Same, wall clock; 0 if it wasn't set or the poll doesn't count
+static uint32_t pollStartedAt = 0;
+static int64_t pollStartWallMs = 0;
+static int pollNewPosts = 0;
+static int pollFreshPosts = 0;
+static bool holding = false;
+static uint32_t holdUntil = 0;        // millis(); no poll before this
+static volatile bool paused = false;
+static volatile bool pausedSincePoll = false;
+static uint32_t pausedAt = 0;
+
+static int64_t wallClockMs() {
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    if (now.tv_sec < CLOCK_VALID_AFTER) return 0;
+    return (int64_t)now.tv_sec * 1000 + now.tv_usec / 1000;
+}
+
+void pollFetchBegin() {
+    pollStartedAt = millis();
+    pollStartWallMs = wallClockMs();
+    pollNewPosts = 0;
+    pollFreshPosts = 0;
+
+    // Lag and arrival rate compare against the previous poll, which says nothing across a pause
+    if (pausedSincePoll) {
+        lastPollWallMs = 0;
+        pausedSincePoll = false;
+    }
+}
+
+void pollFetchPost(int64_t createdAtMs) {
+    pollNewPosts++;
+    if (lastPollWallMs == 0 || pollStartWallMs == 0 || createdAtMs < lastPollWallMs) return;
+
+    // Created since the previous poll started, so the time it waited is down to the interval
+    int64_t lag = wallClockMs() - createdAtMs;
+    if (lag < 0) lag = 0;  // Client clocks run ahead
+    pollFreshPosts++;
+    stats.freshPosts++;
+    stats.lastLagMs = lag;
+    stats.totalLagMs += lag;
+    if (stats.lastLagMs > stats.maxLagMs) stats.maxLagMs = stats.lastLagMs;
+}
+
+static uint32_t backoffMs() {
+    uint32_t delayMs = (uint32_t)POLL_MIN_INTERVAL << min(stats.failures - 1, BACKOFF_MAX_SHIFT);
+    if (delayMs > POLL_BACKOFF_MAX) delayMs = POLL_BACKOFF_MAX;
+    // Equal jitter: half fixed, half random, so badges that failed together don't retry together
+    return delayMs / 2 + esp_random() % (delayMs / 2 + 1);
+}
+
+static uint32_t velocityMs() {
+    if (stats.postsPerMin <= 0) return POLL_MAX_INTERVAL;
+    float intervalMs = POLL_TARGET_POSTS * 60000.0f / stats.postsPerMin;
+    if (intervalMs < POLL_MIN_INTERVAL) return POLL_MIN_INTERVAL;
+    if (intervalMs > POLL_MAX_INTERVAL) return POLL_MAX_INTERVAL;
+    return (uint32_t)intervalMs;
+}
+
+void pollFetchEnd(int requests, bool failed, int rateLimited, uint32_t serverWaitMs) {
+    stats.polls++;
+    stats.requests += requests;
+    stats.newPosts += pollNewPosts;
+    stats.rateLimited += rateLimited;
+
+    if (failed) {
+        stats.failedPolls++;
+        if (stats.failures < UINT8_MAX) stats.failures++;
+    } else {
+        stats.failures = 0;
+        if (pollNewPosts == 0) stats.wastedPolls++;
+        if (polled && lastPollWallMs != 0 && pollStartWallMs != 0) {
+            uint32_t elapsedMs = pollStartedAt - lastPollAt;
+            float sample = elapsedMs > 0 ? pollFreshPosts * 60000.0f / elapsedMs : 0;
+            stats.postsPerMin += POLL_RATE_SMOOTHING * (sample - stats.postsPerMin);
+        }
+    }
+    polled = true;
+    lastPollAt = pollStartedAt;
+    lastPollWallMs = pollStartWallMs;
+    stats.intervalMs = stats.failures > 0 ? backoffMs() : velocityMs();
+
+    if (serverWaitMs > 0) {
+        holding = true;
+        holdUntil = millis() + serverWaitMs;
+        stats.serverHolds++;
+    }
+
+    Serial.print("Next poll in ");
+    Serial.print(max(stats.intervalMs, serverWaitMs) / 1000);
+    if (serverWaitMs > stats.intervalMs) {
+        Serial.println(" s, as the server asked");
+    } else if (stats.failures > 0) {
+        Serial.print(" s, backing off after ");
+        Serial.print(stats.failures);
+        Serial.println(" failed poll(s)");
+    } else {
+        Serial.print(" s at ");
+        Serial.print(stats.postsPerMin, 2);
+        Serial.println(" new posts/min");
+    }
+}
+
+uint32_t pollIntervalMs() {
+    return stats.intervalMs;
+}
+
+uint32_t pollDueInMs(uint32_t intervalMs, bool force) {
+    uint32_t now = millis();
+    uint32_t dueInMs = 0;
+    if (polled && !force) {
+        uint32_t sinceMs = now - lastPollAt;
+        if (sinceMs < intervalMs) dueInMs = intervalMs - sinceMs;
+    }
+    if (holding) {
+        if ((int32_t)(holdUntil - now) > 0) {
+            dueInMs = max(dueInMs, holdUntil - now);
+        } else {
+            holding = false;
+        }
+    }
+    return dueInMs;
+}
+
+void setPollingPaused(bool pause) {
+    if (pause == paused) return;
+    if (pause) {
+        pausedAt = millis();
+        pausedSincePoll = true;
+    } else {
+        stats.pausedMs += millis() - pausedAt;
+    }
+    paused = pause;
+    Serial.println(pause ? "Polling paused" : "Polling resumed");
+}
+
+bool pollingPaused() {
+    return paused;
+}
+
+const PollStats &pollStats() {
+    return stats;
+}
+
+void resetPollStats() {
+    stats = freshStats();
+    polled = false;
+    lastPollWallMs = 0;
+    holding = false;
+    if (paused) pausedAt = millis();
+}
+
+void printPollStats() {
+    const PollStats &s = pollStats();
+    uint64_t pausedMs = s.pausedMs + (paused ? millis() - pausedAt : 0);
+    Serial.print("Polling: ");
+    Serial.print(s.polls);
+    Serial.print(" polls, ");
+    Serial.print(s.requests);
+    Serial.print(" requests, ");
+    Serial.print(s.newPosts);
+    Serial.print(" new posts; ");
+    Serial.print(s.wastedPolls);
+    Serial.print(" wasted (");
+    Serial.print(s.polls > 0 ? s.wastedPolls * 100 / s.polls : 0);
+    Serial.print("%), ");
+    Serial.print(s.failedPolls);
+    Serial.print(" failed, ");
+    Serial.print(s.rateLimited);
+    Serial.print(" rate limited, ");
+    Serial.print(s.serverHolds);
+    Serial.println(" held by the server");
+    Serial.print("  Freshness lag over ");
+    Serial.print(s.freshPosts);
+    Serial.print(" posts: avg ");
+    Serial.print(s.freshPosts > 0 ? (uint32_t)(s.totalLagMs / s.freshPosts / 1000) : 0);
+    Serial.print(" s, max ");
+    Serial.print(s.maxLagMs / 1000);
+    Serial.print(" s, last ");
+    Serial.print(s.lastLagMs / 1000);
+    Serial.println(" s");
+    Serial.print("  ");
+    Serial.print(s.postsPerMin, 2);
+    Serial.print(" new posts/min, interval ");
+    Serial.print(s.intervalMs / 1000);
+    Serial.print(" s");
+    if (s.failures > 0) {
+        Serial.print(" (backing off, ");
+        Serial.print(s.failures);
+        Serial.print(" failures)");
+    }
+    Serial.print(", paused ");
+    Serial.print((uint32_t)(pausedMs / 1000));
+    Serial.println(paused ? " s, paused now" : " s");
+}
@@ -0,0 +1,187 @@
+#include "post_layout.h"
+#include "fonts.h"
+
+#define LAYOUT_FONT_COUNT 7
+#define LAYOUT_MAX_LINES 16
+#ifdef BADGE_FONTS_SUBSET
+#define ELLIPSIS "\xE2\x80\xA6"  // U+2026, in the generated post fonts
+#else
+#define ELLIPSIS "..."  // Built-in Montserrat has no U+2026
+#endif
+
+// Largest first
+static const uint8_t fontSizes[LAYOUT_FONT_COUNT] = {28, 26, 24, 22, 20, 18, 16};
+static const lv_font_t *const sourceFonts[LAYOUT_FONT_COUNT] = {
+    &BADGE_FONT(28), &BADGE_FONT(26), &BADGE_FONT(24), &BADGE_FONT(22),
+    &BADGE_FONT(20), &BADGE_FONT(18), &BADGE_FONT(16),
+};
+static const lv_font_t *(*fallbackFor)(uint8_t fontSize) = NULL;
+
+// The UI's copies of the post fonts, so a fallback font can be attached to them
+static lv_font_t uiFonts[LAYOUT_FONT_COUNT];
+static bool uiFontsReady = false;
+
+// Layout-side copies. They share the glyph data but each has its own
+// last-glyph cache, which LVGL writes on every lookup.
+static lv_font_t layoutFonts[LAYOUT_FONT_COUNT];
+static lv_font_fmt_txt_dsc_t layoutDscs[LAYOUT_FONT_COUNT];
+static lv_font_fmt_txt_glyph_cache_t layoutCaches[LAYOUT_FONT_COUNT];
+static bool layoutFontsReady = false;
+
+static void copyUiFonts() {
+    for (int i = 0; i < LAYOUT_FONT_COUNT; i++) {
+        uiFonts[i] = *sourceFonts[i];
+        uiFonts[i].fallback = fallbackFor != NULL ? fallbackFor(fontSizes[i]) : NULL;
+    }
+    uiFontsReady = true;
+}
+
+static void copyLayoutFonts() {
+    for (int i = 0; i < LAYOUT_FONT_COUNT; i++) {
+        layoutFonts[i] = *sourceFonts[i];
+        layoutFonts[i].fallback = fallbackFor != NULL ? fallbackFor(fontSizes[i]) : NULL;
+        layoutDscs[i] = *(const lv_font_fmt_txt_dsc_t *)sourceFonts[i]->dsc;
+        layoutDscs[i].cache = &layoutCaches[i];
+        layoutFonts[i].dsc = &layoutDscs[i];
+    }
+    layoutFontsReady = true;
+}
+
+static int maxLinesFor(const lv_font_t *font) {
+    int lines = (POST_TEXT_HEIGHT + POST_TEXT_LINE_SPACE) / (lv_font_get_line_height(font) + POST_TEXT_LINE_SPACE);
+    return min(lines, LAYOUT_MAX_LINES);
+}
+
+// Finds line starts the way a wrapping label would. Returns the line count, or
+// limit + 1 as soon as the text needs more than limit lines. starts needs limit + 1 entries.
+static int wrapText(const char *text, const lv_font_t *font, int limit, uint32_t *starts) {
+    int lines = 0;
+    uint32_t pos = 0;
+    while (text[pos] != '\0') {
+        if (lines == limit) return limit + 1;
+        starts[lines++] = pos;
+        uint32_t length = _lv_txt_get_next_line(text + pos, font, 0, POST_TEXT_WIDTH, NULL, LV_TEXT_FLAG_NONE);
+        if (length == 0) break;
+        pos += length;
+    }
+    starts[lines] = pos;
+    return lines;
+}
+
+// Appends one line (without the break characters LVGL leaves at its end)
+static size_t appendLine(char *dest, size_t size, size_t used, const char *line, uint32_t length) {
+    while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r' || line[length - 1] == ' ')) {
+        length--;
+    }
+    if (used > 0 && used + 1 < size) dest[used++] = '\n';
+    if (used + length >= size) {
+        length = size - 1 - used;
+        while (length > 0 && ((uint8_t)line[length] & 0xC0) == 0x80) length--;
+    }
+    memcpy(dest + used, line, length);
+    used += length;
+    dest[used] = '\0';
+    return used;
+}
+
+// Bytes of line that fit on one line together with the ellipsis, preferring a word break
+static uint32_t ellipsisCut(const char *line, const lv_font_t *font) {
+    lv_coord_t width = lv_txt_get_width(ELLIPSIS, strlen(ELLIPSIS), font, 0, LV_TEXT_FLAG_NONE);
+    uint32_t pos = 0;
+    uint32_t lastSpace = 0;
+    while (line[pos] != '\0' && line[pos] != '\n') {
+        uint32_t next = pos;
+        uint32_t letter = _lv_txt_encoded_next(line, &next);
+        uint32_t after = next;
+        uint32_t letterNext = _lv_txt_encoded_next(line, &after);
+        width += lv_font_get_glyph_width(font, letter, letterNext);
+        if (width > POST_TEXT_WIDTH) break;
+        if (letter == ' ') lastSpace = pos;
+        pos = next;
+    }
+    return lastSpace > pos / 2 ? lastSpace : pos;
+}
+
+void layoutPostText(char *dest, size_t size, const char *text, PostLayout &layout) {
+    uint32_t start = micros();
+    if (!layoutFontsReady) copyLayoutFonts();
+
+    uint32_t starts[LAYOUT_MAX_LINES * POST_MAX_PAGES + 1];
+    int font = 0;
+    int maxLines = 0;
+    int lines = 0;
+    for (font = 0; font < LAYOUT_FONT_COUNT; font++) {
+        maxLines = maxLinesFor(&layoutFonts[font]);
+        lines = wrapText(text, &layoutFonts[font], maxLines, starts);
+        if (lines <= maxLines) break;
+    }
+
+    // Smallest size still overflows: split it into pages at that size
+    int limit = maxLines;
+    layout.truncated = false;
+    if (font == LAYOUT_FONT_COUNT) {
+        font = LAYOUT_FONT_COUNT - 1;
+        limit = maxLines * POST_MAX_PAGES;
+        if (POST_MAX_PAGES > 1) lines = wrapText(text, &layoutFonts[font], limit, starts);
+        layout.truncated = lines > limit;
+    }
+
+    size_t used = 0;
+    dest[0] = '\0';
+    if (!layout.truncated) {
+        for (int i = 0; i < lines; i++) {
+            used = appendLine(dest, size, used, text + starts[i], starts[i + 1] - starts[i]);
+        }
+        layout.sourceBytes = starts[lines];
+    } else {
+        // Doesn't fit every page either: fill every line, then cut the last one
+        lines = limit;
+        for (int i = 0; i < lines - 1; i++) {
+            used = appendLine(dest, size, used, text + starts[i], starts[i + 1] - starts[i]);
+        }
+        const char *last = text + starts[lines - 1];
+        uint32_t cut = ellipsisCut(last, &layoutFonts[font]);
+        used = appendLine(dest, size, used, last, cut);
+        if (used + strlen(ELLIPSIS) < size) {
+            strcpy(dest + used, ELLIPSIS);
+        }
+        layout.sourceBytes = starts[lines - 1] + cut;
+    }
+
+    layout.fontSize = fontSizes[font];
+    layout.lines = lines;
+    layout.pages = lines > maxLines ? (lines + maxLines - 1) / maxLines : 1;
+    layout.layoutUs = micros() - start;
+}
+
+const lv_font_t *postLayoutFont(uint8_t fontSize) {
+    if (!uiFontsReady) copyUiFonts();
+    for (int i = 0; i < LAYOUT_FONT_COUNT; i++) {
+        if (fontSizes[i] == fontSize) return &uiFonts[i];
+    }
+    return &uiFonts[3];  // 22 px
+}
+
+void postLayoutSetFallback(const lv_font_t *(*fallback)(uint8_t fontSize)) {
+    fallbackFor = fallback;
+    copyUiFonts();
+    copyLayoutFonts();
+}
+
+int postLayoutLinesPerPage(uint8_t fontSize) {
+    return maxLinesFor(postLayoutFont(fontSize));
+}
+
+void postLayoutPage(char *dest, size_t size, const char *text, const PostLayout &layout, int page) {
+    int perPage = postLayoutLinesPerPage(layout.fontSize);
+    for (int skip = page * perPage; skip > 0 && *text != '\0'; text++) {
+        if (*text == '\n') skip--;
+    }
+    const char *end = text;
+    for (int line = 0; *end != '\0'; end++) {
+        if (*end == '\n' && ++line == perPage) break;
+    }
+    size_t length = min((size_t)(end - text), size - 1);
+    memcpy(dest, text, length);
+    dest[length] = '\0';
+}
@@ -0,0 +1,234 @@
+#include "post_snapshot.h"
+#include <LittleFS.h>
+#include <rom/crc.h>
+#include <time.h>
+#include "post_store.h"
+
+#define SNAPSHOT_PATH "/posts.bin"
+#define SNAPSHOT_TEMP_PATH "/posts.tmp"
+#define SNAPSHOT_MAGIC 0x31535042  // "BPS1"
+#define SNAPSHOT_VERSION 2
+#define SNAPSHOT_POST_HEADER 20     // Fixed part of a post before the strings
+#define SNAPSHOT_V1_POST_HEADER 12  // Without the created at
+#define SNAPSHOT_MAX_BYTES (DISPLAY_POST_COUNT * (SNAPSHOT_POST_HEADER + 2 + POST_AUTHOR_MAX + 2 + POST_TEXT_MAX))
+#define CLOCK_VALID_AFTER 1600000000  // Before this, SNTP hasn't set the clock yet
+
+struct __attribute__((packed)) SnapshotHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t count;
+    uint16_t boxWidth;
+    uint16_t boxHeight;
+    uint32_t savedAt;
+    uint32_t payloadLength;
+    uint32_t crc;
+};
+
+static uint8_t *buffer = NULL;  // Serialized payload, allocated once
+static bool pending = false;
+static bool written = false;
+static unsigned long lastWrite = 0;
+static uint32_t savedCrc = 0;  // Payload on flash, so unchanged sets aren't rewritten
+
+static bool allocateBuffer() {
+    if (buffer == NULL) buffer = (uint8_t *)ps_malloc(SNAPSHOT_MAX_BYTES);
+    if (buffer == NULL) buffer = (uint8_t *)malloc(SNAPSHOT_MAX_BYTES);
+    return buffer != NULL;
+}
+
+static bool mountStorage() {
+    static bool mounted = false;
+    if (!mounted) mounted = LittleFS.begin(true);  // Formats a blank partition on first boot
+    return mounted;
+}
+
+static uint16_t readU16(const uint8_t *&p) {
+    uint16_t value = p[0] | (p[1] << 8);
+    p += 2;
+    return value;
+}
+
+static uint32_t readU32(const uint8_t *&p) {
+    uint32_t value = p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+    p += 4;
+    return value;
+}
+
+static void writeU16(uint8_t *&p, uint16_t value) {
+    *p++ = value;
+    *p++ = value >> 8;
+}
+
+static void writeU32(uint8_t *&p, uint32_t value) {
+    writeU16(p, value);
+    writeU16(p, value >> 16);
+}
+
+static int64_t readS64(const uint8_t *&p) {
+    uint32_t low = readU32(p);
+    return (int64_t)((uint64_t)readU32(p) << 32 | low);
+}
+
+static void writeS64(uint8_t *&p, int64_t value) {
+    writeU32(p, (uint64_t)value);
+    writeU32(p, (uint64_t)value >> 32);
+}
+
+// Copies a length-prefixed string into dest; false if it runs past end or doesn't fit
+static bool readString(const uint8_t *&p, const uint8_t *end, char *dest, size_t size) {
+    if (end - p < 2) return false;
+    uint16_t length = readU16(p);
+    if (length >= size || end - p < length) return false;
+    memcpy(dest, p, length);
+    dest[length] = '\0';
+    p += length;
+    return true;
+}
+
+static void writeString(uint8_t *&p, const char *text) {
+    uint16_t length = strlen(text);
+    writeU16(p, length);
+    memcpy(p, text, length);
+    p += length;
+}
+
+static bool parsePayload(const uint8_t *p, const uint8_t *end, int version, int count, PostSet &posts,
+                         int64_t *createdAtMs) {
+    for (int i = 0; i < count; i++) {
+        if (end - p < (version == 1 ? SNAPSHOT_V1_POST_HEADER : SNAPSHOT_POST_HEADER)) return false;
+        PostLayout &layout = posts.layouts[i];
+        layout.fontSize = *p++;
+        layout.lines = *p++;
+        layout.truncated = *p++ != 0;
+        layout.pages = max(*p++, (uint8_t)1);  // 0 in snapshots from before paging
+        layout.sourceBytes = readU16(p);
+        layout.layoutUs = 0;
+        posts.avatarKeys[i] = readU32(p);
+        p += 2;  // Reserved
+        createdAtMs[i] = version == 1 ? 0 : readS64(p);
+        if (!readString(p, end, posts.authors[i], POST_AUTHOR_MAX)) return false;
+        if (!readString(p, end, posts.texts[i], POST_TEXT_MAX)) return false;
+    }
+    return p == end;
+}
+
+bool restorePostSnapshot() {
+    uint32_t start = micros();
+    if (!mountStorage() || !allocateBuffer()) return false;
+
+    File file = LittleFS.open(SNAPSHOT_PATH, "r");
+    if (!file) {
+        Serial.println("Post snapshot: none saved yet");
+        return false;
+    }
+
+    SnapshotHeader header;
+    bool ok = file.read((uint8_t *)&header, sizeof(header)) == sizeof(header) &&
+              header.magic == SNAPSHOT_MAGIC && (header.version == 1 || header.version == SNAPSHOT_VERSION) &&
+              header.count <= DISPLAY_POST_COUNT && header.payloadLength <= SNAPSHOT_MAX_BYTES &&
+              file.read(buffer, header.payloadLength) == header.payloadLength;
+    file.close();
+    if (!ok || crc32_le(0, buffer, header.payloadLength) != header.crc) {
+        Serial.println("Post snapshot: unreadable, ignoring it");
+        return false;
+    }
+    if (header.boxWidth != POST_TEXT_WIDTH || header.boxHeight != POST_TEXT_HEIGHT) {
+        Serial.println("Post snapshot: laid out for another text box, ignoring it");
+        return false;
+    }
+
+    PostSet &posts = postStoreBeginWrite();
+    int64_t createdAtMs[DISPLAY_POST_COUNT];
+    if (!parsePayload(buffer, buffer + header.payloadLength, header.version, header.count, posts, createdAtMs)) {
+        Serial.println("Post snapshot: malformed, ignoring it");
+        return false;
+    }
+    posts.count = header.count;
+    postStoreRestoreTop(posts, createdAtMs);  // Before publishing: the UI may take the set right away
+    postStorePublish();
+    savedCrc = header.version == SNAPSHOT_VERSION ? header.crc : 0;  // A version 1 file is rewritten as 2
+
+    Serial.print("Post snapshot: restored ");
+    Serial.print(header.count);
+    Serial.print(" posts in ");
+    Serial.print(micros() - start);
+    Serial.print(" us");
+    time_t now = time(NULL);
+    if (header.savedAt > 0 && now > CLOCK_VALID_AFTER) {
+        Serial.print(", saved ");
+        Serial.print((uint32_t)(now - header.savedAt) / 60);
+        Serial.print(" min ago");
+    }
+    Serial.println();
+    return true;
+}
+
+void schedulePostSnapshot() {
+    pending = true;
+}
+
+// Serializes the writer's current top posts; returns the payload length
+static size_t serializeTop() {
+    uint8_t *p = buffer;
+    int count = postStoreTopCount();
+    for (int i = 0; i < count; i++) {
+        PostView post = postStoreTopPost(i);
+        *p++ = post.layout.fontSize;
+        *p++ = post.layout.lines;
+        *p++ = post.layout.truncated ? 1 : 0;
+        *p++ = post.layout.pages;
+        writeU16(p, post.layout.sourceBytes);
+        writeU32(p, post.avatarKey);
+        writeU16(p, 0);  // Reserved
+        writeS64(p, post.createdAtMs);
+        writeString(p, post.author);
+        writeString(p, post.text);
+    }
+    return p - buffer;
+}
+
+// Written to a temporary file and renamed over the old one, so a reset at any point
+// leaves either the previous snapshot or the new one, never a torn file
+void writePostSnapshotIfDue() {
+    if (!pending) return;
+    if (written && millis() - lastWrite < SNAPSHOT_MIN_INTERVAL) return;
+    if (!mountStorage() || !allocateBuffer()) return;
+    pending = false;
+
+    uint32_t start = micros();
+    size_t length = serializeTop();
+    uint32_t crc = crc32_le(0, buffer, length);
+    if (crc == savedCrc) return;  // Same posts as on flash
+
+    time_t now = time(NULL);
+    SnapshotHeader header;
+    header.magic = SNAPSHOT_MAGIC;
+    header.version = SNAPSHOT_VERSION;
+    header.count = postStoreTopCount();
+    header.boxWidth = POST_TEXT_WIDTH;
+    header.boxHeight = POST_TEXT_HEIGHT;
+    header.savedAt = now > CLOCK_VALID_AFTER ? (uint32_t)now : 0;
+    header.payloadLength = length;
+    header.crc = crc;
+
+    File file = LittleFS.open(SNAPSHOT_TEMP_PATH, "w");
+    if (!file) return;
+    bool ok = file.write((const uint8_t *)&header, sizeof(header)) == sizeof(header) &&
+              file.write(buffer, length) == length;
+    file.close();
+    if (!ok || !LittleFS.rename(SNAPSHOT_TEMP_PATH, SNAPSHOT_PATH)) {
+        LittleFS.remove(SNAPSHOT_TEMP_PATH);
+        Serial.println("Post snapshot: write failed");
+        pending = true;  // Try again next time
+        return;
+    }
+
+    savedCrc = crc;
+    written = true;
+    lastWrite = millis();
+    Serial.print("Post snapshot: saved ");
+    Serial.print((uint32_t)(sizeof(header) + length));
+    Serial.print(" bytes in ");
+    Serial.print(micros() - start);
+    Serial.println(" us");
+}
@@ -0,0 +1,280 @@
+#include "post_store.h"
+#include <atomic>
+
+#define NO_HANDLE 0xFFFF
+
+// Interned author handle, stored display-ready with its "@"
+struct HandleEntry {
+    uint32_t hash;
+    uint32_t lastUsed;
+    char author[POST_AUTHOR_MAX];
+};
+
+// A post kept by the writer's top-K
+struct PostSlot {
+    int64_t createdAtMs;
+    uint16_t author;  // Index into handles
+    uint32_t avatarKey;
+    PostLayout layout;
+    char text[POST_TEXT_MAX];  // Laid out
+};
+
+// Everything the store owns, allocated once by postStoreInit()
+struct StoreArena {
+    PostSet sets[2];
+    PostSlot slots[DISPLAY_POST_COUNT];
+    HandleEntry handles[POST_HANDLE_SLOTS];
+};
+
+static StoreArena *arena = NULL;
+
+// Writer-side ranking: slot indices, newest first
+static uint8_t topSlots[DISPLAY_POST_COUNT];
+static int topCount = 0;
+static uint32_t handleClock = 0;
+
+// Bit 0 is the index of the front (UI) buffer, bit 1 means the other buffer holds
+// a published set the UI hasn't picked up yet. Only the UI flips the front index,
+// and only while the pending bit is set, so the writer always owns the back buffer.
+#define STORE_FRONT 0x1
+#define STORE_PENDING 0x2
+static std::atomic<uint32_t> storeState(0);
+static uint32_t nextGeneration = 1;
+
+bool postStoreInit() {
+    if (arena != NULL) return true;
+
+    bool inPsram = true;
+    arena = (StoreArena *)ps_malloc(sizeof(StoreArena));
+    if (arena == NULL) {
+        inPsram = false;
+        arena = (StoreArena *)malloc(sizeof(StoreArena));
+    }
+    if (arena == NULL) {
+        Serial.println("ERROR: Failed to allocate the post store");
+        return false;
+    }
+    memset(arena, 0, sizeof(StoreArena));
+
+    Serial.print("Post store: ");
+    Serial.print((uint32_t)sizeof(StoreArena));
+    Serial.println(inPsram ? " bytes in PSRAM" : " bytes in internal RAM");
+    return true;
+}
+
+PostSet &postStoreBeginWrite() {
+    uint32_t state = storeState.fetch_and(~(uint32_t)STORE_PENDING, std::memory_order_acq_rel);
+    return arena->sets[(state & STORE_FRONT) ^ 1];
+}
+
+void postStorePublish() {
+    uint32_t state = storeState.load(std::memory_order_relaxed);
+    arena->sets[(state & STORE_FRONT) ^ 1].generation = nextGeneration++;
+    storeState.fetch_or(STORE_PENDING, std::memory_order_release);
+}
+
+bool postStoreAcquire() {
+    uint32_t state = storeState.load(std::memory_order_acquire);
+    while (state & STORE_PENDING) {
+        uint32_t next = (state & STORE_FRONT) ^ 1;
+        if (storeState.compare_exchange_weak(state, next, std::memory_order_acq_rel)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+const PostSet &postStoreFront() {
+    return arena->sets[storeState.load(std::memory_order_acquire) & STORE_FRONT];
+}
+
+static bool handleInUse(int index) {
+    for (int i = 0; i < topCount; i++) {
+        if (arena->slots[topSlots[i]].author == index) return true;
+    }
+    return false;
+}
+
+// Returns the entry for handle, reusing the least recently used free entry for new ones
+static uint16_t internHandle(const char *handle) {
+    uint32_t hash = 2166136261u;  // FNV-1a
+    for (const char *c = handle; *c; c++) {
+        hash ^= (uint8_t)*c;
+        hash *= 16777619u;
+    }
+    handleClock++;
+
+    int victim = -1;
+    for (int i = 0; i < POST_HANDLE_SLOTS; i++) {
+        HandleEntry &entry = arena->handles[i];
+        if (entry.hash == hash && strcmp(entry.author + 1, handle) == 0) {
+            entry.lastUsed = handleClock;
+            return i;
+        }
+        if (handleInUse(i)) continue;
+        if (victim < 0 || entry.lastUsed < arena->handles[victim].lastUsed) victim = i;
+    }
+
+    // There are more entries than top slots, so a victim always exists
+    HandleEntry &entry = arena->handles[victim];
+    entry.hash = hash;
+    entry.lastUsed = handleClock;
+    entry.author[0] = '@';
+    copyUtf8(entry.author + 1, sizeof(entry.author) - 1, handle);
+    return victim;
+}
+
+bool postStoreOffer(const char *handle, const char *text, int64_t createdAtMs, uint32_t avatarKey) {
+    // Restored from the snapshot and fetched again: it's in the top already
+    for (int i = 0; i < topCount; i++) {
+        const PostSlot &post = arena->slots[topSlots[i]];
+        if (post.createdAtMs == createdAtMs && strcmp(arena->handles[post.author].author + 1, handle) == 0) return true;
+    }
+
+    int pos = topCount;
+    while (pos > 0 && createdAtMs > arena->slots[topSlots[pos - 1]].createdAtMs) {
+        pos--;
+    }
+    if (pos >= DISPLAY_POST_COUNT) return false;
+
+    // Reuse the slot of the post that drops out, or the next unused one
+    uint8_t slot = topCount < DISPLAY_POST_COUNT ? topCount : topSlots[DISPLAY_POST_COUNT - 1];
+    int last = topCount < DISPLAY_POST_COUNT ? topCount : DISPLAY_POST_COUNT - 1;
+    for (int i = last; i > pos; i--) {
+        topSlots[i] = topSlots[i - 1];
+    }
+    topSlots[pos] = slot;
+    if (topCount < DISPLAY_POST_COUNT) topCount++;
+
+    PostSlot &post = arena->slots[slot];
+    post.createdAtMs = createdAtMs;
+    post.avatarKey = avatarKey;
+    post.author = NO_HANDLE;  // So the old author can be evicted
+    post.author = internHandle(handle);
+    layoutPostText(post.text, sizeof(post.text), text, post.layout);
+    return true;
+}
+
+int postStorePublishTop() {
+    PostSet &posts = postStoreBeginWrite();
+    for (int i = 0; i < topCount; i++) {
+        const PostSlot &post = arena->slots[topSlots[i]];
+        strcpy(posts.authors[i], arena->handles[post.author].author);
+        strcpy(posts.texts[i], post.text);
+        posts.layouts[i] = post.layout;
+        posts.avatarKeys[i] = post.avatarKey;
+    }
+    posts.count = topCount;
+    postStorePublish();
+    return topCount;
+}
+
+void postStoreClearTop() {
+    topCount = 0;
+}
+
+void postStoreRestoreTop(const PostSet &posts, const int64_t *createdAtMs) {
+    topCount = 0;
+    for (int i = 0; i < posts.count && i < DISPLAY_POST_COUNT; i++) {
+        PostSlot &post = arena->slots[i];
+        post.createdAtMs = createdAtMs[i];
+        post.avatarKey = posts.avatarKeys[i];
+        post.layout = posts.layouts[i];
+        strcpy(post.text, posts.texts[i]);
+        post.author = NO_HANDLE;
+        topSlots[i] = i;
+        topCount++;
+        const char *author = posts.authors[i];
+        post.author = internHandle(author[0] == '@' ? author + 1 : author);
+    }
+}
+
+int postStoreTopCount() {
+    return topCount;
+}
+
+PostView postStoreTopPost(int index) {
+    const PostSlot &post = arena->slots[topSlots[index]];
+    PostView view = {arena->handles[post.author].author, post.text, post.layout, post.avatarKey, post.createdAtMs};
+    return view;
+}
+
+// Parses exactly count digits
+static bool parseDigits(const char *&p, int count, int &value) {
+    value = 0;
+    for (int i = 0; i < count; i++, p++) {
+        if (*p < '0' || *p > '9') return false;
+        value = value * 10 + (*p - '0');
+    }
+    return true;
+}
+
+// Days since 1970-01-01 in the proleptic Gregorian calendar
+static int64_t daysFromCivil(int year, int month, int day) {
+    year -= month <= 2;
+    int era = (year >= 0 ? year : year - 399) / 400;
+    int yearOfEra = year - era * 400;
+    int dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return (int64_t)era * 146097 + dayOfEra - 719468;
+}
+
+int64_t parseIsoTimestamp(const char *text) {
+    const char *p = text;
+    int year, month, day, hour, minute, second;
+    if (!parseDigits(p, 4, year) || *p++ != '-' ||
+        !parseDigits(p, 2, month) || *p++ != '-' ||
+        !parseDigits(p, 2, day)) {
+        return 0;
+    }
+    if (*p != 'T' && *p != 't' && *p != ' ') return 0;
+    p++;
+    if (!parseDigits(p, 2, hour) || *p++ != ':' ||
+        !parseDigits(p, 2, minute) || *p++ != ':' ||
+        !parseDigits(p, 2, second)) {
+        return 0;
+    }
+    if (month < 1 || month > 12 || day < 1 || day > 31 || hour > 23 || minute > 59 || second > 60) {
+        return 0;
+    }
+
+    // Fraction: keep milliseconds, ignore finer digits
+    int fractionMs = 0;
+    if (*p == '.') {
+        p++;
+        int scale = 100;
+        while (*p >= '0' && *p <= '9') {
+            fractionMs += (*p - '0') * scale;
+            scale /= 10;
+            p++;
+        }
+    }
+
+    // Zone: Z, +hh:mm or -hh:mm; none is taken as UTC
+    int offsetMinutes = 0;
+    if (*p == '+' || *p == '-') {
+        int sign = *p++ == '-' ? -1 : 1;
+        int offsetHours, offsetMins;
+        if (!parseDigits(p, 2, offsetHours)) return 0;
+        if (*p == ':') p++;
+        if (!parseDigits(p, 2, offsetMins)) return 0;
+        offsetMinutes = sign * (offsetHours * 60 + offsetMins);
+    }
+
+    int64_t seconds = daysFromCivil(year, month, day) * 86400 + hour * 3600 + minute * 60 + second;
+    seconds -= offsetMinutes * 60;
+    return seconds * 1000 + fractionMs;
+}
+
+size_t copyUtf8(char *dest, size_t size, const char *src) {
+    if (size == 0) return 0;
+    size_t length = strnlen(src, size);
+    if (length >= size) {
+        // Cut before the character that doesn't fit
+        length = size - 1;
+        while (length > 0 && ((uint8_t)src[length] & 0xC0) == 0x80) length--;
+    }
+    memcpy(dest, src, length);
+    dest[length] = '\0';
+    return length;
+}
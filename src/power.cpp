@@ -0,0 +1,213 @@
+#include "power.h"
+#include <lvgl.h>
+#include <esp_pm.h>
+#include <esp_sleep.h>
+#include <driver/gpio.h>
+#include <driver/ledc.h>
+#include "bluesky.h"
+#include "buttons.h"
+#include "display.h"
+#include "wifi_manager.h"
+
+static TaskHandle_t renderTask = NULL;
+static bool lightSleep = false;
+static bool dfsEnabled = false;
+static esp_pm_lock_handle_t serialLock = NULL;  // No light sleep while USB serial is attached
+static bool serialLockHeld = false;
+
+static PowerStats total;
+static PowerStats interval;
+static uint32_t awakeSince = 0;  // micros() when the last sleep ended
+static uint32_t lastFrames = 0;
+static unsigned long lastReport = 0;
+
+static const uint16_t stateMa[POWER_STATE_COUNT] = {
+    POWER_MA_RENDER, POWER_MA_AWAKE, POWER_MA_NETWORK, POWER_MA_LIGHT_SLEEP
+};
+static const char *stateNames[POWER_STATE_COUNT] = {"render", "awake", "network", "sleep"};
+
+static bool networkBusy() {
+    return feedWorkerBusy() || wifiState() == WIFI_STATE_CONNECTING;
+}
+
+static void account(PowerState state, uint32_t us) {
+    uint32_t ma = stateMa[state];
+    if (state == POWER_STATE_SLEEP && !lightSleep) ma = POWER_MA_IDLE;
+    ma += (uint32_t)POWER_MA_BACKLIGHT * ledcRead(POWER_BACKLIGHT_CHANNEL) / 255;
+
+    total.stateUs[state] += us;
+    interval.stateUs[state] += us;
+    total.chargeMaUs += (uint64_t)ma * us;
+    interval.chargeMaUs += (uint64_t)ma * us;
+}
+
+// The backlight PWM runs off APB, which stops in light sleep. Move its timer to the
+// internal 8 MHz oscillator and keep that powered, so the panel stays lit.
+static void keepBacklightInSleep() {
+    ledc_timer_config_t timer = {};
+    timer.speed_mode = LEDC_LOW_SPEED_MODE;
+    timer.duty_resolution = LEDC_TIMER_8_BIT;  // As set up in main.cpp
+    timer.timer_num = (ledc_timer_t)((POWER_BACKLIGHT_CHANNEL / 2) % 4);  // Arduino's channel to timer mapping
+    timer.freq_hz = ledcReadFreq(POWER_BACKLIGHT_CHANNEL);
+    timer.clk_cfg = LEDC_USE_RTC8M_CLK;
+    ledc_timer_config(&timer);
+    esp_sleep_pd_config(ESP_PD_DOMAIN_RTC8M, ESP_PD_OPTION_ON);
+}
+
+void powerBegin() {
+    renderTask = xTaskGetCurrentTaskHandle();
+    awakeSince = micros();
+    lastReport = millis();
+
+    esp_pm_config_esp32s3_t config = {};
+    config.max_freq_mhz = POWER_MAX_CPU_MHZ;
+    config.min_freq_mhz = POWER_MIN_CPU_MHZ;
+    config.light_sleep_enable = POWER_LIGHT_SLEEP;
+    esp_err_t err = esp_pm_configure(&config);
+    if (err != ESP_OK && config.light_sleep_enable) {
+        Serial.println("Power: light sleep not supported by this SDK config, using DFS only");
+        config.light_sleep_enable = false;
+        err = esp_pm_configure(&config);
+    }
+    dfsEnabled = err == ESP_OK;
+    lightSleep = dfsEnabled && config.light_sleep_enable;
+
+    if (lightSleep) {
+        keepBacklightInSleep();
+        esp_sleep_enable_gpio_wakeup();  // Buttons arm their pins in addButton()
+        esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "serial", &serialLock);
+    }
+
+    Serial.print("Power: ");
+    if (dfsEnabled) {
+        Serial.print(POWER_MIN_CPU_MHZ);
+        Serial.print("-");
+        Serial.print(POWER_MAX_CPU_MHZ);
+        Serial.print(" MHz, light sleep ");
+        Serial.println(lightSleep ? "on" : "off");
+    } else {
+        Serial.print("frequency scaling unavailable (");
+        Serial.print(esp_err_to_name(err));
+        Serial.println("), render loop sleeps only");
+    }
+}
+
+void powerWake() {
+    if (renderTask != NULL) xTaskNotifyGive(renderTask);
+}
+
+void powerWakeFromISR(BaseType_t *woken) {
+    if (renderTask != NULL) vTaskNotifyGiveFromISR(renderTask, woken);
+}
+
+// Milliseconds until the next running LVGL timer is due
+static uint32_t nextLvglDeadline() {
+    uint32_t next = POWER_MAX_SLEEP_MS;
+    for (lv_timer_t *timer = lv_timer_get_next(NULL); timer != NULL; timer = lv_timer_get_next(timer)) {
+        if (timer->paused) continue;
+        uint32_t elapsed = lv_tick_elaps(timer->last_run);
+        uint32_t remaining = elapsed < timer->period ? timer->period - elapsed : 0;
+        if (remaining < next) next = remaining;
+    }
+    return next;
+}
+
+static void holdAwakeForSerial() {
+    if (serialLock == NULL) return;
+    bool attached = (bool)Serial;
+    if (attached == serialLockHeld) return;
+    if (attached) {
+        esp_pm_lock_acquire(serialLock);
+    } else {
+        esp_pm_lock_release(serialLock);
+    }
+    serialLockHeld = attached;
+}
+
+void powerIdle() {
+    uint32_t now = micros();
+    uint32_t frames = displayStats().frames;
+    account(frames != lastFrames ? POWER_STATE_RENDER : POWER_STATE_AWAKE, now - awakeSince);
+    lastFrames = frames;
+
+    // Nothing dirty and nothing animating: stop LVGL waking us every refresh period
+    lv_disp_t *disp = lv_disp_get_default();
+    bool refreshPaused = disp != NULL && disp->inv_p == 0 && lv_anim_count_running() == 0;
+    if (refreshPaused) lv_timer_pause(disp->refr_timer);
+
+    uint32_t sleepMs = min(nextLvglDeadline(), buttonsNextDeadlineMs());
+    holdAwakeForSerial();
+
+    if (sleepMs == 0) sleepMs = 1;  // Always yield, so core 1's idle task runs
+
+    bool network = networkBusy();
+    if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(sleepMs)) > 0) {
+        total.eventWakeups++;
+        interval.eventWakeups++;
+    } else {
+        total.timerWakeups++;
+        interval.timerWakeups++;
+    }
+    awakeSince = micros();
+    network = network || networkBusy();
+    account(network ? POWER_STATE_NETWORK : POWER_STATE_SLEEP, awakeSince - now);
+
+    // Anything invalidated from here on gets drawn on the next lv_timer_handler()
+    if (refreshPaused) lv_timer_resume(disp->refr_timer);
+
+    if (millis() - lastReport >= POWER_REPORT_INTERVAL) {
+        printPowerReport();
+        memset(&interval, 0, sizeof(interval));
+        lastReport = millis();
+    }
+}
+
+bool powerLightSleepEnabled() {
+    return lightSleep;
+}
+
+const PowerStats &powerStats() {
+    return total;
+}
+
+uint32_t powerEstimatedMa(const PowerStats &stats) {
+    uint64_t us = 0;
+    for (int i = 0; i < POWER_STATE_COUNT; i++) us += stats.stateUs[i];
+    return us > 0 ? (uint32_t)(stats.chargeMaUs / us) : 0;
+}
+
+static void printStates(const PowerStats &stats) {
+    uint64_t us = 0;
+    for (int i = 0; i < POWER_STATE_COUNT; i++) us += stats.stateUs[i];
+    if (us == 0) us = 1;
+    for (int i = 0; i < POWER_STATE_COUNT; i++) {
+        Serial.print(i == 0 ? "" : ", ");
+        Serial.print(stateNames[i]);
+        Serial.print(" ");
+        Serial.print((float)(stats.stateUs[i] * 100.0 / us), 1);
+        Serial.print("%");
+    }
+}
+
+// Last interval, then since boot with the battery life it works out to
+void printPowerReport() {
+    Serial.print("Power: ");
+    printStates(interval);
+    Serial.print(", ");
+    Serial.print(interval.eventWakeups + interval.timerWakeups);
+    Serial.print(" wakeups, ~");
+    Serial.print(powerEstimatedMa(interval));
+    Serial.println(" mA");
+
+    uint32_t ma = powerEstimatedMa(total);
+    Serial.print("  since boot: ");
+    printStates(total);
+    Serial.print(", ~");
+    Serial.print(ma);
+    Serial.print(" mA, ");
+    Serial.print(ma > 0 ? (float)POWER_BATTERY_MAH / ma : 0.0f, 1);
+    Serial.print(" h on ");
+    Serial.print(POWER_BATTERY_MAH);
+    Serial.print(" mAh, light sleep ");
+    Serial.println(lightSleep ? (serialLockHeld ? "held off by USB serial" : "on") : "off");
+}
@@ -0,0 +1,532 @@
+#include "screens.h"
+#include <Arduino.h>
+#include "qrcode.h"
+#include "display.h"
+#include "telemetry.h"
+#include "avatars.h"
+#include "fonts.h"
+#include "lvgl_pool.h"
+
+#define QR_MAX_VERSION 10  // Up to ~270 characters at ECC_LOW
+#define QR_QUIET_ZONE 2    // White border, in modules
+
+// Prebuilt screens and the labels that change when posts arrive
+static lv_obj_t *screens[SCREEN_COUNT];
+static lv_obj_t *postAvatars[DISPLAY_POST_COUNT];
+static lv_obj_t *postAuthorLabels[DISPLAY_POST_COUNT];
+static lv_obj_t *postTextLabels[DISPLAY_POST_COUNT];
+static lv_obj_t *postEmptyLabels[DISPLAY_POST_COUNT];
+
+// Pre-rendered frames for the screens whose content is fixed at boot
+static const bool staticScreens[SCREEN_COUNT] = {true, true, true, false, false, false, true};
+static lv_color_t *staticFrames[SCREEN_COUNT];
+static bool staticFrameReady[SCREEN_COUNT];
+static uint32_t staticRenderUs[SCREEN_COUNT];
+
+// Page slides of long posts on the post screen that's showing
+static lv_timer_t *pageTimer = NULL;
+static lv_color_t *pageFrame = NULL;           // The incoming page, rendered for the slide
+static char pageText[POST_TEXT_MAX];
+static uint8_t postPages[DISPLAY_POST_COUNT];  // Page each post's label holds
+static int pagePost = -1;                      // Post screen that's showing, -1 on the others
+static int slideX = -1;                        // Columns of the incoming page on the panel, -1 between slides
+static uint32_t slideStartUs = 0;
+static DisplayStats slideStartStats;
+
+// Creates a screen with a full-size content panel in the given color
+static lv_obj_t *createScreen(int index, uint32_t color) {
+    if (screens[index] != NULL) {
+        lv_obj_del(screens[index]);  // Rebuilding (only the host benchmark does this)
+    }
+    screens[index] = lv_obj_create(NULL);
+
+    lv_obj_t *panel = lv_obj_create(screens[index]);
+    lv_obj_set_size(panel, SCREEN_WIDTH, SCREEN_HEIGHT);
+    lv_obj_center(panel);
+    lv_obj_clear_flag(panel, LV_OBJ_FLAG_SCROLLABLE);
+    lv_obj_set_style_bg_color(panel, lv_color_hex(color), 0);
+    return panel;
+}
+
+static lv_obj_t *createLabel(lv_obj_t *parent, const char *text, const lv_font_t *font) {
+    lv_obj_t *label = lv_label_create(parent);
+    lv_label_set_text(label, text);
+    lv_obj_set_style_text_color(label, lv_color_hex(0xFFFFFF), 0);
+    lv_obj_set_style_text_font(label, font, 0);
+    return label;
+}
+
+static void buildWelcomeScreen() {
+    lv_obj_t *panel = createScreen(0, 0x1E3A8A);
+
+    // "Howdy" - large (same size as Trevor)
+    lv_obj_t *main_label = createLabel(panel, "Howdy", &BADGE_FONT(48));
+    lv_obj_align(main_label, LV_ALIGN_CENTER, 0, -20);
+
+    // "My Name Is" - smaller below
+    lv_obj_t *sub_label = createLabel(panel, "My Name Is", &BADGE_FONT(28));
+    lv_obj_align(sub_label, LV_ALIGN_CENTER, 0, 30);
+}
+
+static void buildNameScreen() {
+    lv_obj_t *panel = createScreen(1, 0x059669);
+
+    // "Trevor" - large
+    lv_obj_t *main_label = createLabel(panel, "Trevor", &BADGE_FONT(48));
+    lv_obj_align(main_label, LV_ALIGN_CENTER, 0, -15);
+
+    // "Johnson" - smaller below, letter-spaced to match width
+    lv_obj_t *sub_label = createLabel(panel, "Johnson", &BADGE_FONT(28));
+    lv_obj_set_style_text_letter_space(sub_label, 8, 0);  // Spread out to match Trevor width
+    lv_obj_align(sub_label, LV_ALIGN_CENTER, 0, 30);
+}
+
+// Encodes BADGE_PROFILE_URL once into a 1-bit indexed image at its final size
+// (about 2KB instead of a 28.8KB RGB565 canvas). Returns NULL if the URL doesn't fit.
+static const lv_img_dsc_t *buildQRImage(lv_coord_t maxSize) {
+    static lv_img_dsc_t qrImage;
+    telemetryBegin(TELEMETRY_QR);
+
+    // Smallest QR version that holds the URL
+    QRCode qrcode;
+    uint8_t qrcodeData[qrcode_getBufferSize(QR_MAX_VERSION)];
+    uint8_t version = 3;
+    while (qrcode_initText(&qrcode, qrcodeData, version, ECC_LOW, BADGE_PROFILE_URL) != 0) {
+        if (++version > QR_MAX_VERSION) {
+            Serial.println("ERROR: BADGE_PROFILE_URL is too long for a QR code");
+            telemetryEnd(TELEMETRY_QR);
+            return NULL;
+        }
+    }
+
+    // Whole pixels per module, with a white quiet zone around the code
+    int modules = qrcode.size + 2 * QR_QUIET_ZONE;
+    int scale = maxSize / modules;
+    if (scale < 1) scale = 1;
+    int size = modules * scale;
+
+    uint32_t dataSize = LV_IMG_BUF_SIZE_INDEXED_1BIT(size, size);
+    free((void *)qrImage.data);
+    qrImage.data = NULL;
+    uint8_t *data = (uint8_t *)malloc(dataSize);
+    telemetrySample(TELEMETRY_QR);
+    if (data == NULL) {
+        telemetryEnd(TELEMETRY_QR);
+        return NULL;
+    }
+    memset(data, 0, dataSize);
+
+    qrImage.header.always_zero = 0;
+    qrImage.header.cf = LV_IMG_CF_INDEXED_1BIT;
+    qrImage.header.w = size;
+    qrImage.header.h = size;
+    qrImage.data_size = dataSize;
+    qrImage.data = data;
+    lv_img_buf_set_palette(&qrImage, 0, lv_color_hex(0xFFFFFF));
+    lv_img_buf_set_palette(&qrImage, 1, lv_color_hex(0x000000));
+
+    // Pixel bits follow the 2-entry palette, MSB first, rows padded to whole bytes
+    uint8_t *bits = data + 2 * sizeof(lv_color32_t);
+    int stride = (size + 7) / 8;
+    for (int py = 0; py < size; py++) {
+        int y = py / scale - QR_QUIET_ZONE;
+        for (int px = 0; px < size; px++) {
+            int x = px / scale - QR_QUIET_ZONE;
+            if (x >= 0 && y >= 0 && x < qrcode.size && y < qrcode.size && qrcode_getModule(&qrcode, x, y)) {
+                bits[py * stride + px / 8] |= 0x80 >> (px % 8);
+            }
+        }
+    }
+
+    Serial.print("QR code: version ");
+    Serial.print(version);
+    Serial.print(", ");
+    Serial.print(size);
+    Serial.print("px, ");
+    Serial.print(dataSize);
+    Serial.println(" bytes");
+    telemetryEnd(TELEMETRY_QR);
+    return &qrImage;
+}
+
+static void buildQRScreen() {
+    lv_obj_t *panel = createScreen(2, 0x1E3A8A);  // Same blue as Howdy screen
+
+    // "Find Me Here" text on left side
+    lv_obj_t *main_label = createLabel(panel, "Find\nMe\nHere", &BADGE_FONT(32));
+    lv_obj_set_style_text_align(main_label, LV_TEXT_ALIGN_CENTER, 0);
+    lv_obj_align(main_label, LV_ALIGN_LEFT_MID, 20, 0);
+
+    // QR code sized to fill the panel's content height
+    lv_obj_update_layout(panel);
+    const lv_img_dsc_t *qrImage = buildQRImage(lv_obj_get_content_height(panel));
+    if (qrImage != NULL) {
+        lv_obj_t *qr = lv_img_create(panel);
+        lv_img_set_src(qr, qrImage);
+        lv_obj_align(qr, LV_ALIGN_RIGHT_MID, -20, 0);  // Position on right side
+    }
+}
+
+static void buildPostScreen(int postIndex) {
+    lv_obj_t *panel = createScreen(3 + postIndex, 0xDC2626);  // Same red as CTA screen
+
+    // Author avatar, hidden until its thumbnail is decoded
+    lv_obj_t *avatar = lv_img_create(panel);
+    lv_obj_set_size(avatar, AVATAR_SIZE, AVATAR_SIZE);
+    lv_obj_align(avatar, LV_ALIGN_TOP_LEFT, 0, 0);
+    lv_obj_add_flag(avatar, LV_OBJ_FLAG_HIDDEN);
+    postAvatars[postIndex] = avatar;
+
+    // Author handle - Montserrat 22
+    lv_obj_t *author = createLabel(panel, "", &BADGE_FONT(22));
+    lv_obj_set_style_text_color(author, lv_color_hex(0x60A5FA), 0);
+    lv_obj_align(author, LV_ALIGN_TOP_LEFT, 0, 0);  // Move all the way to top-left corner
+    postAuthorLabels[postIndex] = author;
+
+    // Post text - font size comes from the post's layout. The text arrives with its
+    // line breaks in place, so the fixed-size label never has to wrap or grow.
+    lv_obj_t *text = createLabel(panel, "", postLayoutFont(22));
+    lv_obj_set_size(text, POST_TEXT_WIDTH, POST_TEXT_HEIGHT);
+    lv_label_set_long_mode(text, LV_LABEL_LONG_CLIP);
+    lv_obj_set_style_text_line_space(text, POST_TEXT_LINE_SPACE, 0);
+    lv_obj_align(text, LV_ALIGN_TOP_LEFT, 0, 22);  // Tighter spacing - closer to username
+    postTextLabels[postIndex] = text;
+
+    // Placeholder until there's a post for this slot
+    lv_obj_t *empty = createLabel(panel, "No posts yet!\nBe the first to post\n#seagl2025\non Bluesky", &BADGE_FONT(20));
+    lv_obj_set_style_text_align(empty, LV_TEXT_ALIGN_CENTER, 0);
+    lv_obj_align(empty, LV_ALIGN_CENTER, 0, 0);
+    postEmptyLabels[postIndex] = empty;
+}
+
+static void buildCTAScreen() {
+    lv_obj_t *panel = createScreen(6, 0xDC2626);
+
+    lv_obj_t *main_label = createLabel(panel, "#SeaGL2025\non BlueSky", &BADGE_FONT(32));
+    lv_obj_set_style_text_align(main_label, LV_TEXT_ALIGN_CENTER, 0);
+    lv_obj_align(main_label, LV_ALIGN_CENTER, 0, -20);
+
+    lv_obj_t *sub_label = createLabel(panel, "Join the conversation!", &BADGE_FONT(20));
+    lv_obj_set_style_text_align(sub_label, LV_TEXT_ALIGN_CENTER, 0);
+    lv_obj_align(sub_label, LV_ALIGN_CENTER, 0, 40);
+}
+
+static void printLvglMemory() {
+    lv_mem_monitor_t mon;
+    lvglPoolMonitor(&mon);
+    Serial.print("LVGL heap: ");
+    Serial.print(mon.total_size - mon.free_size);
+    Serial.print(" used, ");
+    Serial.print(mon.free_biggest_size);
+    Serial.print(" largest free, ");
+    Serial.print(mon.frag_pct);
+    Serial.println("% fragmented");
+}
+
+// Shows the post's avatar if it's decoded yet, with the handle next to it
+static void updatePostAvatar(int postIndex, const PostSet &posts) {
+    uint32_t key = postIndex < posts.count ? posts.avatarKeys[postIndex] : 0;
+    const lv_img_dsc_t *image = avatarFor(key, postIndex);
+    if (image != NULL) {
+        lv_img_cache_invalidate_src(image);  // Cache slots are reused for other authors
+        lv_img_set_src(postAvatars[postIndex], image);
+        lv_obj_clear_flag(postAvatars[postIndex], LV_OBJ_FLAG_HIDDEN);
+        lv_obj_align(postAuthorLabels[postIndex], LV_ALIGN_TOP_LEFT, AVATAR_SIZE + 6, 0);
+    } else {
+        lv_obj_add_flag(postAvatars[postIndex], LV_OBJ_FLAG_HIDDEN);
+        lv_obj_align(postAuthorLabels[postIndex], LV_ALIGN_TOP_LEFT, 0, 0);
+    }
+}
+
+// Puts one page of the post's text in its label
+static void setPostPage(int postIndex, const PostSet &posts, int page) {
+    const PostLayout &layout = posts.layouts[postIndex];
+    if (layout.pages > 1) {
+        postLayoutPage(pageText, sizeof(pageText), posts.texts[postIndex], layout, page);
+        lv_label_set_text(postTextLabels[postIndex], pageText);
+    } else {
+        lv_label_set_text(postTextLabels[postIndex], posts.texts[postIndex]);
+    }
+    postPages[postIndex] = page;
+}
+
+static void updatePostScreen(int postIndex, const PostSet &posts) {
+    updatePostAvatar(postIndex, posts);
+    if (postIndex < posts.count) {
+        lv_label_set_text(postAuthorLabels[postIndex], posts.authors[postIndex]);
+        lv_obj_set_style_text_font(postTextLabels[postIndex], postLayoutFont(posts.layouts[postIndex].fontSize), 0);
+        setPostPage(postIndex, posts, 0);
+        lv_obj_clear_flag(postAuthorLabels[postIndex], LV_OBJ_FLAG_HIDDEN);
+        lv_obj_clear_flag(postTextLabels[postIndex], LV_OBJ_FLAG_HIDDEN);
+        lv_obj_add_flag(postEmptyLabels[postIndex], LV_OBJ_FLAG_HIDDEN);
+    } else {
+        lv_obj_add_flag(postAuthorLabels[postIndex], LV_OBJ_FLAG_HIDDEN);
+        lv_obj_add_flag(postTextLabels[postIndex], LV_OBJ_FLAG_HIDDEN);
+        lv_obj_clear_flag(postEmptyLabels[postIndex], LV_OBJ_FLAG_HIDDEN);
+    }
+}
+
+void buildScreen(int screen) {
+    telemetryBegin(TELEMETRY_SCREEN_BUILD);
+    switch (screen) {
+        case 0: buildWelcomeScreen(); break;
+        case 1: buildNameScreen(); break;
+        case 2: buildQRScreen(); break;
+        case 3:
+        case 4:
+        case 5:
+            buildPostScreen(screen - 3);
+            updatePostScreen(screen - 3, postStoreFront());
+            break;
+        case 6: buildCTAScreen(); break;
+    }
+    telemetryEnd(TELEMETRY_SCREEN_BUILD);
+}
+
+// Renders a static screen into its frame with the same draw code LVGL uses for
+// the panel; without PSRAM the screen is simply drawn by LVGL when shown
+static bool prerenderScreen(int screen) {
+    if (!STATIC_SCREEN_BLIT || !staticScreens[screen]) return false;
+    if (staticFrames[screen] == NULL) staticFrames[screen] = allocFrame();
+    if (staticFrames[screen] == NULL) return false;
+
+    uint32_t start = micros();
+    lv_obj_update_layout(screens[screen]);
+    uint32_t size = SCREEN_WIDTH * SCREEN_HEIGHT * sizeof(lv_color_t);
+    lv_img_dsc_t snapshot;
+    staticFrameReady[screen] = lv_snapshot_buf_size_needed(screens[screen], LV_IMG_CF_TRUE_COLOR) == size &&
+                               lv_snapshot_take_to_buf(screens[screen], LV_IMG_CF_TRUE_COLOR, &snapshot,
+                                                       staticFrames[screen], size) == LV_RES_OK;
+    staticRenderUs[screen] = micros() - start;
+    return staticFrameReady[screen];
+}
+
+static void endPageSlide() {
+    lv_disp_enable_invalidation(lv_disp_get_default(), true);
+    slideX = -1;
+    lv_timer_set_period(pageTimer, POST_PAGE_DWELL_MS);
+
+    uint32_t us = micros() - slideStartUs;
+    if (us == 0) us = 1;
+    DisplayStats now = displayStats();
+    uint32_t steps = now.scrollSteps - slideStartStats.scrollSteps;
+    uint32_t bytes = now.scrollBytes - slideStartStats.scrollBytes;
+    Serial.print("Page ");
+    Serial.print(postPages[pagePost] + 1);
+    Serial.print("/");
+    Serial.print(postStoreFront().layouts[pagePost].pages);
+    Serial.print(" of post ");
+    Serial.print(pagePost + 1);
+    Serial.print(" slid in: ");
+    Serial.print(steps);
+    Serial.print(" steps, ");
+    Serial.print(bytes);
+    Serial.print(" bytes in ");
+    Serial.print(us / 1000);
+    Serial.print(" ms (");
+    Serial.print((uint32_t)((uint64_t)bytes * 1000 / us));
+    Serial.print(" KB/s, ");
+    Serial.print((uint32_t)((uint64_t)steps * 1000000 / us));
+    Serial.println(" steps/s)");
+}
+
+// Puts the rest of a slide on the panel at once, e.g. before the screen changes
+static void finishPageSlide() {
+    if (slideX < 0) return;
+    scrollFrameIn(pageFrame, slideX, SCREEN_WIDTH);
+    endPageSlide();
+}
+
+// Renders the next page and starts sliding it in; false if LVGL still has
+// something to draw, which would land on the scrolled panel
+static bool startPageSlide() {
+    lv_disp_t *disp = lv_disp_get_default();
+    if (disp->inv_p != 0 || lv_anim_count_running() > 0) return false;
+    if (pageFrame == NULL) pageFrame = allocFrame();
+
+    // Invalidation stays off until the slide ends, so LVGL leaves the panel alone
+    lv_disp_enable_invalidation(disp, false);
+    setPostPage(pagePost, postStoreFront(), postPages[pagePost] + 1);
+    lv_obj_t *screen = screens[3 + pagePost];
+    lv_obj_update_layout(screen);
+    uint32_t size = SCREEN_WIDTH * SCREEN_HEIGHT * sizeof(lv_color_t);
+    lv_img_dsc_t snapshot;
+    if (pageFrame == NULL || lv_snapshot_take_to_buf(screen, LV_IMG_CF_TRUE_COLOR, &snapshot, pageFrame, size) != LV_RES_OK) {
+        // No PSRAM for the frame: LVGL redraws the label with the new page instead
+        lv_disp_enable_invalidation(disp, true);
+        lv_obj_invalidate(postTextLabels[pagePost]);
+        lv_timer_set_period(pageTimer, POST_PAGE_DWELL_MS);
+        return true;
+    }
+
+    slideX = 0;
+    slideStartUs = micros();
+    slideStartStats = displayStats();
+    lv_timer_set_period(pageTimer, POST_PAGE_STEP_MS);
+    return true;
+}
+
+static void pageTimerCallback(lv_timer_t *timer) {
+    if (slideX >= 0) {
+        int toX = min(slideX + POST_PAGE_STEP_COLUMNS, SCREEN_WIDTH);
+        scrollFrameIn(pageFrame, slideX, toX);
+        slideX = toX;
+        if (slideX == SCREEN_WIDTH) endPageSlide();
+        return;
+    }
+
+    if (pagePost < 0 || postPages[pagePost] + 1 >= screenPages(3 + pagePost)) {
+        lv_timer_pause(timer);  // The last page stays up
+    } else if (!startPageSlide()) {
+        lv_timer_set_period(timer, POST_PAGE_STEP_MS);  // Try again shortly
+    }
+}
+
+// The post screen about to be shown starts on its first page
+static void startPostPages(int postIndex) {
+    if (postPages[postIndex] != 0) setPostPage(postIndex, postStoreFront(), 0);
+    pagePost = postIndex;
+    if (screenPages(3 + postIndex) > 1) {
+        lv_timer_set_period(pageTimer, POST_PAGE_DWELL_MS);
+        lv_timer_reset(pageTimer);
+        lv_timer_resume(pageTimer);
+    } else {
+        lv_timer_pause(pageTimer);
+    }
+}
+
+static void stopPostPages() {
+    finishPageSlide();
+    pagePost = -1;
+    lv_timer_pause(pageTimer);
+}
+
+void buildScreens() {
+    uint32_t start = micros();
+
+    for (int i = 0; i < SCREEN_COUNT; i++) {
+        buildScreen(i);
+    }
+
+    Serial.print("Built ");
+    Serial.print(SCREEN_COUNT);
+    Serial.print(" screens in ");
+    Serial.print(micros() - start);
+    Serial.println(" us");
+    printLvglMemory();
+
+    pageTimer = lv_timer_create(pageTimerCallback, POST_PAGE_DWELL_MS, NULL);
+    lv_timer_pause(pageTimer);
+
+    start = micros();
+    int prerendered = 0;
+    for (int i = 0; i < SCREEN_COUNT; i++) {
+        if (prerenderScreen(i)) prerendered++;
+    }
+    if (prerendered > 0) {
+        Serial.print("Pre-rendered ");
+        Serial.print(prerendered);
+        Serial.print(" static screens into ");
+        Serial.print(prerendered * SCREEN_WIDTH * SCREEN_HEIGHT * sizeof(lv_color_t) / 1024);
+        Serial.print(" KB of PSRAM in ");
+        Serial.print(micros() - start);
+        Serial.print(" us; render time saved per show:");
+        for (int i = 0; i < SCREEN_COUNT; i++) {
+            if (!staticFrameReady[i]) continue;
+            Serial.print(" ");
+            Serial.print(i);
+            Serial.print("=");
+            Serial.print(staticRenderUs[i]);
+            Serial.print("us");
+        }
+        Serial.println();
+    } else if (STATIC_SCREEN_BLIT) {
+        Serial.println("No PSRAM for pre-rendered screens, LVGL draws all of them");
+    }
+}
+
+// Makes a pre-rendered screen the active one without LVGL drawing it: with
+// invalidation off, loading it leaves nothing dirty, and the frame goes out as is
+static void blitScreen(int screen) {
+    lv_disp_t *disp = lv_disp_get_default();
+    lv_disp_enable_invalidation(disp, false);
+    lv_scr_load(screens[screen]);
+    lv_disp_enable_invalidation(disp, true);
+    blitFrame(staticFrames[screen]);
+}
+
+void showScreen(int screen) {
+    if (screen < 0 || screen >= SCREEN_COUNT) return;
+
+    Serial.print("Showing screen: ");
+    Serial.println(screen);
+
+    static bool firstLoad = true;
+    if (!firstLoad && lv_scr_act() == screens[screen]) return;
+
+    // The panel has to be unscrolled before the next screen goes out
+    stopPostPages();
+    if (screen >= 3 && screen < 3 + DISPLAY_POST_COUNT) startPostPages(screen - 3);
+
+    uint32_t start = micros();
+    bool blit = staticFrameReady[screen];
+    if (firstLoad) {
+        // Replace LVGL's default screen without animating in from a blank one
+        lv_obj_t *defaultScreen = lv_scr_act();
+        if (blit) {
+            blitScreen(screen);
+        } else {
+            lv_scr_load(screens[screen]);
+        }
+        lv_obj_del(defaultScreen);
+        firstLoad = false;
+    } else if (blit) {
+        blitScreen(screen);
+    } else if (TRANSITION_DURATION == 0) {
+        lv_scr_load(screens[screen]);
+    } else {
+        lv_scr_load_anim(screens[screen], SCREEN_TRANSITION_ANIM, TRANSITION_DURATION, 0, false);
+    }
+
+    Serial.print("Switch took ");
+    Serial.print(micros() - start);
+    Serial.println(blit ? " us (blit)" : " us");
+    printLvglMemory();
+}
+
+void updatePostScreens(const PostSet &posts) {
+    finishPageSlide();
+    for (int i = 0; i < DISPLAY_POST_COUNT; i++) {
+        updatePostScreen(i, posts);
+    }
+    if (pagePost >= 0) startPostPages(pagePost);  // New posts start over on their first page
+}
+
+void updatePostAvatars(const PostSet &posts) {
+    finishPageSlide();
+    for (int i = 0; i < DISPLAY_POST_COUNT; i++) {
+        updatePostAvatar(i, posts);
+    }
+}
+
+lv_obj_t *screenObject(int screen) {
+    if (screen < 0 || screen >= SCREEN_COUNT) return NULL;
+    return screens[screen];
+}
+
+const lv_color_t *staticScreenFrame(int screen) {
+    if (screen < 0 || screen >= SCREEN_COUNT || !staticFrameReady[screen]) return NULL;
+    return staticFrames[screen];
+}
+
+uint32_t staticScreenRenderUs(int screen) {
+    if (screen < 0 || screen >= SCREEN_COUNT) return 0;
+    return staticRenderUs[screen];
+}
+
+int screenPages(int screen) {
+    int postIndex = screen - 3;
+    if (postIndex < 0 || postIndex >= DISPLAY_POST_COUNT) return 1;
+    const PostSet &posts = postStoreFront();
+    return postIndex < posts.count && posts.layouts[postIndex].pages > 1 ? posts.layouts[postIndex].pages : 1;
+}
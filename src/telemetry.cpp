@@ -0,0 +1,162 @@
+#include "telemetry.h"
+#include <esp_heap_caps.h>
+#include <lvgl.h>
+#include "lvgl_pool.h"
+
+#define TELEMETRY_HISTORY 16  // Samples kept for trend output, one per report interval
+
+struct ScopeStats {
+    uint32_t startFree;
+    uint32_t minFree;
+    uint32_t lastUsed;
+    uint32_t peakUsed;
+    uint32_t count;
+    bool active;
+};
+
+static const char *scopeNames[TELEMETRY_SCOPE_COUNT] = {"fetch", "parse", "build", "qr"};
+static ScopeStats scopes[TELEMETRY_SCOPE_COUNT];
+static MemorySample history[TELEMETRY_HISTORY];
+static int historyCount = 0;
+static int historyNext = 0;
+static uint32_t minInternalLargest = UINT32_MAX;  // Worst internal fragmentation since boot
+static unsigned long lastReport = 0;
+
+MemorySample sampleMemory() {
+    MemorySample sample;
+    sample.uptimeSec = millis() / 1000;
+    sample.internalFree = heap_caps_get_free_size(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    sample.internalLargest = heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    sample.dmaFree = heap_caps_get_free_size(MALLOC_CAP_DMA);
+    sample.dmaLargest = heap_caps_get_largest_free_block(MALLOC_CAP_DMA);
+    sample.psramFree = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+    sample.psramLargest = heap_caps_get_largest_free_block(MALLOC_CAP_SPIRAM);
+
+    lv_mem_monitor_t mon;
+    lvglPoolMonitor(&mon);
+    sample.lvglUsed = mon.total_size - mon.free_size;
+    sample.lvglLargest = mon.free_biggest_size;
+    sample.lvglFragPct = mon.frag_pct;
+
+    if (sample.internalLargest < minInternalLargest) minInternalLargest = sample.internalLargest;
+    return sample;
+}
+
+void telemetryBegin(TelemetryScope scope) {
+    ScopeStats &s = scopes[scope];
+    s.startFree = heap_caps_get_free_size(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    s.minFree = s.startFree;
+    s.active = true;
+}
+
+void telemetrySample(TelemetryScope scope) {
+    ScopeStats &s = scopes[scope];
+    if (!s.active) return;
+    uint32_t freeNow = heap_caps_get_free_size(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (freeNow < s.minFree) s.minFree = freeNow;
+}
+
+void telemetryEnd(TelemetryScope scope) {
+    ScopeStats &s = scopes[scope];
+    if (!s.active) return;
+    telemetrySample(scope);
+    s.active = false;
+    s.lastUsed = s.startFree > s.minFree ? s.startFree - s.minFree : 0;
+    if (s.lastUsed > s.peakUsed) s.peakUsed = s.lastUsed;
+    s.count++;
+}
+
+// Percentage of free memory that isn't in the largest block
+static uint32_t fragPct(uint32_t freeBytes, uint32_t largest) {
+    if (freeBytes == 0) return 0;
+    return 100 - (uint32_t)((uint64_t)largest * 100 / freeBytes);
+}
+
+static void printSampleLine(const MemorySample &m) {
+    Serial.print("MEM t=");
+    Serial.print(m.uptimeSec);
+    Serial.print("s int ");
+    Serial.print(m.internalFree / 1024);
+    Serial.print("k/");
+    Serial.print(m.internalLargest / 1024);
+    Serial.print("k ");
+    Serial.print(fragPct(m.internalFree, m.internalLargest));
+    Serial.print("% dma ");
+    Serial.print(m.dmaFree / 1024);
+    Serial.print("k/");
+    Serial.print(m.dmaLargest / 1024);
+    Serial.print("k psram ");
+    Serial.print(m.psramFree / 1024);
+    Serial.print("k/");
+    Serial.print(m.psramLargest / 1024);
+    Serial.print("k lv ");
+    Serial.print(m.lvglUsed / 1024);
+    Serial.print("k used ");
+    Serial.print(m.lvglFragPct);
+    Serial.print("%");
+}
+
+void printTelemetryReport(bool full) {
+    MemorySample now = sampleMemory();
+    printSampleLine(now);
+
+    // High-water marks, compact
+    Serial.print(" hw");
+    for (int i = 0; i < TELEMETRY_SCOPE_COUNT; i++) {
+        Serial.print(" ");
+        Serial.print(scopeNames[i]);
+        Serial.print("=");
+        Serial.print(scopes[i].peakUsed);
+    }
+    Serial.println();
+
+    if (!full) return;
+
+    Serial.println("--- Memory telemetry ---");
+    Serial.print("Internal low-water since boot: ");
+    Serial.print(heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT));
+    Serial.print(" bytes free, smallest largest-block: ");
+    Serial.println(minInternalLargest);
+    printLvglPoolStats();
+
+    for (int i = 0; i < TELEMETRY_SCOPE_COUNT; i++) {
+        Serial.print("  ");
+        Serial.print(scopeNames[i]);
+        Serial.print(": last ");
+        Serial.print(scopes[i].lastUsed);
+        Serial.print(", peak ");
+        Serial.print(scopes[i].peakUsed);
+        Serial.print(" bytes over ");
+        Serial.print(scopes[i].count);
+        Serial.println(" runs");
+    }
+
+    // Oldest first, so fragmentation trends read top to bottom
+    Serial.println("History:");
+    for (int i = 0; i < historyCount; i++) {
+        int index = (historyNext - historyCount + i + TELEMETRY_HISTORY) % TELEMETRY_HISTORY;
+        Serial.print("  ");
+        printSampleLine(history[index]);
+        Serial.println();
+    }
+}
+
+void telemetryUpdate() {
+    unsigned long now = millis();
+    if (now - lastReport < TELEMETRY_REPORT_INTERVAL) return;
+    lastReport = now;
+
+    history[historyNext] = sampleMemory();
+    historyNext = (historyNext + 1) % TELEMETRY_HISTORY;
+    if (historyCount < TELEMETRY_HISTORY) historyCount++;
+
+    printTelemetryReport(false);
+}
+
+void resetTelemetryHighWater() {
+    for (int i = 0; i < TELEMETRY_SCOPE_COUNT; i++) {
+        scopes[i].peakUsed = 0;
+        scopes[i].count = 0;
+    }
+    minInternalLargest = UINT32_MAX;
+}
@@ -0,0 +1,421 @@
+#include "wifi_manager.h"
+#include <WiFi.h>
+#include <Preferences.h>
+#include <esp_netif.h>
+#include <esp_netif_net_stack.h>
+#include <lwip/dhcp.h>
+#include <lwip/prot/dhcp.h>
+#include <lwip/tcpip.h>
+#include <time.h>
+
+#define WIFI_NVS_NAMESPACE "wifi"
+#define WIFI_CACHE_VERSION 2
+#define CLOCK_VALID_AFTER 1600000000  // Anything earlier means the clock isn't set
+
+// Task notification bits from the event callback
+#define EVENT_GOT_IP 0x1
+#define EVENT_DISCONNECTED 0x2
+
+#define CONNECTED_BIT 0x1  // wifiEvents: set while there is an IP
+
+struct WifiNetwork {
+    const char *ssid;
+    const char *password;
+};
+
+static const WifiNetwork networks[] = {
+    {WIFI_SSID, WIFI_PASSWORD},
+#ifdef WIFI_SSID_2
+    {WIFI_SSID_2, WIFI_PASSWORD_2},
+#endif
+#ifdef WIFI_SSID_3
+    {WIFI_SSID_3, WIFI_PASSWORD_3},
+#endif
+};
+#define NETWORK_COUNT ((int)(sizeof(networks) / sizeof(networks[0])))
+
+// Where the last connection went, saved in NVS
+struct WifiCache {
+    uint8_t version;
+    uint8_t network;  // Index into networks
+    uint8_t channel;
+    uint8_t reserved;
+    uint8_t bssid[6];
+    uint32_t ssidHash;  // So an edited config.h doesn't reuse another network's entry
+    uint32_t ip;
+    uint32_t gateway;
+    uint32_t subnet;
+    uint32_t dns;
+    uint32_t leaseAt;       // Unix seconds when DHCP handed out ip, 0 if unknown
+    uint32_t leaseSeconds;  // Lease length the server granted, 0 if unknown
+};
+
+static TaskHandle_t wifiTask = NULL;
+static EventGroupHandle_t wifiEvents = NULL;
+static volatile WifiState state = WIFI_STATE_CONNECTING;
+static volatile uint8_t disconnectReason = 0;
+static WifiStats stats;
+
+static WifiCache cache;
+static bool cacheValid = false;
+static bool cacheNeedsLease = false;  // Lease date or length still to be filled in
+
+static int networkIndex = 0;
+static int roundStart = 0;       // Network the current round of attempts began with
+static uint32_t failedRounds = 0;
+static bool fastFailed = false;  // Cached BSSID didn't work; scan until the next connect
+static bool attemptFast = false;
+static bool attemptReusedLease = false;
+static unsigned long attemptDeadline = 0;
+static unsigned long retryAt = 0;
+static unsigned long attemptStart = 0;
+static unsigned long droppedAt = 0;     // For the outage, which spans every attempt and backoff
+
+static uint32_t ssidHash(const char *ssid) {
+    uint32_t hash = 2166136261u;  // FNV-1a
+    while (*ssid) {
+        hash ^= (uint8_t)*ssid++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static bool clockValid() {
+    return time(nullptr) > CLOCK_VALID_AFTER;
+}
+
+static void loadCache() {
+    Preferences prefs;
+    prefs.begin(WIFI_NVS_NAMESPACE, true);
+    cacheValid = prefs.getBytes("cache", &cache, sizeof(cache)) == sizeof(cache) &&
+                 cache.version == WIFI_CACHE_VERSION && cache.network < NETWORK_COUNT &&
+                 cache.ssidHash == ssidHash(networks[cache.network].ssid);
+    prefs.end();
+    if (cacheValid) networkIndex = roundStart = cache.network;
+}
+
+static void saveCache(const WifiCache &updated) {
+    if (cacheValid && memcmp(&updated, &cache, sizeof(cache)) == 0) return;  // Spare the flash
+    cache = updated;
+    cacheValid = true;
+    Preferences prefs;
+    prefs.begin(WIFI_NVS_NAMESPACE, false);
+    prefs.putBytes("cache", &cache, sizeof(cache));
+    prefs.end();
+}
+
+// Until T1 (half the lease) the server still counts the address as ours
+static bool leaseReusable() {
+    if (cache.leaseAt == 0 || cache.leaseSeconds == 0 || cache.ip == 0 || !clockValid()) return false;
+    return (uint32_t)time(nullptr) - cache.leaseAt < cache.leaseSeconds / 2;
+}
+
+static struct netif *staNetif() {
+    esp_netif_t *netif = esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
+    return netif != NULL ? (struct netif *)esp_netif_get_netif_impl(netif) : NULL;
+}
+
+// Runs on the lwIP thread. Hands the reused address back to DHCP without taking
+// it off the interface: INIT-REBOOT asks the server to confirm it with a single
+// REQUEST, and from the ACK on lwIP renews the lease as usual. A NAK falls back
+// to DISCOVER. (esp_netif_dhcpc_start() would clear the address first.)
+static void rebootDhcp(void *param) {
+    struct netif *netif = (struct netif *)param;
+    if (dhcp_start(netif) != ERR_OK) return;
+    struct dhcp *dhcp = netif_dhcp_data(netif);
+    ip4_addr_copy(dhcp->offered_ip_addr, *netif_ip4_addr(netif));
+    ip4_addr_copy(dhcp->offered_sn_mask, *netif_ip4_netmask(netif));
+    ip4_addr_copy(dhcp->offered_gw_addr, *netif_ip4_gw(netif));
+    dhcp->state = DHCP_STATE_REBOOTING;
+    dhcp_network_changed(netif);  // Sends the REQUEST for offered_ip_addr
+}
+
+struct LeaseQuery {
+    struct tcpip_api_call_data call;  // First, so the callback can cast back
+    struct netif *netif;
+    uint32_t seconds;
+};
+
+static err_t queryLease(struct tcpip_api_call_data *call) {
+    LeaseQuery *query = (LeaseQuery *)call;
+    struct dhcp *dhcp = netif_dhcp_data(query->netif);
+    query->seconds = dhcp != NULL && dhcp->state == DHCP_STATE_BOUND ? dhcp->offered_t0_lease : 0;
+    return ERR_OK;
+}
+
+// Length of the lease DHCP is bound to, 0 while it isn't
+static uint32_t dhcpLeaseSeconds() {
+    LeaseQuery query = {};
+    query.netif = staNetif();
+    if (query.netif == NULL) return 0;
+    tcpip_api_call(queryLease, &query.call);
+    return query.seconds;
+}
+
+// Fills in what wasn't known at connect: the date once SNTP has set the clock,
+// the length once DHCP is bound. A NAKed reboot may have moved the address.
+static void updateLease() {
+    WifiCache updated = cache;
+    if (updated.leaseSeconds == 0) {
+        updated.leaseSeconds = dhcpLeaseSeconds();
+        if (updated.leaseSeconds != 0) {
+            updated.ip = (uint32_t)WiFi.localIP();
+            updated.gateway = (uint32_t)WiFi.gatewayIP();
+            updated.subnet = (uint32_t)WiFi.subnetMask();
+            updated.leaseAt = 0;  // Dated below, from this bind
+        }
+    }
+    if (updated.leaseAt == 0 && updated.leaseSeconds != 0 && clockValid()) updated.leaseAt = (uint32_t)time(nullptr);
+    saveCache(updated);
+    cacheNeedsLease = updated.leaseAt == 0 || updated.leaseSeconds == 0;
+}
+
+static void startAttempt() {
+    const WifiNetwork &network = networks[networkIndex];
+    attemptStart = millis();
+    attemptFast = cacheValid && cache.network == networkIndex && !fastFailed;
+    attemptReusedLease = attemptFast && leaseReusable();
+
+    if (attemptReusedLease) {
+        WiFi.config(IPAddress(cache.ip), IPAddress(cache.gateway), IPAddress(cache.subnet), IPAddress(cache.dns));
+    } else {
+        WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE);  // DHCP
+    }
+    if (attemptFast) {
+        WiFi.begin(network.ssid, network.password, cache.channel, cache.bssid);
+        stats.fastAttempts++;
+    } else {
+        WiFi.begin(network.ssid, network.password);
+    }
+
+    stats.attempts++;
+    state = WIFI_STATE_CONNECTING;
+    attemptDeadline = millis() + (attemptFast ? WIFI_FAST_CONNECT_TIMEOUT : WIFI_CONNECT_TIMEOUT);
+    Serial.print("WiFi: connecting to ");
+    Serial.print(network.ssid);
+    Serial.println(attemptReusedLease ? " (cached AP and lease)" : attemptFast ? " (cached AP)" : "");
+}
+
+static void scheduleRetry() {
+    uint32_t delayMs = WIFI_BACKOFF_BASE << min(failedRounds, (uint32_t)6);
+    if (delayMs > WIFI_BACKOFF_MAX) delayMs = WIFI_BACKOFF_MAX;
+    delayMs += esp_random() % (delayMs / 4 + 1);
+    failedRounds++;
+    retryAt = millis() + delayMs;
+    state = WIFI_STATE_BACKOFF;
+    Serial.print("WiFi: no network available, retrying in ");
+    Serial.print(delayMs);
+    Serial.println(" ms");
+}
+
+static void onAttemptFailed() {
+    WiFi.disconnect();
+    Serial.print("WiFi: attempt failed, reason ");
+    Serial.println(disconnectReason);
+
+    if (attemptFast) {
+        // AP moved or the lease is gone: scan the same network the normal way
+        fastFailed = true;
+        startAttempt();
+        return;
+    }
+    networkIndex = (networkIndex + 1) % NETWORK_COUNT;
+    if (networkIndex == roundStart) {
+        scheduleRetry();
+    } else {
+        startAttempt();
+    }
+}
+
+static void onConnected() {
+    unsigned long now = millis();
+    state = WIFI_STATE_CONNECTED;
+    xEventGroupSetBits(wifiEvents, CONNECTED_BIT);
+
+    uint32_t connectMs = now - attemptStart;
+    stats.connects++;
+    if (attemptFast) stats.fastConnects++;
+    stats.lastConnectMs = connectMs;
+    stats.totalConnectMs += connectMs;
+    if (stats.bestConnectMs == 0 || connectMs < stats.bestConnectMs) stats.bestConnectMs = connectMs;
+    if (stats.timeToNetworkMs == 0) stats.timeToNetworkMs = now;
+    if (droppedAt != 0) {
+        stats.lastOutageMs = now - droppedAt;
+        if (stats.lastOutageMs > stats.maxOutageMs) stats.maxOutageMs = stats.lastOutageMs;
+        droppedAt = 0;
+    }
+    failedRounds = 0;
+    fastFailed = false;
+    roundStart = networkIndex;
+
+    WifiCache updated = {};
+    updated.version = WIFI_CACHE_VERSION;
+    updated.network = networkIndex;
+    updated.channel = WiFi.channel();
+    memcpy(updated.bssid, WiFi.BSSID(), sizeof(updated.bssid));
+    updated.ssidHash = ssidHash(networks[networkIndex].ssid);
+    updated.ip = (uint32_t)WiFi.localIP();
+    updated.gateway = (uint32_t)WiFi.gatewayIP();
+    updated.subnet = (uint32_t)WiFi.subnetMask();
+    updated.dns = (uint32_t)WiFi.dnsIP(0);
+    if (attemptReusedLease) {
+        // Static until DHCP confirms it; the lease is dated from that ACK
+        struct netif *netif = staNetif();
+        if (netif != NULL) tcpip_callback(rebootDhcp, netif);
+    } else {
+        updated.leaseSeconds = dhcpLeaseSeconds();
+        if (clockValid()) updated.leaseAt = (uint32_t)time(nullptr);
+    }
+    cacheNeedsLease = updated.leaseAt == 0 || updated.leaseSeconds == 0;
+    saveCache(updated);
+
+    Serial.print("WiFi: connected to ");
+    Serial.print(networks[networkIndex].ssid);
+    Serial.print(" in ");
+    Serial.print(connectMs);
+    Serial.print(" ms");
+    Serial.print(attemptFast ? " (fast)" : "");
+    Serial.print(", IP ");
+    Serial.print(WiFi.localIP());
+    Serial.print(", channel ");
+    Serial.println(updated.channel);
+}
+
+static void onDropped() {
+    xEventGroupClearBits(wifiEvents, CONNECTED_BIT);
+    stats.disconnects++;
+    stats.lastDisconnectReason = disconnectReason;
+    droppedAt = millis();
+    Serial.print("WiFi: connection lost, reason ");
+    Serial.println(disconnectReason);
+    startAttempt();  // Same network first, via the cached AP
+}
+
+// Runs on the WiFi event task: record what happened and hand it to wifiTask
+static void onWifiEvent(arduino_event_id_t event, arduino_event_info_t info) {
+    if (wifiTask == NULL) return;
+    switch (event) {
+        case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+            xTaskNotify(wifiTask, EVENT_GOT_IP, eSetBits);
+            break;
+        case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+            // Our own disconnect() before a new attempt isn't a failure of that attempt
+            if (info.wifi_sta_disconnected.reason == WIFI_REASON_ASSOC_LEAVE) break;
+            disconnectReason = info.wifi_sta_disconnected.reason;
+            xTaskNotify(wifiTask, EVENT_DISCONNECTED, eSetBits);
+            break;
+        case ARDUINO_EVENT_WIFI_STA_LOST_IP:
+            xTaskNotify(wifiTask, EVENT_DISCONNECTED, eSetBits);
+            break;
+        default:
+            break;
+    }
+}
+
+static TickType_t ticksUntil(unsigned long deadline) {
+    long remaining = (long)(deadline - millis());
+    return remaining > 0 ? pdMS_TO_TICKS(remaining) : 0;
+}
+
+static void wifiManagerTask(void *param) {
+    loadCache();
+    startAttempt();
+
+    for (;;) {
+        TickType_t wait = portMAX_DELAY;
+        if (state == WIFI_STATE_CONNECTING) wait = ticksUntil(attemptDeadline);
+        else if (state == WIFI_STATE_BACKOFF) wait = ticksUntil(retryAt);
+        else if (cacheNeedsLease) wait = pdMS_TO_TICKS(cache.leaseSeconds == 0 ? 1000 : 10000);
+
+        uint32_t events = 0;
+        xTaskNotifyWait(0, UINT32_MAX, &events, wait);
+
+        if (state == WIFI_STATE_CONNECTING) {
+            if (events & EVENT_GOT_IP) {
+                onConnected();
+            } else if ((events & EVENT_DISCONNECTED) || (long)(millis() - attemptDeadline) >= 0) {
+                onAttemptFailed();
+            }
+        } else if (state == WIFI_STATE_CONNECTED) {
+            if (events & EVENT_DISCONNECTED) {
+                onDropped();
+            } else if (cacheNeedsLease) {
+                updateLease();  // So a soft reset can reuse the lease
+            }
+        } else if ((long)(millis() - retryAt) >= 0) {
+            roundStart = networkIndex;
+            startAttempt();
+        }
+    }
+}
+
+void startWifiManager() {
+    if (wifiTask != NULL) return;
+
+    WiFi.persistent(false);        // Credentials come from config.h; don't rewrite flash on every begin()
+    WiFi.setAutoReconnect(false);  // Reconnects are ours, with backoff and network rotation
+    WiFi.mode(WIFI_STA);
+    WiFi.onEvent(onWifiEvent);
+
+    wifiEvents = xEventGroupCreate();
+    xTaskCreatePinnedToCore(wifiManagerTask, "wifi", WIFI_TASK_STACK, NULL,
+                            WIFI_TASK_PRIORITY, &wifiTask, WIFI_TASK_CORE);
+}
+
+bool wifiConnected() {
+    return wifiEvents != NULL && (xEventGroupGetBits(wifiEvents) & CONNECTED_BIT);
+}
+
+bool waitForWifi(uint32_t timeoutMs) {
+    if (wifiEvents == NULL) return false;
+    TickType_t wait = timeoutMs == UINT32_MAX ? portMAX_DELAY : pdMS_TO_TICKS(timeoutMs);
+    return xEventGroupWaitBits(wifiEvents, CONNECTED_BIT, pdFALSE, pdTRUE, wait) & CONNECTED_BIT;
+}
+
+WifiState wifiState() {
+    return state;
+}
+
+const char *wifiNetworkName() {
+    return networks[networkIndex].ssid;
+}
+
+const WifiStats &wifiStats() {
+    return stats;
+}
+
+void printWifiStats() {
+    Serial.print("WiFi: ");
+    Serial.print(state == WIFI_STATE_CONNECTED ? "connected to " : state == WIFI_STATE_BACKOFF ? "waiting to retry " : "connecting to ");
+    Serial.print(wifiNetworkName());
+    if (state == WIFI_STATE_CONNECTED) {
+        Serial.print(", RSSI ");
+        Serial.print(WiFi.RSSI());
+        Serial.print(" dBm");
+    }
+    Serial.println();
+    Serial.print("  time to network ");
+    Serial.print(stats.timeToNetworkMs);
+    Serial.print(" ms, connect last ");
+    Serial.print(stats.lastConnectMs);
+    Serial.print(" ms, best ");
+    Serial.print(stats.bestConnectMs);
+    Serial.print(" ms, avg ");
+    Serial.print(stats.connects > 0 ? (uint32_t)(stats.totalConnectMs / stats.connects) : 0);
+    Serial.println(" ms");
+    Serial.print("  ");
+    Serial.print(stats.connects);
+    Serial.print(" connects (");
+    Serial.print(stats.fastConnects);
+    Serial.print(" fast) from ");
+    Serial.print(stats.attempts);
+    Serial.print(" attempts, ");
+    Serial.print(stats.disconnects);
+    Serial.print(" drops, last reason ");
+    Serial.print(stats.lastDisconnectReason);
+    Serial.print(", outage last ");
+    Serial.print(stats.lastOutageMs);
+    Serial.print(" ms, max ");
+    Serial.print(stats.maxOutageMs);
+    Serial.println(" ms");
+}
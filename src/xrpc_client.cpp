@@ -0,0 +1,806 @@
+#include "xrpc_client.h"
+#include <Preferences.h>
+#include <errno.h>
+#include <lwip/sockets.h>
+#include <mbedtls/error.h>
+#include <mbedtls/version.h>
+#include "feed_sources.h"
+
+#define TLS_NVS_NAMESPACE "tls"
+#define USER_AGENT "SeaGLBadge/1.0"
+#define TLS_MASTER_LEN 48
+
+static_assert(XRPC_POOL_SIZE >= FEED_MAX_SOURCES + 1, "every feed source needs a connection while the session is in use");
+
+// A pooled connection and the HTTPClient that drives it
+struct XrpcConnection {
+    XrpcTransport transport;
+    HTTPClient http;
+    char host[64];
+    uint16_t port;
+    bool secure;
+    bool busy;       // Held by an XrpcClient
+    bool open;       // Kept alive after the last request
+    uint32_t idleSince;
+};
+
+// Last TLS session with a host, offered on the next connection to it
+struct TlsSessionEntry {
+    char key[72];  // host:port
+    mbedtls_ssl_session session;
+    bool valid;
+    bool loaded;       // NVS was checked
+    uint32_t savedAt;  // millis() of the last NVS write, 0 if none this boot
+};
+
+static XrpcConnection pool[XRPC_POOL_SIZE];
+static portMUX_TYPE poolMux = portMUX_INITIALIZER_UNLOCKED;  // Busy flags and stats
+static TlsSessionEntry sessions[XRPC_TLS_CACHE_HOSTS];
+static int nextSession = 0;
+static SemaphoreHandle_t sessionLock = NULL;
+static mbedtls_ssl_config tlsConfig;
+static mbedtls_x509_crt caChain;
+static bool ready = false;
+static volatile bool keepAlive = true;
+static volatile bool resumption = true;
+static XrpcStats stats;
+
+// Hardware RNG, safe from any task, so the shared TLS config needs no DRBG
+static int randomBytes(void *context, unsigned char *out, size_t length) {
+    esp_fill_random(out, length);
+    return 0;
+}
+
+static void countFailedConnect(bool untrusted) {
+    portENTER_CRITICAL(&poolMux);
+    stats.failedConnects++;
+    if (untrusted) stats.verifyFailures++;
+    portEXIT_CRITICAL(&poolMux);
+}
+
+// ---- TLS session cache ----
+
+static void nvsKey(const char *key, char *out, size_t size) {
+    uint32_t hash = 2166136261u;  // FNV-1a; NVS keys are 15 characters at most
+    for (const char *c = key; *c; c++) {
+        hash ^= (uint8_t)*c;
+        hash *= 16777619u;
+    }
+    snprintf(out, size, "s%08x", hash);
+}
+
+// Blob: the host:port key and its terminator, then mbedtls_ssl_session_save()'s output
+static void loadStoredSession(TlsSessionEntry &entry) {
+    entry.loaded = true;
+    if (!XRPC_TLS_PERSIST) return;
+
+    char key[12];
+    nvsKey(entry.key, key, sizeof(key));
+    Preferences prefs;
+    if (!prefs.begin(TLS_NVS_NAMESPACE, true)) return;
+    size_t length = prefs.getBytesLength(key);
+    size_t keyLength = strlen(entry.key) + 1;
+    if (length > keyLength && length <= XRPC_TLS_SESSION_MAX) {
+        uint8_t *blob = (uint8_t *)malloc(length);
+        if (blob != NULL && prefs.getBytes(key, blob, length) == length && memcmp(blob, entry.key, keyLength) == 0 &&
+            mbedtls_ssl_session_load(&entry.session, blob + keyLength, length - keyLength) == 0) {
+            entry.valid = true;
+            stats.sessionsRestored++;
+        }
+        free(blob);
+    }
+    prefs.end();
+}
+
+static void saveStoredSession(TlsSessionEntry &entry) {
+    size_t keyLength = strlen(entry.key) + 1;
+    size_t length = 0;
+    mbedtls_ssl_session_save(&entry.session, NULL, 0, &length);  // Only sizes it
+    if (length == 0 || keyLength + length > XRPC_TLS_SESSION_MAX) {
+        Serial.print("TLS session for ");
+        Serial.print(entry.key);
+        Serial.print(" is too large to keep (");
+        Serial.print(length);
+        Serial.println(" bytes)");
+        entry.savedAt = millis() | 1;  // Don't try again for a while
+        return;
+    }
+
+    uint8_t *blob = (uint8_t *)malloc(keyLength + length);
+    if (blob == NULL) return;
+    memcpy(blob, entry.key, keyLength);
+    if (mbedtls_ssl_session_save(&entry.session, blob + keyLength, length, &length) == 0) {
+        char key[12];
+        nvsKey(entry.key, key, sizeof(key));
+        Preferences prefs;
+        prefs.begin(TLS_NVS_NAMESPACE, false);
+        if (prefs.putBytes(key, blob, keyLength + length) > 0) stats.sessionsSaved++;
+        prefs.end();
+        entry.savedAt = millis() | 1;
+    }
+    free(blob);
+}
+
+// A TLS 1.2 session's master secret, the one thing a resumed handshake keeps.
+// mbedtls 3 made the fields private; MBEDTLS_PRIVATE() still reaches them there.
+static const unsigned char *sessionMaster(const mbedtls_ssl_session *session) {
+#if MBEDTLS_VERSION_NUMBER >= 0x03000000
+    return session->MBEDTLS_PRIVATE(master);
+#else
+    return session->master;
+#endif
+}
+
+static const mbedtls_ssl_session *currentSession(const mbedtls_ssl_context &ssl) {
+#if MBEDTLS_VERSION_NUMBER >= 0x03000000
+    return ssl.MBEDTLS_PRIVATE(session);
+#else
+    return ssl.session;
+#endif
+}
+
+// Call with sessionLock held
+static TlsSessionEntry &sessionEntry(const char *key) {
+    for (int i = 0; i < XRPC_TLS_CACHE_HOSTS; i++) {
+        if (strcmp(sessions[i].key, key) == 0) return sessions[i];
+    }
+    TlsSessionEntry &entry = sessions[nextSession];
+    nextSession = (nextSession + 1) % XRPC_TLS_CACHE_HOSTS;
+    mbedtls_ssl_session_free(&entry.session);
+    mbedtls_ssl_session_init(&entry.session);
+    strlcpy(entry.key, key, sizeof(entry.key));
+    entry.valid = false;
+    entry.loaded = false;
+    entry.savedAt = 0;
+    return entry;
+}
+
+// Offers the cached session for key; master gets its secret, to tell afterwards whether the server took it
+static bool offerSession(const char *key, mbedtls_ssl_context &ssl, unsigned char *master) {
+    xSemaphoreTake(sessionLock, portMAX_DELAY);
+    TlsSessionEntry &entry = sessionEntry(key);
+    if (!entry.loaded) loadStoredSession(entry);
+    bool offered = entry.valid && mbedtls_ssl_set_session(&ssl, &entry.session) == 0;
+    if (offered) memcpy(master, sessionMaster(&entry.session), TLS_MASTER_LEN);
+    xSemaphoreGive(sessionLock);
+    return offered;
+}
+
+// Keeps the session just negotiated. Only full handshakes go to NVS: a resumed
+// session is already there, and flash shouldn't be written on every connection.
+static void keepSession(const char *key, mbedtls_ssl_context &ssl, bool full) {
+    xSemaphoreTake(sessionLock, portMAX_DELAY);
+    TlsSessionEntry &entry = sessionEntry(key);
+    mbedtls_ssl_session_free(&entry.session);
+    mbedtls_ssl_session_init(&entry.session);
+    entry.valid = mbedtls_ssl_get_session(&ssl, &entry.session) == 0;
+    if (entry.valid && full && XRPC_TLS_PERSIST &&
+        (entry.savedAt == 0 || millis() - entry.savedAt > XRPC_TLS_SAVE_INTERVAL)) {
+        saveStoredSession(entry);
+    }
+    xSemaphoreGive(sessionLock);
+}
+
+// ---- Transport ----
+
+XrpcTransport::XrpcTransport() {
+    mbedtls_net_init(&net);
+    host[0] = '\0';
+    memset(&timing, 0, sizeof(timing));
+}
+
+XrpcTransport::~XrpcTransport() {
+    stop();
+}
+
+bool XrpcTransport::waitFor(bool writable, uint32_t waitMs) {
+    fd_set fds;
+    FD_ZERO(&fds);
+    FD_SET(net.fd, &fds);
+    struct timeval tv;
+    tv.tv_sec = waitMs / 1000;
+    tv.tv_usec = waitMs % 1000 * 1000;
+    return ::select(net.fd + 1, writable ? NULL : &fds, writable ? &fds : NULL, NULL, &tv) > 0;
+}
+
+bool XrpcTransport::handshake(int32_t timeoutMs) {
+    if (stats.caCerts == 0 && !XRPC_ALLOW_UNVERIFIED) {
+        Serial.print("TLS to ");
+        Serial.print(host);
+        Serial.println(" refused: no CA bundle to verify it against");
+        untrusted = true;
+        return false;
+    }
+    uint32_t start = micros();
+    mbedtls_ssl_init(&ssl);
+    sslReady = true;
+    if (mbedtls_ssl_setup(&ssl, &tlsConfig) != 0 || mbedtls_ssl_set_hostname(&ssl, host) != 0) return false;
+    mbedtls_ssl_set_bio(&ssl, &net, mbedtls_net_send, mbedtls_net_recv, NULL);
+
+    char key[sizeof(host) + 8];
+    snprintf(key, sizeof(key), "%s:%u", host, port);
+    unsigned char master[TLS_MASTER_LEN];
+    bool offered = resumption && offerSession(key, ssl, master);
+
+    uint32_t startMs = millis();
+    int ret;
+    while ((ret = mbedtls_ssl_handshake(&ssl)) != 0) {
+        uint32_t spentMs = millis() - startMs;
+        bool blocked = ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE;
+        if (blocked && spentMs < (uint32_t)timeoutMs && waitFor(ret == MBEDTLS_ERR_SSL_WANT_WRITE, timeoutMs - spentMs)) continue;
+
+        char error[96];
+        mbedtls_strerror(ret, error, sizeof(error));
+        Serial.print("TLS handshake with ");
+        Serial.print(host);
+        Serial.print(" failed: ");
+        Serial.println(blocked ? "timed out" : error);
+        untrusted = ret == MBEDTLS_ERR_X509_CERT_VERIFY_FAILED;
+        if (untrusted) {
+            char info[128];
+            mbedtls_x509_crt_verify_info(info, sizeof(info), "  ", mbedtls_ssl_get_verify_result(&ssl));
+            Serial.print(info);
+            Serial.println("  Not signed by a root in the CA bundle; rebuild it with tools/ca_bundle.py");
+        }
+        return false;
+    }
+
+    timing.tlsUs = micros() - start;
+    const mbedtls_ssl_session *session = currentSession(ssl);
+    timing.resumed = offered && session != NULL && memcmp(sessionMaster(session), master, sizeof(master)) == 0;
+    keepSession(key, ssl, !timing.resumed);
+    return true;
+}
+
+bool XrpcTransport::open(IPAddress ip, int32_t timeoutMs) {
+    uint32_t start = micros();
+    net.fd = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (net.fd < 0) return false;
+    mbedtls_net_set_nonblock(&net);
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = (uint32_t)ip;
+    int error = 0;
+    socklen_t length = sizeof(error);
+    if ((::connect(net.fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 && errno != EINPROGRESS) ||
+        !waitFor(true, timeoutMs) || ::getsockopt(net.fd, SOL_SOCKET, SO_ERROR, &error, &length) < 0 || error != 0) {
+        Serial.print("TCP connect to ");
+        Serial.print(host);
+        Serial.print(":");
+        Serial.print(port);
+        Serial.println(" failed");
+        return false;
+    }
+    int noDelay = 1;
+    ::setsockopt(net.fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+    timing.tcpUs = micros() - start;
+
+    return !secure || handshake(timeoutMs);
+}
+
+int XrpcTransport::connect(IPAddress ip, uint16_t hostPort) {
+    return connect(ip, hostPort, ioTimeoutMs);
+}
+
+int XrpcTransport::connect(IPAddress ip, uint16_t hostPort, int32_t timeoutMs) {
+    stop();
+    memset(&timing, 0, sizeof(timing));
+    connectTried = true;
+    untrusted = false;
+    strlcpy(host, ip.toString().c_str(), sizeof(host));
+    port = hostPort;
+    if (open(ip, timeoutMs)) return 1;
+    countFailedConnect(untrusted);
+    stop();
+    return 0;
+}
+
+int XrpcTransport::connect(const char *hostName, uint16_t hostPort) {
+    return connect(hostName, hostPort, ioTimeoutMs);
+}
+
+int XrpcTransport::connect(const char *hostName, uint16_t hostPort, int32_t timeoutMs) {
+    stop();
+    memset(&timing, 0, sizeof(timing));
+    connectTried = true;
+    untrusted = false;
+    strlcpy(host, hostName, sizeof(host));
+    port = hostPort;
+
+    uint32_t start = micros();
+    IPAddress ip;
+    if (!WiFi.hostByName(hostName, ip)) {
+        Serial.print("DNS lookup failed for ");
+        Serial.println(hostName);
+        countFailedConnect(false);
+        return 0;
+    }
+    timing.dnsUs = micros() - start;
+
+    if (open(ip, timeoutMs)) return 1;
+    countFailedConnect(untrusted);
+    stop();
+    return 0;
+}
+
+bool XrpcTransport::takeConnectTiming(XrpcTiming &out) {
+    if (!connectTried) return false;
+    connectTried = false;
+    out.dnsUs = timing.dnsUs;
+    out.tcpUs = timing.tcpUs;
+    out.tlsUs = timing.tlsUs;
+    out.resumed = timing.resumed;
+    return true;
+}
+
+// > 0 bytes read, 0 closed or failed, < 0 nothing yet
+int XrpcTransport::receive(uint8_t *buf, size_t size) {
+    if (secure) {
+        int ret = mbedtls_ssl_read(&ssl, buf, size);
+        if (ret > 0) return ret;
+        return ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE ? -1 : 0;
+    }
+    int ret = ::recv(net.fd, buf, size, MSG_DONTWAIT);
+    if (ret > 0) return ret;
+    return ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) ? -1 : 0;
+}
+
+// Makes sure there's buffered data, waiting up to waitMs for it
+bool XrpcTransport::fill(uint32_t waitMs) {
+    if (rxPos < rxLen) return true;
+    if (net.fd < 0 || peerClosed) return false;
+    rxPos = 0;
+    rxLen = 0;
+    uint32_t start = millis();
+    for (;;) {
+        int got = receive(rx, sizeof(rx));
+        if (got > 0) {
+            rxLen = got;
+            bytesIn += got;
+            return true;
+        }
+        if (got == 0) {
+            peerClosed = true;
+            return false;
+        }
+        uint32_t spentMs = millis() - start;
+        if (spentMs >= waitMs || !waitFor(false, waitMs - spentMs)) return false;
+    }
+}
+
+size_t XrpcTransport::write(uint8_t data) {
+    return write(&data, 1);
+}
+
+size_t XrpcTransport::write(const uint8_t *buf, size_t size) {
+    size_t sent = 0;
+    uint32_t start = millis();
+    while (sent < size && net.fd >= 0) {
+        int ret;
+        bool wantRead = false;
+        bool blocked;
+        if (secure) {
+            ret = mbedtls_ssl_write(&ssl, buf + sent, size - sent);
+            wantRead = ret == MBEDTLS_ERR_SSL_WANT_READ;
+            blocked = wantRead || ret == MBEDTLS_ERR_SSL_WANT_WRITE;
+        } else {
+            ret = ::send(net.fd, buf + sent, size - sent, MSG_DONTWAIT);
+            blocked = ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+        }
+        if (ret > 0) {
+            sent += ret;
+            continue;
+        }
+        uint32_t spentMs = millis() - start;
+        if (!blocked || spentMs >= ioTimeoutMs || !waitFor(!wantRead, ioTimeoutMs - spentMs)) break;
+    }
+    return sent;
+}
+
+int XrpcTransport::available() {
+    if (rxPos == rxLen) fill(0);
+    return rxLen - rxPos + (sslReady ? mbedtls_ssl_get_bytes_avail(&ssl) : 0);
+}
+
+int XrpcTransport::read() {
+    if (!fill(ioTimeoutMs)) return -1;
+    return rx[rxPos++];
+}
+
+int XrpcTransport::read(uint8_t *buf, size_t size) {
+    if (!fill(ioTimeoutMs)) return -1;
+    size_t count = min(size, rxLen - rxPos);
+    memcpy(buf, rx + rxPos, count);
+    rxPos += count;
+    return count;
+}
+
+int XrpcTransport::peek() {
+    if (!fill(ioTimeoutMs)) return -1;
+    return rx[rxPos];
+}
+
+// Drops whatever has arrived, like WiFiClient::flush()
+void XrpcTransport::flush() {
+    while (fill(0)) rxPos = rxLen;
+}
+
+void XrpcTransport::stop() {
+    if (sslReady) {
+        if (net.fd >= 0 && !peerClosed) mbedtls_ssl_close_notify(&ssl);  // Best effort, doesn't wait
+        mbedtls_ssl_free(&ssl);
+        sslReady = false;
+    }
+    mbedtls_net_free(&net);
+    peerClosed = false;
+    rxPos = 0;
+    rxLen = 0;
+}
+
+// Also notices when the server has closed a kept-alive connection
+uint8_t XrpcTransport::connected() {
+    if (rxPos < rxLen) return 1;
+    if (net.fd < 0 || peerClosed) return 0;
+    fill(0);
+    return rxPos < rxLen || !peerClosed;
+}
+
+int XrpcTransport::setTimeout(uint32_t seconds) {
+    ioTimeoutMs = seconds * 1000;
+    Stream::setTimeout(ioTimeoutMs);
+    return 0;
+}
+
+// ---- Pool ----
+
+static void closeConnection(XrpcConnection &connection) {
+    connection.transport.stop();
+    connection.open = false;
+}
+
+// The kept-alive connection to host if there is one, otherwise a closed slot
+// or the one idle the longest
+static XrpcConnection *acquire(const char *host, uint16_t port, bool secure) {
+    XrpcConnection *match = NULL;
+    XrpcConnection *spare = NULL;
+    portENTER_CRITICAL(&poolMux);
+    for (int i = 0; i < XRPC_POOL_SIZE; i++) {
+        XrpcConnection &c = pool[i];
+        if (c.busy) continue;
+        if (c.open && c.port == port && c.secure == secure && strcmp(c.host, host) == 0) {
+            match = &c;
+            break;
+        }
+        if (spare == NULL || (spare->open && (!c.open || c.idleSince < spare->idleSince))) spare = &c;
+    }
+    XrpcConnection *taken = match != NULL ? match : spare;
+    if (taken != NULL) taken->busy = true;
+    portEXIT_CRITICAL(&poolMux);
+    if (taken == NULL) return NULL;
+
+    // Servers drop idle connections on their own; reusing one that old would mostly fail
+    if (taken != match || !keepAlive || millis() - taken->idleSince > XRPC_KEEP_ALIVE_MS) closeConnection(*taken);
+    strlcpy(taken->host, host, sizeof(taken->host));
+    taken->port = port;
+    taken->secure = secure;
+    taken->transport.setSecure(secure);
+    return taken;
+}
+
+static void release(XrpcConnection &connection, bool keep) {
+    connection.open = keep && connection.transport.connected();
+    if (!connection.open) connection.transport.stop();
+    connection.idleSince = millis();
+    portENTER_CRITICAL(&poolMux);
+    connection.busy = false;
+    portEXIT_CRITICAL(&poolMux);
+}
+
+void xrpcCloseIdle() {
+    for (int i = 0; i < XRPC_POOL_SIZE; i++) {
+        XrpcConnection &c = pool[i];
+        portENTER_CRITICAL(&poolMux);
+        bool take = !c.busy && c.open;
+        if (take) c.busy = true;
+        portEXIT_CRITICAL(&poolMux);
+        if (!take) continue;
+        closeConnection(c);
+        portENTER_CRITICAL(&poolMux);
+        c.busy = false;
+        portEXIT_CRITICAL(&poolMux);
+    }
+}
+
+// ---- Client ----
+
+bool XrpcClient::begin(const String &requestUrl, uint16_t requestTimeoutMs) {
+    end();
+    bool secure = requestUrl.startsWith("https://");
+    if (!secure && !requestUrl.startsWith("http://")) return false;
+
+    unsigned int hostStart = secure ? 8 : 7;
+    unsigned int hostEnd = hostStart;
+    while (hostEnd < requestUrl.length() && strchr(":/?", requestUrl[hostEnd]) == NULL) hostEnd++;
+    uint16_t port = secure ? 443 : 80;
+    if (hostEnd < requestUrl.length() && requestUrl[hostEnd] == ':') port = requestUrl.substring(hostEnd + 1).toInt();
+    String host = requestUrl.substring(hostStart, hostEnd);
+
+    connection = acquire(host.c_str(), port, secure);
+    if (connection == NULL) {
+        Serial.println("ERROR: Every XRPC connection is in use");
+        return false;
+    }
+    url = requestUrl;
+    timeoutMs = requestTimeoutMs;
+    httpCode = 0;
+    headerCount = 0;
+    collected[0] = "Transfer-Encoding";
+    collectedCount = 1;
+    bodyRead = false;
+    memset(&requestTiming, 0, sizeof(requestTiming));
+    return true;
+}
+
+void XrpcClient::addHeader(const char *name, const String &value) {
+    if (headerCount == XRPC_MAX_HEADERS) return;
+    headerNames[headerCount] = name;
+    headerValues[headerCount] = value;
+    headerCount++;
+}
+
+void XrpcClient::collectHeaders(const char *keys[], size_t count) {
+    collectedCount = 1;
+    for (size_t i = 0; i < count && collectedCount < XRPC_MAX_HEADERS + 1; i++) {
+        if (strcasecmp(keys[i], "Transfer-Encoding") != 0) collected[collectedCount++] = keys[i];
+    }
+}
+
+int XrpcClient::send(const char *type, const String &payload) {
+    if (connection == NULL) return HTTPC_ERROR_CONNECTION_REFUSED;
+    HTTPClient &http = connection->http;
+    for (int attempt = 0;; attempt++) {
+        uint32_t start = micros();
+        http.begin(connection->transport, url);
+        http.setReuse(keepAlive);
+        http.setConnectTimeout(timeoutMs);
+        http.setTimeout(timeoutMs);
+        http.setUserAgent(USER_AGENT);
+        for (int i = 0; i < headerCount; i++) {
+            http.addHeader(headerNames[i], headerValues[i]);
+        }
+        http.collectHeaders(collected, collectedCount);
+        uint32_t receivedBefore = connection->transport.received();
+        httpCode = http.sendRequest(type, payload);
+
+        uint32_t elapsedUs = micros() - start;
+        memset(&requestTiming, 0, sizeof(requestTiming));
+        bool connected = connection->transport.takeConnectTiming(requestTiming);
+        requestTiming.reused = !connected;
+        uint32_t connectUs = requestTiming.dnsUs + requestTiming.tcpUs + requestTiming.tlsUs;
+        requestTiming.firstByteUs = elapsedUs > connectUs ? elapsedUs - connectUs : 0;
+        headersAt = micros();
+
+        // Only a GET on a kept-alive connection is sent again, and only when the send
+        // failed or the connection closed before a single response byte: the server
+        // had dropped it. A timeout means a slow server, not a dead connection, and a
+        // POST may already have been handled (refreshSession rotates the token).
+        bool lost = httpCode == HTTPC_ERROR_SEND_HEADER_FAILED || httpCode == HTTPC_ERROR_SEND_PAYLOAD_FAILED ||
+                    httpCode == HTTPC_ERROR_NOT_CONNECTED || httpCode == HTTPC_ERROR_CONNECTION_LOST;
+        bool retry = lost && !connected && attempt == 0 && strcmp(type, "GET") == 0 &&
+                     connection->transport.received() == receivedBefore;
+        portENTER_CRITICAL(&poolMux);
+        stats.requests++;
+        if (retry) {
+            stats.retries++;
+        } else if (httpCode > 0 && connected) {
+            stats.connects++;
+            stats.dnsUs += requestTiming.dnsUs;
+            stats.tcpUs += requestTiming.tcpUs;
+            if (connection->secure && requestTiming.resumed) {
+                stats.resumedHandshakes++;
+                stats.resumedTlsUs += requestTiming.tlsUs;
+            } else if (connection->secure) {
+                stats.fullHandshakes++;
+                stats.fullTlsUs += requestTiming.tlsUs;
+            }
+        } else if (httpCode > 0) {
+            stats.reused++;
+        }
+        if (httpCode > 0) stats.firstByteUs += requestTiming.firstByteUs;
+        portEXIT_CRITICAL(&poolMux);
+        if (!retry) return httpCode;
+
+        // The server closed the kept-alive connection as the request went out
+        connection->transport.stop();
+    }
+}
+
+int XrpcClient::GET() {
+    return send("GET", "");
+}
+
+int XrpcClient::POST(const String &payload) {
+    return send("POST", payload);
+}
+
+HTTPClient &XrpcClient::http() {
+    return connection->http;
+}
+
+bool XrpcClient::chunked() {
+    return connection->http.header("Transfer-Encoding").equalsIgnoreCase("chunked");
+}
+
+JsonStreamReader XrpcClient::body() {
+    return JsonStreamReader(connection->http.getStream(), chunked(), connection->http.getSize());
+}
+
+String XrpcClient::getString() {
+    bodyRead = true;
+    return connection->http.getString();
+}
+
+void XrpcClient::end(JsonStreamReader *reader) {
+    if (connection == NULL) return;
+
+    // The connection can only take another request once this response is off it
+    bool keep = keepAlive && httpCode > 0;
+    if (keep && !bodyRead) {
+        JsonStreamReader rest = body();
+        if (reader == NULL) reader = &rest;
+        if (!reader->finished()) {
+            size_t readBefore = reader->bytesRead();
+            keep = reader->drain(XRPC_DRAIN_MAX);
+            if (keep && reader->bytesRead() > readBefore) {
+                portENTER_CRITICAL(&poolMux);
+                stats.drained++;
+                portEXIT_CRITICAL(&poolMux);
+            }
+        }
+    }
+    if (httpCode > 0) {
+        requestTiming.bodyUs = micros() - headersAt;
+        portENTER_CRITICAL(&poolMux);
+        stats.bodyUs += requestTiming.bodyUs;
+        portEXIT_CRITICAL(&poolMux);
+    }
+
+    if (!keep) connection->transport.stop();
+    connection->http.end();
+    release(*connection, keep);
+    connection = NULL;
+}
+
+// ---- Setup and stats ----
+
+void xrpcInit() {
+    if (ready) return;
+    sessionLock = xSemaphoreCreateMutex();
+    for (int i = 0; i < XRPC_TLS_CACHE_HOSTS; i++) {
+        mbedtls_ssl_session_init(&sessions[i].session);
+    }
+
+    mbedtls_ssl_config_init(&tlsConfig);
+    mbedtls_ssl_config_defaults(&tlsConfig, MBEDTLS_SSL_IS_CLIENT, MBEDTLS_SSL_TRANSPORT_STREAM, MBEDTLS_SSL_PRESET_DEFAULT);
+    mbedtls_ssl_conf_rng(&tlsConfig, randomBytes, NULL);
+#ifdef MBEDTLS_SSL_SESSION_TICKETS
+    mbedtls_ssl_conf_session_tickets(&tlsConfig, MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+#endif
+
+    mbedtls_x509_crt_init(&caChain);
+    const char *ca = XRPC_CA_PEM;
+    if (ca != NULL) mbedtls_x509_crt_parse(&caChain, (const unsigned char *)ca, strlen(ca) + 1);
+    for (mbedtls_x509_crt *cert = &caChain; cert != NULL && cert->raw.len > 0; cert = cert->next) {
+        stats.caCerts++;
+    }
+    if (stats.caCerts > 0) {
+        mbedtls_ssl_conf_ca_chain(&tlsConfig, &caChain, NULL);
+        mbedtls_ssl_conf_authmode(&tlsConfig, MBEDTLS_SSL_VERIFY_REQUIRED);
+        Serial.print("XRPC: verifying servers against ");
+        Serial.print(stats.caCerts);
+        Serial.println(" CA root(s)");
+    } else if (XRPC_ALLOW_UNVERIFIED) {
+        mbedtls_ssl_conf_authmode(&tlsConfig, MBEDTLS_SSL_VERIFY_NONE);
+        Serial.println("WARNING: No CA bundle, servers are not verified (XRPC_ALLOW_UNVERIFIED)");
+    } else {
+        Serial.println("ERROR: No CA bundle, TLS connections will be refused (see tools/ca_bundle.py)");
+    }
+    ready = true;
+}
+
+void xrpcSetKeepAlive(bool enabled) {
+    keepAlive = enabled;
+    if (!enabled) xrpcCloseIdle();
+}
+
+void xrpcSetResumption(bool enabled) {
+    resumption = enabled;
+}
+
+const XrpcStats &xrpcStats() {
+    return stats;
+}
+
+void resetXrpcStats() {
+    portENTER_CRITICAL(&poolMux);
+    uint8_t caCerts = stats.caCerts;
+    memset(&stats, 0, sizeof(stats));
+    stats.caCerts = caCerts;
+    portEXIT_CRITICAL(&poolMux);
+}
+
+static void printAvgMs(const char *label, uint64_t totalUs, uint32_t count) {
+    Serial.print(label);
+    Serial.print(count > 0 ? (uint32_t)(totalUs / count / 1000) : 0);
+    Serial.print(" ms");
+}
+
+void printXrpcStats() {
+    const XrpcStats &s = xrpcStats();
+    uint32_t answered = s.connects + s.reused;
+    Serial.print("XRPC: ");
+    Serial.print(s.requests);
+    Serial.print(" requests, ");
+    Serial.print(s.reused);
+    Serial.print(" on kept-alive connections (");
+    Serial.print(answered > 0 ? s.reused * 100 / answered : 0);
+    Serial.print("%), ");
+    Serial.print(s.connects);
+    Serial.print(" new (");
+    Serial.print(s.fullHandshakes);
+    Serial.print(" full TLS, ");
+    Serial.print(s.resumedHandshakes);
+    Serial.print(" resumed), ");
+    Serial.print(s.failedConnects);
+    Serial.print(" failed (");
+    Serial.print(s.verifyFailures);
+    Serial.print(" untrusted), ");
+    Serial.print(s.retries);
+    Serial.print(" retried, ");
+    Serial.print(s.drained);
+    Serial.println(" drained");
+    printAvgMs("  Avg DNS ", s.dnsUs, s.connects);
+    printAvgMs(", TCP ", s.tcpUs, s.connects);
+    printAvgMs(", full TLS ", s.fullTlsUs, s.fullHandshakes);
+    printAvgMs(", resumed TLS ", s.resumedTlsUs, s.resumedHandshakes);
+    printAvgMs(", first byte ", s.firstByteUs, answered);
+    printAvgMs(", body ", s.bodyUs, answered);
+    Serial.println();
+    Serial.print("  CA bundle: ");
+    if (s.caCerts > 0) {
+        Serial.print(s.caCerts);
+        Serial.print(" root(s)");
+    } else {
+        Serial.print(XRPC_ALLOW_UNVERIFIED ? "none, servers not verified" : "none, TLS refused");
+    }
+    Serial.print("; TLS sessions ");
+    Serial.print(s.sessionsRestored);
+    Serial.print(" restored from NVS, ");
+    Serial.print(s.sessionsSaved);
+    Serial.print(" saved; keep-alive ");
+    Serial.print(keepAlive ? "on" : "off");
+    Serial.print(", resumption ");
+    Serial.println(resumption ? "on" : "off");
+}
+
+void printXrpcTiming(const XrpcTiming &timing) {
+    if (timing.reused) {
+        Serial.print(", kept alive");
+    } else {
+        Serial.print(", DNS ");
+        Serial.print(timing.dnsUs / 1000);
+        Serial.print(" TCP ");
+        Serial.print(timing.tcpUs / 1000);
+        Serial.print(" TLS ");
+        Serial.print(timing.tlsUs / 1000);
+        if (timing.resumed) Serial.print(" (resumed)");
+    }
+    Serial.print(", first byte ");
+    Serial.print(timing.firstByteUs / 1000);
+    Serial.print(" body ");
+    Serial.print(timing.bodyUs / 1000);
+    Serial.print(" ms");
+}
@@ -0,0 +1,328 @@
+#!/usr/bin/env python3
+"""Build-time CA bundle for the badge's HTTPS and WSS connections.
+
+Finds the hosts the firmware talks to (the https:// and wss:// URLs in
+include/config.h and the other headers, FEED_SOURCES' Mastodon servers
+included), asks each one for its certificate chain with openssl s_client, and
+looks up the root that chain ends at in this machine's trust store. Only
+those roots are compiled in (src/xrpc_client.cpp verifies against them), so the
+bundle stays a few KB instead of the ~200 KB of a full store, and a server
+that switches to a CA outside it fails loudly instead of silently.
+
+The bundle is rebuilt when the hosts change and otherwise refreshed every
+REFRESH_DAYS days. If a host can't be reached, the last bundle is kept.
+XRPC_CA_HOSTS adds hosts (comma-separated) to the ones found, and XRPC_CA_FILE
+uses a PEM file as the bundle as is, e.g. the mock server's self-signed
+certificate for the fetch-bench:
+
+    XRPC_CA_FILE=mock.crt MOCK_XRPC_URL=https://192.168.1.50:8443 pio run -e fetch-bench -t upload
+
+Runs as a PlatformIO pre: script. It can also be run on its own to print the
+hosts and roots:
+
+    python3 tools/ca_bundle.py --out /tmp/badge_ca
+
+Needs the openssl command line tool. Without it, with no trust store, or when
+the hosts can't be reached on the first build, there is no bundle and the
+build fails. XRPC_ALLOW_UNVERIFIED=1 builds anyway, and the badge then connects
+without verifying servers. A self-signed certificate a host sends is never
+pinned; use XRPC_CA_FILE for one on purpose.
+"""
+
+import argparse
+import glob
+import hashlib
+import os
+import re
+import ssl
+import subprocess
+import sys
+import tempfile
+import time
+
+SCRIPT_VERSION = 1
+REFRESH_DAYS = 30
+CONNECT_TIMEOUT = 20
+
+URL_RE = re.compile(r'"(?:https|wss)://([A-Za-z0-9.-]+)(?::(\d+))?')
+PEM_RE = re.compile(r"-----BEGIN CERTIFICATE-----.+?-----END CERTIFICATE-----", re.S)
+LINE_COMMENT_RE = re.compile(r"(^|\s)//.*$", re.M)
+BLOCK_COMMENT_RE = re.compile(r"/\*.*?\*/", re.S)
+SKIPPED_DEFINES = ("BADGE_PROFILE_URL",)  # Only shown as a QR code
+RESERVED_SUFFIXES = (".example", ".test", ".invalid", ".localhost", "localhost")
+
+TRUST_STORES = ("/etc/ssl/certs/ca-certificates.crt", "/etc/pki/tls/certs/ca-bundle.crt",
+                "/etc/ssl/ca-bundle.pem", "/etc/ssl/cert.pem", "/usr/local/etc/openssl/cert.pem")
+
+
+def log(message):
+    print("ca_bundle: " + message, flush=True)
+
+
+# Hosts
+
+def header_hosts(paths):
+    """host:port of every https:// and wss:// URL the firmware could connect to."""
+    hosts = []
+    for path in paths:
+        with open(path, encoding="utf-8", errors="replace") as f:
+            source = BLOCK_COMMENT_RE.sub("", f.read())
+        source = LINE_COMMENT_RE.sub("", source)
+        for line in source.splitlines():
+            if any(("#define " + name) in line for name in SKIPPED_DEFINES):
+                continue
+            for host, port in URL_RE.findall(line):
+                host = host.lower()
+                if host.endswith(RESERVED_SUFFIXES):
+                    continue
+                entry = "%s:%s" % (host, port or "443")
+                if entry not in hosts:
+                    hosts.append(entry)
+    return hosts
+
+
+def project_hosts(project_dir):
+    include = os.path.join(project_dir, "include")
+    config = os.path.join(include, "config.h")
+    if not os.path.isfile(config):
+        config = os.path.join(include, "config.h.example")
+    headers = sorted(p for p in glob.glob(os.path.join(include, "*.h")) if os.path.basename(p) != "config.h")
+    hosts = header_hosts([config] + headers)
+    for extra in os.environ.get("XRPC_CA_HOSTS", "").split(","):
+        extra = extra.strip().lower()
+        if extra and ":" not in extra:
+            extra += ":443"
+        if extra and extra not in hosts:
+            hosts.append(extra)
+    return hosts
+
+
+# Certificates
+
+def find_openssl():
+    try:
+        subprocess.run(["openssl", "version"], capture_output=True, check=True)
+        return "openssl"
+    except (OSError, subprocess.CalledProcessError):
+        return None
+
+
+def trust_store():
+    paths = ssl.get_default_verify_paths()
+    candidates = [paths.cafile, paths.openssl_cafile]
+    try:
+        import certifi
+        candidates.append(certifi.where())
+    except ImportError:
+        pass
+    for path in candidates + list(TRUST_STORES):
+        if path and os.path.isfile(path):
+            return path
+    return None
+
+
+def cert_names(openssl, pems):
+    """(subject, issuer) of each PEM certificate, in order, as openssl prints them."""
+    with tempfile.NamedTemporaryFile("w", suffix=".pem", delete=False) as f:
+        f.write("\n".join(pems) + "\n")
+        path = f.name
+    try:
+        pkcs7 = subprocess.run([openssl, "crl2pkcs7", "-nocrl", "-certfile", path],
+                               capture_output=True, check=True).stdout
+        text = subprocess.run([openssl, "pkcs7", "-print_certs", "-noout"], input=pkcs7,
+                              capture_output=True, check=True).stdout.decode("utf-8", "replace")
+    except (OSError, subprocess.CalledProcessError):
+        return None
+    finally:
+        os.unlink(path)
+    subjects = [line.split("=", 1)[1].strip() for line in text.splitlines() if line.startswith("subject")]
+    issuers = [line.split("=", 1)[1].strip() for line in text.splitlines() if line.startswith("issuer")]
+    if len(subjects) != len(pems) or len(issuers) != len(pems):
+        return None
+    return list(zip(subjects, issuers))
+
+
+def served_chain(openssl, host):
+    """PEM certificates the server at host:port sends, leaf first."""
+    name, port = host.rsplit(":", 1)
+    try:
+        result = subprocess.run([openssl, "s_client", "-connect", "%s:%s" % (name, port), "-servername", name,
+                                 "-showcerts"], stdin=subprocess.DEVNULL, capture_output=True,
+                                timeout=CONNECT_TIMEOUT)
+    except (OSError, subprocess.TimeoutExpired):
+        return []
+    return PEM_RE.findall(result.stdout.decode("utf-8", "replace"))
+
+
+def roots_for(openssl, host, store, store_names):
+    """Trusted roots that sign host's chain; None if the host couldn't be reached."""
+    chain = served_chain(openssl, host)
+    if not chain:
+        return None
+    names = cert_names(openssl, chain) or []
+    issuers = set(issuer for _, issuer in names)
+    # Every issuer counts, so a cross-signed chain brings both roots
+    roots = [pem for pem, (subject, _) in zip(store, store_names) if subject in issuers]
+    if not roots and names and names[-1][0] == names[-1][1]:
+        # Could be anyone on the build machine's network; a deliberate one goes in XRPC_CA_FILE
+        log("%s sends a self-signed certificate that isn't in the trust store; not pinning it" % host)
+    return roots
+
+
+def build_bundle(openssl, hosts):
+    """PEM text of the roots for hosts, and the hosts that couldn't be covered."""
+    store_path = trust_store()
+    if store_path is None:
+        log("no trust store found")
+        return None, hosts
+    with open(store_path, encoding="utf-8", errors="replace") as f:
+        store = PEM_RE.findall(f.read())
+    store_names = cert_names(openssl, store)
+    if store_names is None:
+        log("couldn't read the trust store at %s" % store_path)
+        return None, hosts
+
+    bundle = []
+    missing = []
+    for host in hosts:
+        roots = roots_for(openssl, host, store, store_names)
+        if not roots:
+            missing.append(host)
+            continue
+        for root in roots:
+            if root not in bundle:
+                bundle.append(root)
+    return "\n".join(bundle) + "\n" if bundle else None, missing
+
+
+# Output
+
+def c_source(pem, hosts):
+    lines = ["// Generated by tools/ca_bundle.py, do not edit. Roots for:"]
+    lines += ["//   %s" % host for host in hosts]
+    lines.append("const char xrpc_ca_bundle[] =")
+    lines += ['    "%s\\n"' % line for line in pem.strip().splitlines()]
+    lines[-1] += ";"
+    return "\n".join(lines) + "\n"
+
+
+def write_outputs(pem, hosts, out_dir):
+    os.makedirs(out_dir, exist_ok=True)
+    with open(os.path.join(out_dir, "ca_bundle.pem"), "w") as f:
+        f.write(pem)
+    with open(os.path.join(out_dir, "xrpc_ca_bundle.c"), "w") as f:
+        f.write(c_source(pem, hosts))
+
+
+def report(openssl, pem, hosts):
+    names = cert_names(openssl, PEM_RE.findall(pem)) or []
+    log("%d root(s), %d bytes, for %s" % (len(names), len(pem), ", ".join(hosts)))
+    for subject, _ in names:
+        log("  " + subject)
+
+
+def stamp_of(*parts):
+    digest = hashlib.sha1(str(SCRIPT_VERSION).encode())
+    for part in parts:
+        if os.path.isfile(part):
+            with open(part, "rb") as f:
+                digest.update(f.read())
+        else:
+            digest.update(part.encode())
+    return digest.hexdigest()
+
+
+def up_to_date(stamp_path, stamp, outputs):
+    if not all(os.path.isfile(p) for p in outputs) or not os.path.isfile(stamp_path):
+        return False
+    if time.time() - os.path.getmtime(stamp_path) > REFRESH_DAYS * 86400:
+        return False
+    with open(stamp_path) as f:
+        return f.read().strip() == stamp
+
+
+def write_stamp(stamp_path, stamp):
+    with open(stamp_path, "w") as f:
+        f.write(stamp + "\n")
+
+
+def generate(project_dir, out_dir):
+    """Brings out_dir/xrpc_ca_bundle.c up to date; False if there is no bundle."""
+    source = os.path.join(out_dir, "xrpc_ca_bundle.c")
+    stamp_path = os.path.join(out_dir, "ca_bundle.stamp")
+    ca_file = os.environ.get("XRPC_CA_FILE")
+    if ca_file:
+        if not os.path.isfile(ca_file):
+            log("XRPC_CA_FILE %s doesn't exist" % ca_file)
+            return False
+        stamp = stamp_of("file", ca_file)
+        if not up_to_date(stamp_path, stamp, [source]):
+            with open(ca_file) as f:
+                write_outputs(f.read(), [ca_file], out_dir)
+            write_stamp(stamp_path, stamp)
+            log("using %s as the bundle" % ca_file)
+        return True
+
+    hosts = project_hosts(project_dir)
+    stamp = stamp_of(*hosts)
+    if up_to_date(stamp_path, stamp, [source]):
+        return True
+
+    openssl = find_openssl()
+    if openssl is None:
+        log("openssl isn't installed")
+        pem, missing = None, hosts
+    else:
+        pem, missing = build_bundle(openssl, hosts)
+    if missing and os.path.isfile(source):
+        log("couldn't get the roots for %s, keeping the last bundle" % ", ".join(missing))
+        return True
+    if pem is None:
+        log("no bundle")
+        return False
+    if missing:
+        log("WARNING: no root for %s; connections to it will fail verification" % ", ".join(missing))
+    write_outputs(pem, hosts, out_dir)
+    write_stamp(stamp_path, stamp)
+    report(openssl, pem, hosts)
+    return True
+
+
+# PlatformIO
+
+def platformio_main(env):
+    if env.subst("$PIOPLATFORM") == "native":
+        return  # The host build has no network code
+    out_dir = os.path.join(env.subst("$BUILD_DIR"), "xrpc_ca_src")
+    if not generate(env.subst("$PROJECT_DIR"), out_dir):
+        if os.environ.get("XRPC_ALLOW_UNVERIFIED") != "1":
+            log("ERROR: no CA bundle, so the badge would refuse every TLS connection. Install openssl, check "
+                "the network, or set XRPC_CA_FILE; XRPC_ALLOW_UNVERIFIED=1 builds without verification.")
+            env.Exit(1)
+        log("WARNING: XRPC_ALLOW_UNVERIFIED=1, the badge will connect without verifying servers")
+        env.Append(CPPDEFINES=[("XRPC_ALLOW_UNVERIFIED", 1)])
+        return
+    env.Append(CPPDEFINES=["XRPC_CA_BUNDLE"])
+    env.BuildSources(os.path.join("$BUILD_DIR", "xrpc_ca"), out_dir)
+
+
+def standalone_main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--project", default=os.path.join(os.path.dirname(__file__), ".."),
+                        help="project directory, for the headers to take hosts from")
+    parser.add_argument("--out", required=True, help="directory for ca_bundle.pem and xrpc_ca_bundle.c")
+    args = parser.parse_args()
+    log("hosts: " + ", ".join(project_hosts(args.project)))
+    if not generate(args.project, args.out):
+        sys.exit(1)
+
+
+try:
+    Import("env")  # noqa: F821 - defined when PlatformIO runs this as an extra script
+except NameError:
+    env = None
+
+if env is not None:
+    platformio_main(env)
+elif __name__ == "__main__":
+    standalone_main()
@@ -0,0 +1,292 @@
+#!/usr/bin/env python3
+"""Local stand-in for a Jetstream WebSocket endpoint.
+
+Generates a post stream shaped like Jetstream's /subscribe output: mostly
+untagged post creations, deletes, identity and account events, with a tagged
+post from the bundled searchPosts sample every --match-every events. Some of
+the tagged posts carry only the text hashtag and no facet, and the noise
+includes near misses ("#seagl20250", the tag without a #) so both halves of the
+badge's matcher are exercised.
+
+Events go out at --rate per second to every subscriber. A ring of recent events
+backs ?cursor=<time_us>: a reconnecting client first gets everything since its
+cursor as fast as the socket takes it, then the live stream, like the real
+service. --drop-after closes each connection after that many events to
+exercise reconnects. The DIDs are the sample authors', so
+tools/mock_xrpc.py's getProfile resolves them.
+
+    python3 tools/mock_jetstream.py --port 6008 --rate 50 --match-every 100
+    # config.h: JETSTREAM_URL "ws://<laptop-ip>:6008/subscribe"
+    #           JETSTREAM_PROFILE_URL "http://<laptop-ip>:8080/xrpc/app.bsky.actor.getProfile"
+"""
+
+import argparse
+import base64
+import collections
+import hashlib
+import json
+import os
+import random
+import socket
+import struct
+import threading
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from urllib.parse import parse_qs, urlparse
+
+DEFAULT_PAYLOAD = os.path.join(os.path.dirname(__file__), "..", "bench", "payloads", "searchPosts_sample.json")
+WS_GUID = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+NOISE_WORDS = ("just", "shipped", "coffee", "rust", "weekend", "cat", "photo", "thread", "lol", "music", "new",
+               "release", "morning", "rain", "garden", "🎉", "über", "☕", "seattle", "linux")
+TID_CHARS = "234567abcdefghijklmnopqrstuvwxyz"
+
+
+def tid(time_us):
+    """Record key in the TID format the PDS uses: timestamp plus a clock id, base32-sortable."""
+    value = (time_us << 10) | random.randrange(1024)
+    return "".join(TID_CHARS[(value >> shift) & 31] for shift in range(60, -5, -5))[:13]
+
+
+class Stream:
+    def __init__(self, args):
+        self.args = args
+        self.lock = threading.Condition()
+        self.ring = collections.deque(maxlen=args.ring)
+        self.last_time_us = 0
+        self.sequence = 0
+        self.stats = collections.Counter()
+        with open(args.payload, "rb") as f:
+            sample = json.loads(f.read().decode("utf-8")).get("posts", [])
+        tag = args.tag.lower()
+        self.tagged = [p for p in sample if ("#" + tag) in p.get("record", {}).get("text", "").lower()]
+        if not self.tagged:
+            raise SystemExit("No posts tagged #%s in %s" % (args.tag, args.payload))
+
+    def next_time_us(self):
+        now = int(time.time() * 1000000)
+        self.last_time_us = max(now, self.last_time_us + 1)
+        return self.last_time_us
+
+    def commit(self, time_us, did, record, operation="create"):
+        commit = {"rev": tid(time_us), "operation": operation, "collection": "app.bsky.feed.post", "rkey": tid(time_us)}
+        if operation == "create":
+            commit["record"] = record
+            commit["cid"] = "bafyrei" + hashlib.sha1(commit["rkey"].encode()).hexdigest()
+        return {"did": did, "time_us": time_us, "kind": "commit", "commit": commit}
+
+    def tagged_event(self, time_us):
+        index = self.sequence // self.args.match_every - 1
+        post = self.tagged[index % len(self.tagged)]
+        cycle = index // len(self.tagged)
+        record = dict(post["record"])
+        record["createdAt"] = time.strftime("%Y-%m-%dT%H:%M:%S", time.gmtime(time_us / 1000000)) + ".%03dZ" % (
+            time_us // 1000 % 1000)
+        if cycle:
+            record["text"] = record["text"] + " (%d)" % cycle  # Same author, new post
+        if random.random() < 0.3:
+            record.pop("facets", None)  # Client that doesn't write facets: text match only
+        self.stats["tagged"] += 1
+        return self.commit(time_us, post["author"]["did"], record)
+
+    def noise_event(self, time_us):
+        did = "did:plc:noise%019d" % random.randrange(10 ** 6)
+        roll = random.random()
+        if roll < 0.05:
+            return {"did": did, "time_us": time_us, "kind": "identity",
+                    "identity": {"did": did, "handle": "someone%d.bsky.social" % random.randrange(10 ** 6),
+                                 "seq": self.sequence, "time": "2025-11-07T19:00:00.000Z"}}
+        if roll < 0.08:
+            return {"did": did, "time_us": time_us, "kind": "account",
+                    "account": {"active": True, "did": did, "seq": self.sequence, "time": "2025-11-07T19:00:00.000Z"}}
+        if roll < 0.15:
+            return self.commit(time_us, did, None, operation="delete")
+        words = [random.choice(NOISE_WORDS) for _ in range(random.randint(3, 40))]
+        if roll < 0.17:
+            words.append(random.choice(("#%s0" % self.args.tag, self.args.tag, "#" + self.args.tag[:-1])))
+        record = {"$type": "app.bsky.feed.post", "createdAt": time.strftime("%Y-%m-%dT%H:%M:%SZ", time.gmtime()),
+                  "langs": ["en"], "text": " ".join(words)}
+        return self.commit(time_us, did, record)
+
+    def produce(self):
+        interval = 1.0 / self.args.rate
+        while True:
+            time.sleep(interval)
+            with self.lock:
+                time_us = self.next_time_us()
+                self.sequence += 1
+                if self.sequence % self.args.match_every == 0:
+                    event = self.tagged_event(time_us)
+                else:
+                    event = self.noise_event(time_us)
+                data = json.dumps(event, ensure_ascii=False, separators=(",", ":")).encode("utf-8")
+                self.ring.append((time_us, data))
+                self.lock.notify_all()
+
+    def events_after(self, time_us):
+        """Events newer than time_us, oldest first, from the ring."""
+        return [(t, d) for t, d in self.ring if t > time_us]
+
+
+class Handler(BaseHTTPRequestHandler):
+    server_version = "MockJetstream/1.0"
+    stream = None  # Set in main()
+
+    def log_message(self, fmt, *args):
+        if self.stream.args.verbose:
+            super().log_message(fmt, *args)
+
+    def do_GET(self):
+        url = urlparse(self.path)
+        if url.path != "/subscribe" or self.headers.get("Upgrade", "").lower() != "websocket":
+            self.send_response(404)
+            self.end_headers()
+            return
+        query = parse_qs(url.query)
+        wanted = set(query.get("wantedCollections", []))
+        cursor = int(query.get("cursor", ["0"])[0] or 0)
+
+        accept = base64.b64encode(hashlib.sha1((self.headers["Sec-WebSocket-Key"] + WS_GUID).encode()).digest())
+        self.send_response(101, "Switching Protocols")
+        self.send_header("Upgrade", "websocket")
+        self.send_header("Connection", "Upgrade")
+        self.send_header("Sec-WebSocket-Accept", accept.decode())
+        self.end_headers()
+        self.wfile.flush()
+
+        self.write_lock = threading.Lock()
+        self.open = True
+        threading.Thread(target=self.read_frames, daemon=True).start()
+        self.serve(wanted, cursor)
+
+    # Framing
+
+    def send_frame(self, opcode, payload):
+        header = bytes([0x80 | opcode])
+        if len(payload) < 126:
+            header += bytes([len(payload)])
+        elif len(payload) < 65536:
+            header += bytes([126]) + struct.pack(">H", len(payload))
+        else:
+            header += bytes([127]) + struct.pack(">Q", len(payload))
+        with self.write_lock:
+            self.wfile.write(header + payload)
+            self.wfile.flush()
+
+    def read_exact(self, count):
+        data = b""
+        while len(data) < count:
+            chunk = self.rfile.read(count - len(data))
+            if not chunk:
+                raise ConnectionError("closed")
+            data += chunk
+        return data
+
+    def read_frames(self):
+        """Answers pings and closes; the badge sends nothing else."""
+        try:
+            while self.open:
+                first, second = self.read_exact(2)
+                length = second & 0x7F
+                if length == 126:
+                    length = struct.unpack(">H", self.read_exact(2))[0]
+                elif length == 127:
+                    length = struct.unpack(">Q", self.read_exact(8))[0]
+                mask = self.read_exact(4) if second & 0x80 else b"\0\0\0\0"
+                payload = bytes(b ^ mask[i % 4] for i, b in enumerate(self.read_exact(length)))
+                opcode = first & 0x0F
+                if opcode == 0x9:
+                    self.send_frame(0xA, payload)
+                elif opcode == 0x8:
+                    self.send_frame(0x8, payload[:2])
+                    break
+        except (ConnectionError, OSError, ValueError):
+            pass
+        self.open = False
+
+    # Stream
+
+    def wanted(self, data, wanted):
+        if not wanted or b'"kind":"commit"' not in data:
+            return True  # Identity and account events go to everyone
+        return any(('"collection":"%s"' % c).encode() in data for c in wanted)
+
+    def serve(self, wanted, cursor):
+        stream = self.stream
+        sent = 0
+        with stream.lock:
+            stream.stats["connections"] += 1
+            backlog = stream.events_after(cursor) if cursor else []
+            last = stream.last_time_us
+        print("Subscriber %s:%d, cursor %s, replaying %d events" % (
+            self.client_address[0], self.client_address[1], cursor or "live", len(backlog)), flush=True)
+        try:
+            for time_us, data in backlog:
+                if self.wanted(data, wanted):
+                    self.send_frame(0x1, data)
+                    sent += 1
+                    stream.stats["replayed"] += 1
+                last = time_us
+            while self.open:
+                with stream.lock:
+                    stream.lock.wait_for(lambda: stream.last_time_us > last, timeout=1.0)
+                    events = stream.events_after(last)
+                for time_us, data in events:
+                    last = time_us
+                    if not self.wanted(data, wanted):
+                        continue
+                    self.send_frame(0x1, data)
+                    sent += 1
+                    stream.stats["sent"] += 1
+                    if stream.args.drop_after and sent >= stream.args.drop_after:
+                        print("Dropping subscriber after %d events" % sent, flush=True)
+                        self.send_frame(0x8, struct.pack(">H", 1001))
+                        self.open = False
+                        break
+        except (ConnectionError, OSError):
+            pass
+        self.open = False
+        self.close_connection = True
+        try:
+            self.connection.shutdown(socket.SHUT_RDWR)
+        except OSError:
+            pass
+
+
+def report(stream):
+    while True:
+        time.sleep(10)
+        with stream.lock:
+            stats = dict(stream.stats, events=stream.sequence)
+        print("Stats: %s" % json.dumps(stats, sort_keys=True), flush=True)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--host", default="0.0.0.0")
+    parser.add_argument("--port", type=int, default=6008)
+    parser.add_argument("--payload", default=DEFAULT_PAYLOAD, help="searchPosts response to take tagged posts from")
+    parser.add_argument("--tag", default="seagl2025", help="hashtag of the tagged posts (without #)")
+    parser.add_argument("--rate", type=float, default=50, help="events per second")
+    parser.add_argument("--match-every", type=int, default=100, help="one tagged post per this many events")
+    parser.add_argument("--ring", type=int, default=60000, help="events kept for cursor replay")
+    parser.add_argument("--drop-after", type=int, default=0, help="close each connection after this many events")
+    parser.add_argument("--seed", type=int, default=None)
+    parser.add_argument("--verbose", action="store_true")
+    args = parser.parse_args()
+    random.seed(args.seed)
+
+    Handler.stream = Stream(args)
+    threading.Thread(target=Handler.stream.produce, daemon=True).start()
+    threading.Thread(target=report, args=(Handler.stream,), daemon=True).start()
+    server = ThreadingHTTPServer((args.host, args.port), Handler)
+    server.daemon_threads = True
+    print("Mock Jetstream on ws://%s:%d/subscribe (%.0f events/s, 1 in %d tagged)" % (
+        args.host, args.port, args.rate, args.match_every), flush=True)
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()
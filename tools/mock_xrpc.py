@@ -0,0 +1,623 @@
+#!/usr/bin/env python3
+"""Local stand-in for the Bluesky XRPC endpoints the badge uses.
+
+Serves com.atproto.server.createSession, com.atproto.server.refreshSession,
+app.bsky.feed.searchPosts, app.bsky.feed.getAuthorFeed and app.bsky.actor.getProfile
+over HTTP/1.1 (or HTTPS with --tls-cert), replaying a searchPosts payload or
+synthetic pages. The default payload is a hand-written sample shaped like a
+real response, not captured traffic; pass a real one with --payload. It also
+answers Mastodon's /api/v1/timelines/tag/<tag> with Bridgy-style copies of the
+payload's posts, so a multi-source fetch sees the same post from two networks.
+The active scenario injects the failure modes the badge has to survive:
+
+  ok            the payload (filtered by since/limit like the real API)
+  large         synthetic page with long texts, facets and image embeds
+  slow          headers delayed by --slow-delay, body throttled to --slow-rate bytes/s
+  chunked       Transfer-Encoding: chunked with uneven chunk sizes
+  unauthorized  revokes the presented access token and answers 401 ExpiredToken
+  ratelimited   429 with ratelimit-* and Retry-After headers
+  truncated     full Content-Length, connection closed halfway through the body
+  staggered     feeds answer after --search-delay, --author-delay and --mastodon-delay
+  scripted      searchPosts serves posts that arrive live as --traffic scripts them
+
+--traffic is a list of rate:seconds phases, in new posts per minute, played in
+a loop from the moment the scenario is selected; "6:120,0:300" is a two minute
+burst followed by five quiet minutes. Arrivals are random within a phase. Every
+scripted post is timestamped when it arrives, and /_mock/stats reports how long
+each one waited for a poll to pick it up (lag) and how many polls found nothing
+new (wasted), so the badge's adaptive polling can be checked from the outside.
+
+--rate-limit N allows N feed requests per --rate-window seconds in every
+scenario, with ratelimit-* headers on each answer and a 429 with Retry-After
+once the window is used up.
+
+--tls-cert/--tls-key serve HTTPS as a local TLS stand-in for bsky.social.
+Connections are kept alive for --keep-alive seconds of idleness, and
+/_mock/stats counts new connections, requests on kept-alive ones and full
+versus resumed TLS handshakes, so the badge's connection reuse and session
+resumption can be checked from the outside. The badge checks the certificate
+against its CA bundle, so build the fetch-bench with XRPC_CA_FILE pointing at
+it (see the README), and give it the address the badge connects to as a DNS
+name: mbed TLS only matches names.
+
+Switch scenarios with GET /_mock/scenario?name=<scenario>; GET /_mock/stats
+returns request and byte counters. Point the badge at it with
+setBlueskyServer() (the fetch-bench environment does this).
+
+    python3 tools/mock_xrpc.py --port 8080 --payload bench/payloads/searchPosts_sample.json
+    python3 tools/mock_xrpc.py --port 8080 --traffic 6:120,0.5:300,0:300 --rate-limit 30 --rate-window 300
+    python3 tools/mock_xrpc.py --port 8443 --tls-cert mock.crt --tls-key mock.key
+
+--write-payloads DIR writes the large scenario's searchPosts, getAuthorFeed and
+Mastodon tag timeline pages as files instead of serving them. The copies in
+bench/payloads are replayed through the badge's parser by the native build.
+"""
+
+import argparse
+import base64
+import calendar
+import json
+import os
+import random
+import ssl
+import threading
+import time
+import zlib
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from urllib.parse import parse_qs, urlparse
+
+SCENARIOS = ("ok", "large", "slow", "chunked", "unauthorized", "ratelimited", "truncated", "staggered", "scripted")
+DEFAULT_PAYLOAD = os.path.join(os.path.dirname(__file__), "..", "bench", "payloads", "searchPosts_sample.json")
+MOCK_DID = "did:plc:mockbadgeaccount000000000"
+MASTODON_HOST = "mastodon.example"
+
+
+def b64url(data):
+    return base64.urlsafe_b64encode(data).rstrip(b"=").decode()
+
+
+def make_jwt(scope, ttl):
+    now = int(time.time())
+    header = b64url(json.dumps({"typ": "at+jwt", "alg": "ES256K"}).encode())
+    claims = b64url(json.dumps({"scope": scope, "sub": MOCK_DID, "iat": now, "exp": now + ttl,
+                                "jti": os.urandom(8).hex()}).encode())
+    return "%s.%s.%s" % (header, claims, b64url(os.urandom(64)))
+
+
+def jwt_exp(token):
+    try:
+        claims = token.split(".")[1]
+        claims += "=" * (-len(claims) % 4)
+        return json.loads(base64.urlsafe_b64decode(claims))["exp"]
+    except (IndexError, ValueError, KeyError):
+        return 0
+
+
+def synthetic_posts(count, tag, text_len=280, now=None):
+    """Newest-first posts shaped like searchPosts results, heavy on the fields the badge filters out."""
+    words = ("open", "source", "talk", "hallway", "badge", "community", "linux", "rust", "python",
+             "keynote", "stickers", "coffee", "seattle", "workshop", "slides", "🎉", "☕", "über")
+    now = time.time() if now is None else now
+    posts = []
+    for i in range(count):
+        text = ""
+        while len(text) < text_len - len(tag) - 2:
+            text += random.choice(words) + " "
+        text = text.strip() + " #" + tag
+        created = time.strftime("%Y-%m-%dT%H:%M:%S", time.gmtime(now - i * 97)) + ".%03dZ" % (i % 1000)
+        did = "did:plc:synthetic%017d" % i
+        posts.append({
+            "uri": "at://%s/app.bsky.feed.post/3msynth%08d" % (did, i),
+            "cid": "bafyreisynthetic%048d" % i,
+            "author": {"did": did, "handle": "attendee%d.bsky.social" % i, "displayName": "Attendee %d" % i,
+                       "avatar": "https://cdn.bsky.app/img/avatar/plain/%s/bafkreiavatar%d@jpeg" % (did, i),
+                       "labels": [], "createdAt": "2024-01-01T00:00:00.000Z"},
+            "record": {"$type": "app.bsky.feed.post", "createdAt": created, "langs": ["en"], "text": text,
+                       "facets": [{"features": [{"$type": "app.bsky.richtext.facet#tag", "tag": tag}],
+                                   "index": {"byteStart": len(text.encode()) - len(tag) - 1,
+                                             "byteEnd": len(text.encode())}}]},
+            "embed": {"$type": "app.bsky.embed.images#view", "images": [
+                {"thumb": "https://cdn.bsky.app/img/feed_thumbnail/plain/%s/bafkreiimg%d@jpeg" % (did, n),
+                 "fullsize": "https://cdn.bsky.app/img/feed_fullsize/plain/%s/bafkreiimg%d@jpeg" % (did, n),
+                 "alt": "Conference photo %d" % n, "aspectRatio": {"width": 4032, "height": 3024}}
+                for n in range(4)]},
+            "replyCount": i % 5, "repostCount": i % 3, "likeCount": i * 7 % 40, "quoteCount": 0,
+            "indexedAt": created, "labels": [],
+        })
+    return posts
+
+
+def parse_traffic(script):
+    """"6:120,0:300" -> [(6.0, 120.0), (0.0, 300.0)]"""
+    phases = []
+    for phase in script.split(","):
+        rate, seconds = phase.split(":")
+        phases.append((float(rate), float(seconds)))
+    if not phases or sum(seconds for _, seconds in phases) <= 0:
+        raise ValueError("traffic script needs at least one phase with a duration")
+    return phases
+
+
+def iso_time(ts):
+    return time.strftime("%Y-%m-%dT%H:%M:%S", time.gmtime(ts)) + ".%03dZ" % (int(ts * 1000) % 1000)
+
+
+def has_tag(post, tag):
+    return ("#" + tag).lower() in post.get("record", {}).get("text", "").lower()
+
+
+def iso_ms(created):
+    return int(calendar.timegm(time.strptime(created[:19], "%Y-%m-%dT%H:%M:%S")) * 1000 + int(created[20:23] or 0))
+
+
+def mastodon_status(status_id, acct, created, text, spoiler=""):
+    """Minimal Mastodon status; content is HTML like the real API."""
+    escaped = text.replace("&", "&amp;").replace("<", "&lt;").replace(">", "&gt;").replace('"', "&quot;")
+    words = []
+    for word in escaped.split(" "):
+        if word.startswith("#") and len(word) > 1:
+            word = ('<a href="https://%s/tags/%s" class="mention hashtag" rel="tag">#<span>%s</span></a>'
+                    % (MASTODON_HOST, word[1:].lower(), word[1:]))
+        words.append(word)
+    content = "".join("<p>%s</p>" % para for para in " ".join(words).split("\n\n"))
+    user = acct.split("@")[0]
+    return {
+        "id": str(status_id), "created_at": created, "sensitive": bool(spoiler), "spoiler_text": spoiler,
+        "visibility": "public", "language": "en",
+        "uri": "https://%s/users/%s/statuses/%d" % (MASTODON_HOST, user, status_id),
+        "url": "https://%s/@%s/%d" % (MASTODON_HOST, acct, status_id),
+        "replies_count": 0, "reblogs_count": 0, "favourites_count": 0, "content": content,
+        "account": {"id": str(zlib.crc32(acct.encode()) % 10 ** 9), "username": user, "acct": acct, "display_name": user,
+                    "avatar": "https://%s/avatars/%s.png" % (MASTODON_HOST, user),
+                    "avatar_static": "https://%s/avatars/%s.png" % (MASTODON_HOST, user)},
+        "media_attachments": [], "mentions": [], "emojis": [],
+        "tags": [{"name": w[1:].lower(), "url": "https://%s/tags/%s" % (MASTODON_HOST, w[1:].lower())}
+                 for w in text.split() if w.startswith("#")],
+    }
+
+
+class MockState:
+    def __init__(self, args):
+        self.lock = threading.Lock()
+        self.args = args
+        self.scenario = args.scenario
+        self.access_tokens = set()
+        self.refresh_tokens = set()
+        self.stats = {"requests": 0, "bytes_sent": 0, "createSession": 0, "refreshSession": 0,
+                      "searchPosts": 0, "getAuthorFeed": 0, "getProfile": 0, "tagTimeline": 0, "errors_injected": 0,
+                      "rate_limited": 0, "connections": 0, "kept_alive_requests": 0, "tls_full": 0,
+                      "tls_resumed": 0, "tls_failed": 0}
+        with open(args.payload, "rb") as f:
+            self.payload = json.loads(f.read().decode("utf-8"))
+        self.traffic = parse_traffic(args.traffic)
+        self.rate_window_start = time.time()
+        self.rate_used = 0
+        self.start_traffic()
+
+    def start_traffic(self):
+        """Restarts the traffic script; called when the scripted scenario is selected."""
+        with self.lock:
+            self.traffic_start = time.time()
+            self.traffic_clock = 0.0  # Script time of the last arrival or phase change
+            self.traffic_phase = 0
+            self.phase_start = 0.0
+            self.next_arrival = None  # Script time, drawn once per arrival
+            self.scripted = []        # [created_ts, post, delivered], oldest first
+            for key in ("scripted_posts", "scripted_delivered", "scripted_polls", "wasted_polls",
+                        "lag_total_ms", "lag_max_ms"):
+                self.stats[key] = 0
+
+    def advance_traffic(self, tag):
+        """Generates the arrivals up to now. Caller holds the lock."""
+        now = time.time() - self.traffic_start
+        while True:
+            rate, seconds = self.traffic[self.traffic_phase]
+            phase_end = self.phase_start + seconds
+            if self.next_arrival is None:
+                # Poisson arrivals; one that falls past the phase's end is dropped (memoryless)
+                self.next_arrival = self.traffic_clock + random.expovariate(rate / 60.0) if rate > 0 else phase_end
+            if self.next_arrival >= phase_end:
+                if phase_end > now:
+                    break
+                self.traffic_clock = self.phase_start = phase_end
+                self.traffic_phase = (self.traffic_phase + 1) % len(self.traffic)
+                self.next_arrival = None
+                continue
+            if self.next_arrival > now:
+                break
+            arrival = self.traffic_clock = self.next_arrival
+            self.next_arrival = None
+            index = len(self.scripted)
+            post = synthetic_posts(1, tag, 140)[0]
+            created = iso_time(self.traffic_start + arrival)
+            did = "did:plc:scripted%018d" % index
+            post["uri"] = "at://%s/app.bsky.feed.post/3mscript%08d" % (did, index)
+            post["author"].update(did=did, handle="live%d.bsky.social" % index, displayName="Live %d" % index)
+            post["record"]["createdAt"] = created
+            post["record"]["text"] = "Live post %d: %s" % (index, post["record"]["text"])
+            post["indexedAt"] = created
+            self.scripted.append([self.traffic_start + arrival, post, False])
+            self.stats["scripted_posts"] += 1
+
+    def take_rate_budget(self):
+        """ratelimit-* headers for one feed request, and whether it's over the limit."""
+        limit = self.args.rate_limit
+        if limit <= 0:
+            return {}, False
+        with self.lock:
+            now = time.time()
+            if now - self.rate_window_start >= self.args.rate_window:
+                self.rate_window_start = now
+                self.rate_used = 0
+            self.rate_used += 1
+            over = self.rate_used > limit
+            reset = int(self.rate_window_start + self.args.rate_window)
+        headers = {"ratelimit-limit": str(limit), "ratelimit-remaining": str(max(0, limit - self.rate_used)),
+                   "ratelimit-reset": str(reset), "ratelimit-policy": "%d;w=%d" % (limit, self.args.rate_window)}
+        if over:
+            headers["Retry-After"] = str(max(1, reset - int(now)))
+        return headers, over
+
+    def count(self, key, amount=1):
+        with self.lock:
+            self.stats[key] = self.stats.get(key, 0) + amount
+
+    def new_session(self):
+        access = make_jwt("com.atproto.appPass", self.args.access_ttl)
+        refresh = make_jwt("com.atproto.refresh", self.args.refresh_ttl)
+        with self.lock:
+            self.access_tokens.add(access)
+            self.refresh_tokens.add(refresh)
+        return {"accessJwt": access, "refreshJwt": refresh, "handle": "badge.mock.test", "did": MOCK_DID,
+                "didDoc": {"id": MOCK_DID, "service": [{"id": "#atproto_pds", "type": "AtprotoPersonalDataServer",
+                                                         "serviceEndpoint": "http://localhost"}]},
+                "active": True}
+
+
+class Handler(BaseHTTPRequestHandler):
+    server_version = "MockXRPC/1.0"
+    protocol_version = "HTTP/1.1"  # Keep-alive; every answer has a Content-Length or is chunked
+    state = None  # Set in main()
+    tls = None    # SSLContext with --tls-cert
+
+    def setup(self):
+        self.state.count("connections")
+        self.served = 0
+        if self.tls is not None:
+            # Handshake here, on the connection's thread, rather than in the accept loop
+            self.request.settimeout(self.timeout)
+            try:
+                self.request = self.tls.wrap_socket(self.request, server_side=True)
+            except (ssl.SSLError, OSError) as e:
+                self.state.count("tls_failed")
+                print("TLS handshake failed: %s" % e, flush=True)
+                raise
+            self.state.count("tls_resumed" if self.request.session_reused else "tls_full")
+        super().setup()
+
+    def count_request(self):
+        self.state.count("requests")
+        if self.served > 0:
+            self.state.count("kept_alive_requests")
+        self.served += 1
+
+    def log_message(self, fmt, *args):
+        if self.state.args.verbose:
+            super().log_message(fmt, *args)
+
+    # Responses
+
+    def send_json(self, status, body, headers=None, shaped=False):
+        """shaped=True applies the active scenario's transfer quirks (feed endpoints only)."""
+        data = json.dumps(body, ensure_ascii=False, separators=(",", ":")).encode("utf-8")
+        self.send_response(status)
+        self.send_header("Content-Type", "application/json; charset=utf-8")
+        for key, value in dict(getattr(self, "rate_headers", {}), **(headers or {})).items():
+            self.send_header(key, value)
+        scenario = self.state.scenario if shaped and status == 200 else "ok"
+
+        if scenario == "chunked":
+            self.send_header("Transfer-Encoding", "chunked")
+            self.end_headers()
+            offset = 0
+            while offset < len(data):
+                size = random.randint(1, 700)
+                chunk = data[offset:offset + size]
+                self.wfile.write(b"%x\r\n" % len(chunk) + chunk + b"\r\n")
+                offset += size
+            self.wfile.write(b"0\r\n\r\n")
+        elif scenario == "truncated":
+            self.send_header("Content-Length", str(len(data)))
+            self.end_headers()
+            self.wfile.write(data[:len(data) // 2])
+            self.state.count("errors_injected")
+            self.close_connection = True
+        elif scenario == "slow":
+            self.send_header("Content-Length", str(len(data)))
+            self.end_headers()
+            step = max(1, self.state.args.slow_rate // 10)
+            for offset in range(0, len(data), step):
+                self.wfile.write(data[offset:offset + step])
+                self.wfile.flush()
+                time.sleep(0.1)
+        else:
+            self.send_header("Content-Length", str(len(data)))
+            self.end_headers()
+            self.wfile.write(data)
+        self.state.count("bytes_sent", len(data))
+
+    def send_error_json(self, status, error, message, headers=None):
+        self.state.count("errors_injected")
+        self.send_json(status, {"error": error, "message": message}, headers)
+
+    def bearer(self):
+        auth = self.headers.get("Authorization", "")
+        return auth[7:] if auth.startswith("Bearer ") else ""
+
+    def read_body(self):
+        length = int(self.headers.get("Content-Length") or 0)
+        return self.rfile.read(length) if length else b""
+
+    # Endpoints
+
+    def do_POST(self):
+        self.count_request()
+        self.rate_headers = {}
+        path = urlparse(self.path).path
+        body = self.read_body()
+
+        if path == "/xrpc/com.atproto.server.createSession":
+            self.state.count("createSession")
+            try:
+                creds = json.loads(body or b"{}")
+            except ValueError:
+                creds = {}
+            if self.state.args.password and creds.get("password") != self.state.args.password:
+                self.send_json(401, {"error": "AuthenticationRequired", "message": "Invalid identifier or password"})
+                return
+            self.send_json(200, self.state.new_session())
+        elif path == "/xrpc/com.atproto.server.refreshSession":
+            self.state.count("refreshSession")
+            token = self.bearer()
+            with self.state.lock:
+                valid = token in self.state.refresh_tokens and jwt_exp(token) > time.time()
+                self.state.refresh_tokens.discard(token)  # Refresh tokens are single use
+            if not valid:
+                self.send_json(400, {"error": "ExpiredToken", "message": "Token has been revoked"})
+                return
+            self.send_json(200, self.state.new_session())
+        else:
+            self.send_json(404, {"error": "MethodNotImplemented", "message": path})
+
+    def do_GET(self):
+        self.count_request()
+        self.rate_headers = {}
+        url = urlparse(self.path)
+        query = parse_qs(url.query)
+
+        if url.path == "/_mock/scenario":
+            name = query.get("name", [""])[0]
+            if name not in SCENARIOS:
+                self.send_json(400, {"error": "UnknownScenario", "scenarios": SCENARIOS})
+                return
+            self.state.scenario = name
+            if name == "scripted":
+                self.state.start_traffic()
+            print("Scenario: %s" % name, flush=True)
+            self.send_json(200, {"scenario": name})
+        elif url.path == "/_mock/stats":
+            with self.state.lock:
+                stats = dict(self.state.stats, scenario=self.state.scenario)
+            self.send_json(200, stats)
+        elif url.path == "/xrpc/app.bsky.feed.searchPosts":
+            self.search_posts(query)
+        elif url.path == "/xrpc/app.bsky.feed.getAuthorFeed":
+            self.author_feed(query)
+        elif url.path == "/xrpc/app.bsky.actor.getProfile":
+            self.get_profile(query)
+        elif url.path.startswith("/api/v1/timelines/tag/"):
+            self.tag_timeline(url.path.rsplit("/", 1)[1], query)
+        else:
+            self.send_json(404, {"error": "MethodNotImplemented", "message": url.path})
+
+    def feed_preamble(self, delay, authenticated=True):
+        """Scenario handling shared by the feed endpoints; False if it already answered."""
+        scenario = self.state.scenario
+        if authenticated:
+            token = self.bearer()
+            with self.state.lock:
+                valid = token in self.state.access_tokens and jwt_exp(token) > time.time()
+                if valid and scenario == "unauthorized":
+                    self.state.access_tokens.discard(token)
+                    valid = False
+            if not valid:
+                self.send_error_json(401, "ExpiredToken", "Token has expired")
+                return False
+
+        self.rate_headers, over = self.state.take_rate_budget()
+        if over:
+            self.state.count("rate_limited")
+            self.send_error_json(429, "RateLimitExceeded", "Rate Limit Exceeded")
+            return False
+        if scenario == "ratelimited":
+            reset = int(time.time()) + 60
+            self.send_error_json(429, "RateLimitExceeded", "Rate Limit Exceeded", {
+                "ratelimit-limit": "3000", "ratelimit-remaining": "0", "ratelimit-reset": str(reset),
+                "ratelimit-policy": "3000;w=300", "Retry-After": "60"})
+            return False
+        if scenario == "slow":
+            time.sleep(self.state.args.slow_delay)
+        elif scenario == "staggered":
+            time.sleep(delay)
+        return True
+
+    def search_posts(self, query):
+        self.state.count("searchPosts")
+        if not self.feed_preamble(self.state.args.search_delay):
+            return
+
+        limit = min(int(query.get("limit", ["25"])[0]), 100)
+        since = query.get("since", [""])[0]
+        tag = query.get("q", ["#seagl2025"])[0].lstrip("#")
+        if self.state.scenario == "large":
+            posts = synthetic_posts(limit, tag)
+        elif self.state.scenario == "scripted":
+            posts = self.scripted_posts(tag, since, limit)
+        else:
+            posts = [p for p in self.state.payload.get("posts", [])
+                     if has_tag(p, tag) and (not since or p.get("record", {}).get("createdAt", "") >= since)][:limit]
+        self.send_json(200, {"posts": posts, "hitsTotal": len(posts), "cursor": str(len(posts))}, shaped=True)
+
+    def scripted_posts(self, tag, since, limit):
+        """Newest first like the real search; counts first deliveries and their lag."""
+        now = time.time()
+        with self.state.lock:
+            self.state.advance_traffic(tag)
+            page = [entry for entry in reversed(self.state.scripted)
+                    if not since or entry[1]["record"]["createdAt"] >= since][:limit]
+            fresh = [entry for entry in page if not entry[2]]
+            stats = self.state.stats
+            stats["scripted_polls"] += 1
+            if not fresh:
+                stats["wasted_polls"] += 1
+            for entry in fresh:
+                entry[2] = True
+                lag = int((now - entry[0]) * 1000)
+                stats["scripted_delivered"] += 1
+                stats["lag_total_ms"] += lag
+                stats["lag_max_ms"] = max(stats["lag_max_ms"], lag)
+            stats["lag_avg_ms"] = stats["lag_total_ms"] // max(1, stats["scripted_delivered"])
+        return [entry[1] for entry in page]
+
+    def author_feed(self, query):
+        self.state.count("getAuthorFeed")
+        if not self.feed_preamble(self.state.args.author_delay):
+            return
+
+        actor = query.get("actor", [""])[0]
+        limit = min(int(query.get("limit", ["50"])[0]), 100)
+        posts = self.state.payload.get("posts", [])
+        own = sorted((p for p in posts if p.get("author", {}).get("handle") == actor),
+                     key=lambda p: p.get("record", {}).get("createdAt", ""), reverse=True)
+        feed = [{"post": p} for p in own]
+        others = [p for p in posts if p.get("author", {}).get("handle") != actor]
+        if own and others:
+            # A repost on top, as the real feed has them: carries the original's older date
+            feed.insert(0, {"post": others[-1], "reason": {
+                "$type": "app.bsky.feed.defs#reasonRepost", "indexedAt": own[0]["record"]["createdAt"],
+                "by": own[0]["author"]}})
+        self.send_json(200, {"feed": feed[:limit], "cursor": str(len(feed))}, shaped=True)
+
+    def get_profile(self, query):
+        """Authors of the payload posts, for the DIDs tools/mock_jetstream.py streams."""
+        self.state.count("getProfile")
+        actor = query.get("actor", [""])[0]
+        for p in self.state.payload.get("posts", []):
+            author = p.get("author", {})
+            if actor in (author.get("did"), author.get("handle")):
+                self.send_json(200, {"did": author.get("did"), "handle": author.get("handle"),
+                                     "displayName": author.get("displayName", ""), "avatar": author.get("avatar", ""),
+                                     "followersCount": 0, "followsCount": 0, "postsCount": 1})
+                return
+        self.send_json(400, {"error": "InvalidRequest", "message": "Profile not found"})
+
+    def tag_timeline(self, tag, query):
+        self.state.count("tagTimeline")
+        if not self.feed_preamble(self.state.args.mastodon_delay, authenticated=False):
+            return
+
+        limit = min(int(query.get("limit", ["20"])[0]), 40)
+        since_id = int(query.get("since_id", ["0"])[0] or 0)
+        statuses = []
+        for p in self.state.payload.get("posts", []):
+            if not has_tag(p, tag):
+                continue
+            record = p.get("record", {})
+            created = record.get("createdAt", "")
+            statuses.append(mastodon_status(iso_ms(created) << 16, p["author"]["handle"] + "@bsky.brid.gy",
+                                            created, record.get("text", "")))
+        if statuses:
+            # A local post newer than everything else, and one behind a content warning
+            newest = max(s["created_at"] for s in statuses)
+            native = time.strftime("%Y-%m-%dT%H:%M:%S", time.gmtime(iso_ms(newest) // 1000 + 60)) + ".000Z"
+            statuses.append(mastodon_status(iso_ms(native) << 16, "fedifriend", native,
+                                            "Greetings from the fediverse! Who else is following #%s from afar?" % tag))
+            hidden = time.strftime("%Y-%m-%dT%H:%M:%S", time.gmtime(iso_ms(newest) // 1000 + 30)) + ".000Z"
+            statuses.append(mastodon_status(iso_ms(hidden) << 16, "spoilers", hidden,
+                                            "The closing keynote reveal was wild #%s" % tag, spoiler="keynote spoilers"))
+        statuses = sorted((s for s in statuses if int(s["id"]) > since_id), key=lambda s: int(s["id"]), reverse=True)
+        self.send_json(200, statuses[:limit], shaped=True)
+
+def write_payloads(directory):
+    """The large scenario's pages for every feed endpoint, as files for the native build's parse replay."""
+    random.seed(2025)  # Same files every time
+    now = iso_ms("2025-11-08T18:00:00.000Z") / 1000
+    posts = synthetic_posts(2 * 15, "seagl2025", now=now)  # Twice the page the badge asks for
+    for i in range(0, len(posts), 7):
+        # Texts at Bluesky's 300 character limit, multi-byte heavy
+        text = ("Ünïcödé 🎉 " * 30)[:300 - 11] + " #seagl2025"
+        posts[i]["record"]["text"] = text
+    feed = [{"post": p} for p in posts]
+    feed.insert(0, {"post": posts[-1], "reason": {"$type": "app.bsky.feed.defs#reasonRepost",
+                                                  "indexedAt": posts[0]["indexedAt"], "by": posts[0]["author"]}})
+    statuses = [mastodon_status(iso_ms(p["record"]["createdAt"]) << 16, p["author"]["handle"] + "@bsky.brid.gy",
+                                p["record"]["createdAt"], p["record"]["text"]) for p in posts]
+    # Mastodon's 500 character limit, with a hashtag link in every line
+    statuses[1] = mastodon_status(int(statuses[1]["id"]), "longpost", statuses[1]["created_at"],
+                                  "\n\n".join(["Hallway track notes & <links> #seagl2025"] * 12)[:500])
+    pages = {"searchPosts_large.json": {"posts": posts, "hitsTotal": len(posts), "cursor": str(len(posts))},
+             "getAuthorFeed_large.json": {"feed": feed, "cursor": str(len(feed))},
+             "tagTimeline_large.json": statuses}
+    for name, body in pages.items():
+        path = os.path.join(directory, name)
+        with open(path, "wb") as f:
+            f.write(json.dumps(body, ensure_ascii=False, separators=(",", ":")).encode("utf-8"))
+        print("Wrote %s (%d bytes)" % (path, os.path.getsize(path)))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--host", default="0.0.0.0")
+    parser.add_argument("--port", type=int, default=8080)
+    parser.add_argument("--payload", default=DEFAULT_PAYLOAD, help="searchPosts response to replay (default: the hand-written sample)")
+    parser.add_argument("--scenario", default="ok", choices=SCENARIOS)
+    parser.add_argument("--password", default="", help="require this app password (default: accept any)")
+    parser.add_argument("--access-ttl", type=int, default=7200, help="access token lifetime in seconds")
+    parser.add_argument("--refresh-ttl", type=int, default=90 * 86400, help="refresh token lifetime in seconds")
+    parser.add_argument("--slow-delay", type=float, default=2.0, help="seconds before headers in the slow scenario")
+    parser.add_argument("--slow-rate", type=int, default=4096, help="body bytes/s in the slow scenario")
+    parser.add_argument("--search-delay", type=float, default=0.3, help="searchPosts delay in the staggered scenario")
+    parser.add_argument("--author-delay", type=float, default=0.6, help="getAuthorFeed delay in the staggered scenario")
+    parser.add_argument("--mastodon-delay", type=float, default=0.9, help="tag timeline delay in the staggered scenario")
+    parser.add_argument("--traffic", default="0:120,6:180,1:300,0:600",
+                        help="scripted scenario: rate:seconds phases in posts per minute, looped")
+    parser.add_argument("--rate-limit", type=int, default=0, help="feed requests allowed per window (0: unlimited)")
+    parser.add_argument("--rate-window", type=int, default=300, help="rate limit window in seconds")
+    parser.add_argument("--tls-cert", help="serve HTTPS with this PEM certificate")
+    parser.add_argument("--tls-key", help="private key of --tls-cert (default: in the certificate file)")
+    parser.add_argument("--keep-alive", type=float, default=75, help="seconds an idle connection is kept open")
+    parser.add_argument("--verbose", action="store_true")
+    parser.add_argument("--write-payloads", metavar="DIR",
+                        help="write the large scenario's pages to DIR (for the native build) and exit")
+    args = parser.parse_args()
+    if args.write_payloads:
+        write_payloads(args.write_payloads)
+        return
+
+    Handler.state = MockState(args)
+    Handler.timeout = args.keep_alive
+    if args.tls_cert:
+        # Session IDs and tickets are both on by default, so resumption works as with the real host
+        Handler.tls = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+        Handler.tls.load_cert_chain(args.tls_cert, args.tls_key)
+    server = ThreadingHTTPServer((args.host, args.port), Handler)
+    print("Mock XRPC server on %s://%s:%d (scenario: %s)" % ("https" if args.tls_cert else "http", args.host,
+                                                                args.port, args.scenario), flush=True)
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()
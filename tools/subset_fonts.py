@@ -0,0 +1,358 @@
+#!/usr/bin/env python3
+"""Build-time font subsetting for the badge.
+
+The screens use Montserrat at 16-28 px for posts and at 32 and 48 px for the
+static screens. This generates exactly those sizes with lv_font_conv instead of
+compiling in LVGL's built-in Montserrat set (14-48 px, each with the ~60
+FontAwesome symbols the badge never draws), and reports what that saves in
+flash. The post sizes also get Latin-1, typographic quotes and dashes, the
+ellipsis and the euro sign, which the built-in fonts lack.
+
+Characters outside those ranges (other scripts, emoji) can come from a fallback
+font in LittleFS, loaded glyph by glyph into a PSRAM cache at runtime
+(src/fonts.cpp). Set BADGE_FALLBACK_FONT to build it into data/fonts/:
+
+    BADGE_FALLBACK_FONT="NotoSans-Regular.ttf=0x100-0x24F,0x370-0x3FF,0x400-0x4FF;NotoEmoji-Regular.ttf=0x1F300-0x1F6FF"
+    pio run -t uploadfs
+
+Each post size uses the fallback file closest to it; BADGE_FALLBACK_SIZES=16,22,28
+builds several instead of the single 20 px one.
+
+Runs as a PlatformIO pre: script for every environment. It can also be run on
+its own to print the report:
+
+    python3 tools/subset_fonts.py --lvgl .pio/libdeps/native/lvgl --out /tmp/badge_fonts
+
+Needs lv_font_conv (npm install -g lv_font_conv, or npx). Without it, or
+without Montserrat-Medium.ttf, the build keeps LVGL's built-in fonts.
+"""
+
+import argparse
+import glob
+import hashlib
+import os
+import re
+import shutil
+import struct
+import subprocess
+import sys
+
+SCRIPT_VERSION = 1
+POST_SIZES = (16, 18, 20, 22, 24, 26, 28)
+STATIC_SIZES = (32, 48)
+BUILTIN_SIZES = (14, 16, 18, 20, 22, 24, 26, 28, 32, 36, 40, 48)  # What lv_conf.h compiled before
+
+ASCII_RANGE = "0x20-0x7E"
+POST_RANGES = ",".join((ASCII_RANGE,
+                        "0xA0-0xFF",        # Latin-1: accented names, currency, degree sign
+                        "0x2013-0x2014",    # En and em dash
+                        "0x2018-0x201E",    # Typographic quotes
+                        "0x2022",           # Bullet
+                        "0x2026",           # Ellipsis
+                        "0x20AC"))          # Euro sign
+
+FALLBACK_SIZE = 20  # Drawn at every post size unless BADGE_FALLBACK_SIZES adds more
+FALLBACK_DEFAULT_RANGES = "0x100-0x24F,0x370-0x3FF,0x400-0x4FF"  # Latin Extended, Greek, Cyrillic
+FALLBACK_MAGIC = b"BGF1"
+FALLBACK_VERSION = 1
+FALLBACK_FILE = os.path.join("fonts", "fallback_%d.bin")
+
+FONT_NAME = "badge_font_%d"
+TTF_NAME = "Montserrat-Medium.ttf"
+
+GLYPH_DSC_RE = re.compile(r"\{\s*\.bitmap_index\s*=\s*(\d+),\s*\.adv_w\s*=\s*(\d+),\s*\.box_w\s*=\s*(\d+),\s*"
+                          r"\.box_h\s*=\s*(\d+),\s*\.ofs_x\s*=\s*(-?\d+),\s*\.ofs_y\s*=\s*(-?\d+)\s*\}")
+CODEPOINT_RE = re.compile(r"/\*\s*U\+([0-9A-Fa-f]+)")
+HEX_RE = re.compile(r"0x[0-9A-Fa-f]+")
+COMMENT_RE = re.compile(r"/\*.*?\*/", re.S)
+
+
+def log(message):
+    print("subset_fonts: " + message, flush=True)
+
+
+# lv_font_conv output
+
+def array_body(source, name):
+    """Text between the braces of the C array called name."""
+    start = source.find(name + "[] = {")
+    if start < 0:
+        return None
+    start = source.index("{", start) + 1
+    return source[start:source.index("};", start)]
+
+
+def parse_font(path):
+    """Glyph list and metrics of an lv_font_conv (or built-in LVGL) font source."""
+    with open(path, encoding="utf-8") as f:
+        source = f.read()
+    bitmap = array_body(source, "glyph_bitmap")
+    dsc = array_body(source, "glyph_dsc")
+    if bitmap is None or dsc is None:
+        raise ValueError("%s: no glyph_bitmap/glyph_dsc, compressed or not an LVGL font?" % path)
+
+    codepoints = [int(cp, 16) for cp in CODEPOINT_RE.findall(bitmap)]
+    data = bytes(int(value, 16) for value in HEX_RE.findall(COMMENT_RE.sub("", bitmap)))
+    entries = [tuple(int(v) for v in m.groups()) for m in GLYPH_DSC_RE.finditer(dsc)][1:]  # id 0 is reserved
+
+    def metric(name):
+        match = re.search(r"\." + name + r"\s*=\s*(-?\d+)", source)
+        return int(match.group(1)) if match else 0
+
+    return {"codepoints": codepoints, "bitmap": data, "glyphs": entries,
+            "line_height": metric("line_height"), "base_line": metric("base_line")}
+
+
+def flash_bytes(font):
+    """Bitmaps plus glyph descriptors (lv_font_fmt_txt_glyph_dsc_t is 8 bytes)."""
+    return len(font["bitmap"]) + 8 * (len(font["glyphs"]) + 1)
+
+
+# Fallback font file
+
+def packbits(data):
+    """PackBits RLE: a header byte n < 128 copies n + 1 literal bytes, n >= 128 repeats the next byte n - 125 times."""
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        run = 1
+        while i + run < len(data) and run < 130 and data[i + run] == data[i]:
+            run += 1
+        if run >= 3:
+            out += bytes((run + 125, data[i]))
+            i += run
+            continue
+        start = i
+        while i < len(data) and i - start < 128:
+            if i + 2 < len(data) and data[i] == data[i + 1] == data[i + 2]:
+                break
+            i += 1
+        out.append(i - start - 1)
+        out += data[start:i]
+    return bytes(out)
+
+
+def write_fallback(font, size, path):
+    """BGF1: header, codepoint-sorted index, then each glyph's bitmap PackBits-compressed.
+
+    Header (20 bytes): magic, u16 version, u16 size, u16 line height, i16 base line,
+    u8 bpp, 3 reserved, u32 glyph count. Index entry (16 bytes): u32 codepoint,
+    u32 offset, u16 advance (1/16 px), u8 box w, u8 box h, i8 ofs x, i8 ofs y,
+    u16 compressed length. All little-endian.
+    """
+    glyphs = sorted(zip(font["codepoints"], font["glyphs"]))
+    ends = sorted({g[1][0] for g in glyphs} | {len(font["bitmap"])})
+    next_index = {start: ends[i + 1] for i, start in enumerate(ends[:-1])}
+
+    header = FALLBACK_MAGIC + struct.pack("<HHHhB3xI", FALLBACK_VERSION, size, font["line_height"],
+                                          font["base_line"], 4, len(glyphs))
+    offset = len(header) + 16 * len(glyphs)
+    index = bytearray()
+    blobs = bytearray()
+    for codepoint, (start, adv_w, box_w, box_h, ofs_x, ofs_y) in glyphs:
+        raw = font["bitmap"][start:next_index.get(start, start)] if box_w and box_h else b""
+        packed = packbits(raw[:(box_w * box_h * 4 + 7) // 8])
+        index += struct.pack("<IIHBBbbH", codepoint, offset + len(blobs), adv_w, box_w, box_h, ofs_x, ofs_y, len(packed))
+        blobs += packed
+
+    os.makedirs(os.path.dirname(path), exist_ok=True)
+    with open(path, "wb") as f:
+        f.write(header + index + blobs)
+    return len(glyphs), len(font["bitmap"]), len(header) + len(index) + len(blobs)
+
+
+# Generation
+
+def find_converter():
+    converter = shutil.which("lv_font_conv")
+    if converter:
+        return [converter]
+    npx = shutil.which("npx")
+    return [npx, "--yes", "lv_font_conv"] if npx else None
+
+
+def convert(converter, fonts, size, name, out):
+    """fonts: [(ttf, ranges)]"""
+    command = list(converter)
+    for ttf, ranges in fonts:
+        command += ["--font", ttf, "-r", ranges]
+    command += ["--size", str(size), "--bpp", "4", "--format", "lvgl", "--no-compress", "--no-prefilter",
+                "--lv-include", "lvgl.h", "--lv-font-name", name, "-o", out]
+    subprocess.run(command, check=True, stdout=subprocess.DEVNULL)
+
+
+def parse_fallback_spec(spec):
+    """'a.ttf=0x100-0x24F,0x370-0x3FF;b.ttf' -> [(path, ranges)]"""
+    fonts = []
+    for part in filter(None, spec.split(";")):
+        path, _, ranges = part.partition("=")
+        fonts.append((os.path.expanduser(path.strip()), ranges.strip() or FALLBACK_DEFAULT_RANGES))
+    return fonts
+
+
+def stamp_of(*parts):
+    digest = hashlib.sha1(str(SCRIPT_VERSION).encode())
+    for part in parts:
+        if os.path.isfile(part):
+            with open(part, "rb") as f:
+                digest.update(f.read())
+        else:
+            digest.update(part.encode())
+    return digest.hexdigest()
+
+
+def up_to_date(stamp_path, stamp, outputs):
+    if not all(os.path.isfile(p) for p in outputs) or not os.path.isfile(stamp_path):
+        return False
+    with open(stamp_path) as f:
+        return f.read().strip() == stamp
+
+
+def write_stamp(stamp_path, stamp):
+    with open(stamp_path, "w") as f:
+        f.write(stamp + "\n")
+
+
+def subset(lvgl_dir, out_dir, ttf=None):
+    """Generates badge_font_<size>.c for every size in out_dir unless they're current.
+
+    Returns (files, regenerated), or (None, False) when the build has to keep the built-in fonts.
+    """
+    ttf = ttf or os.path.join(lvgl_dir, "scripts", "built_in_font", TTF_NAME)
+    if not os.path.isfile(ttf):
+        log("%s not found, keeping the built-in fonts (set BADGE_FONT_TTF)" % ttf)
+        return None, False
+    sizes = POST_SIZES + STATIC_SIZES
+    outputs = [os.path.join(out_dir, FONT_NAME % size + ".c") for size in sizes]
+    stamp = stamp_of(ttf, POST_RANGES, ASCII_RANGE, repr(sizes))
+    stamp_path = os.path.join(out_dir, "fonts.stamp")
+    if up_to_date(stamp_path, stamp, outputs):
+        return outputs, False
+
+    converter = find_converter()
+    if converter is None:
+        log("lv_font_conv not found (npm install -g lv_font_conv), keeping the built-in fonts")
+        return None, False
+    os.makedirs(out_dir, exist_ok=True)
+    try:
+        for size, out in zip(sizes, outputs):
+            ranges = POST_RANGES if size in POST_SIZES else ASCII_RANGE
+            convert(converter, [(ttf, ranges)], size, FONT_NAME % size, out)
+    except (OSError, subprocess.CalledProcessError) as e:
+        log("lv_font_conv failed (%s), keeping the built-in fonts" % e)
+        return None, False
+    write_stamp(stamp_path, stamp)
+    return outputs, True
+
+
+def report(lvgl_dir, out_dir):
+    before = 0
+    before_glyphs = 0
+    for size in BUILTIN_SIZES:
+        path = os.path.join(lvgl_dir, "src", "font", "lv_font_montserrat_%d.c" % size)
+        if not os.path.isfile(path):
+            log("No %s, can't compare with the built-in fonts" % path)
+            return
+        font = parse_font(path)
+        before += flash_bytes(font)
+        before_glyphs += len(font["glyphs"])
+
+    after = 0
+    after_glyphs = 0
+    for size in POST_SIZES + STATIC_SIZES:
+        font = parse_font(os.path.join(out_dir, FONT_NAME % size + ".c"))
+        after += flash_bytes(font)
+        after_glyphs += len(font["glyphs"])
+        log("  %2d px: %4d glyphs, %6d bytes" % (size, len(font["glyphs"]), flash_bytes(font)))
+    log("Built-in Montserrat, %d sizes: %d glyphs, %d bytes" % (len(BUILTIN_SIZES), before_glyphs, before))
+    log("Subset, %d sizes: %d glyphs, %d bytes (%+d bytes, %+.0f%%)" % (
+        len(POST_SIZES + STATIC_SIZES), after_glyphs, after, after - before, (after - before) * 100.0 / before))
+
+
+def build_fallback(spec, sizes, data_dir, work_dir):
+    fonts = parse_fallback_spec(spec)
+    missing = [path for path, _ in fonts if not os.path.isfile(path)]
+    if missing:
+        log("Fallback font %s not found, skipping it" % ", ".join(missing))
+        return
+    outputs = [os.path.join(data_dir, FALLBACK_FILE % size) for size in sizes]
+    stamp = stamp_of(spec, repr(sizes), *[path for path, _ in fonts])
+    stamp_path = os.path.join(work_dir, "fallback.stamp")
+    if up_to_date(stamp_path, stamp, outputs):
+        return
+
+    converter = find_converter()
+    if converter is None:
+        log("lv_font_conv not found, skipping the fallback font")
+        return
+    os.makedirs(work_dir, exist_ok=True)
+    for size, out in zip(sizes, outputs):
+        source = os.path.join(work_dir, "fallback_%d.c" % size)
+        try:
+            convert(converter, fonts, size, "badge_fallback_%d" % size, source)
+        except (OSError, subprocess.CalledProcessError) as e:
+            log("lv_font_conv failed on the fallback font (%s)" % e)
+            return
+        count, raw, packed = write_fallback(parse_font(source), size, out)
+        log("Fallback font: %d glyphs at %d px, %d bitmap bytes packed into %d (%s, upload with -t uploadfs)" % (
+            count, size, raw, packed, out))
+    write_stamp(stamp_path, stamp)
+
+
+def fallback_sizes(value):
+    """BADGE_FALLBACK_SIZES: comma-separated pixel sizes, each its own file"""
+    return tuple(int(size) for size in value.split(",") if size.strip()) if value else (FALLBACK_SIZE,)
+
+
+# PlatformIO
+
+def platformio_main(env):
+    project_dir = env.subst("$PROJECT_DIR")
+    lvgl_dirs = glob.glob(os.path.join(env.subst("$PROJECT_LIBDEPS_DIR"), env.subst("$PIOENV"), "lvgl"))
+    work_dir = os.path.join(env.subst("$BUILD_DIR"), "badge_fonts_src")
+    out_dir = os.path.join(work_dir, "src")
+
+    fallback = os.environ.get("BADGE_FALLBACK_FONT")
+    if fallback:
+        build_fallback(fallback, fallback_sizes(os.environ.get("BADGE_FALLBACK_SIZES")),
+                       os.path.join(project_dir, "data"), work_dir)
+
+    if not lvgl_dirs:
+        log("LVGL isn't installed yet, keeping the built-in fonts for this build")
+        return
+    outputs, regenerated = subset(lvgl_dirs[0], out_dir, os.environ.get("BADGE_FONT_TTF"))
+    if outputs is None:
+        return
+    if regenerated:
+        report(lvgl_dirs[0], out_dir)
+    env.Append(CPPDEFINES=["BADGE_FONTS_SUBSET"])
+    env.BuildSources(os.path.join("$BUILD_DIR", "badge_fonts"), out_dir)
+
+
+def standalone_main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--lvgl", required=True, help="LVGL library directory (.pio/libdeps/<env>/lvgl)")
+    parser.add_argument("--out", required=True, help="directory for the generated font sources")
+    parser.add_argument("--ttf", default=os.environ.get("BADGE_FONT_TTF"), help="Montserrat TTF to subset")
+    parser.add_argument("--fallback", default=os.environ.get("BADGE_FALLBACK_FONT"),
+                        help="fallback font spec, path=ranges;path=ranges")
+    parser.add_argument("--fallback-sizes", default=os.environ.get("BADGE_FALLBACK_SIZES"),
+                        help="comma-separated fallback font sizes (default %d)" % FALLBACK_SIZE)
+    parser.add_argument("--data", default="data", help="LittleFS image directory for the fallback font")
+    args = parser.parse_args()
+    if args.fallback:
+        build_fallback(args.fallback, fallback_sizes(args.fallback_sizes), args.data, args.out)
+    if subset(args.lvgl, args.out, args.ttf)[0] is None:
+        sys.exit(1)
+    report(args.lvgl, args.out)
+
+
+try:
+    Import("env")  # noqa: F821 - defined when PlatformIO runs this as an extra script
+except NameError:
+    env = None
+
+if env is not None:
+    platformio_main(env)
+elif __name__ == "__main__":
+    standalone_main()